@@ -1,5 +1,6 @@
 
 #include "ast.hpp"
+#include "table.hpp"
 #include "type.hpp"
 #include "value.hpp"
 
@@ -20,6 +21,8 @@ init_nodes() {
   init_node(var_term, "var");
   init_node(abs_term, "abs");
   init_node(app_term, "app");
+  init_node(closure_term, "closure");
+  init_node(frame_closure_term, "frame-closure");
   init_node(tuple_term, "tuple");
   init_node(list_term, "list");
   init_node(record_term, "record");
@@ -27,6 +30,9 @@ init_nodes() {
   init_node(proj_term, "proj");
   init_node(mem_term, "mem");
   init_node(col_term, "col");
+  init_node(aggregate_term, "aggregate");
+  init_node(load_term, "load");
+  init_node(save_term, "save");
   init_node(table_term, "table");
   init_node(and_term, "and");
   init_node(or_term, "or");
@@ -162,6 +168,25 @@ pp_list(std::ostream& os, List* t) {
   os << '[' << commas(t->elems()) << ']';
 }
 
+// Print a table as a list of records.
+void
+pp_table(std::ostream& os, Table* t) {
+  Term_seq* vars = t->schema()->members();
+  os << '[';
+  for (std::size_t i = 0; i < t->size(); ++i) {
+    if (i != 0)
+      os << ", ";
+    os << '{';
+    for (std::size_t j = 0; j < vars->size(); ++j) {
+      if (j != 0)
+        os << ", ";
+      os << pretty(as<Var>((*vars)[j])->name()) << " = " << pretty(t->t1[j].get(i));
+    }
+    os << '}';
+  }
+  os << ']';
+}
+
 void
 pp_record(std::ostream& os, Record* t) {
   os << '{' << commas(t->members()) << '}';
@@ -270,6 +295,24 @@ pp_select(std::ostream& os, Select_from_where* t) {
   os << "select " << pretty(t->t1) 
      << " from " << pretty(t->t2) 
      << " where " << pretty(t->t3);
+  if (t->t4)
+    os << " group by " << pretty(t->t4);
+}
+
+void
+pp_load(std::ostream& os, Load* t) {
+  os << "load " << pretty(t->file()) << " as " << pretty(t->row_type());
+}
+
+void
+pp_save(std::ostream& os, Save* t) {
+  os << "save " << pretty(t->table()) << " to " << pretty(t->file());
+}
+
+void
+pp_aggregate(std::ostream& os, Aggregate* t) {
+  static const char* names[] = {"count", "sum", "min", "max"};
+  os << names[t->op] << ' ' << pretty(t->t1);
 }
 
 void
@@ -336,6 +379,7 @@ pp_expr(std::ostream& os, Node* t) {
   case tuple_term: return pp_tuple(os, as<Tuple>(t));
   case list_term: return pp_list(os, as<List>(t));
   case record_term: return pp_record(os, as<Record>(t));
+  case table_term: return pp_table(os, as<Table>(t));
   case comma_term: return pp_comma(os, as<Comma>(t));
   case proj_term: return pp_proj(os, as<Proj>(t));
   case mem_term: return pp_mem(os, as<Mem>(t));
@@ -352,6 +396,9 @@ pp_expr(std::ostream& os, Node* t) {
   case except_term: return pp_except(os, as<Except>(t));
   case col_term: return pp_col(os, as<Col>(t));
   case join_on_term: return pp_join(os, as<Join>(t));
+  case aggregate_term: return pp_aggregate(os, as<Aggregate>(t));
+  case load_term: return pp_load(os, as<Load>(t));
+  case save_term: return pp_save(os, as<Save>(t));
   // Types
   case unit_type: return pp_string(os, "Unit");
   case bool_type: return pp_string(os, "Bool");
@@ -43,6 +43,8 @@ constexpr Node_kind abs_term     = make_term_node(31); // \v.t
 constexpr Node_kind fn_term      = make_term_node(32); // \(v1, ..., vn).t
 constexpr Node_kind app_term     = make_term_node(33); // t1 t2
 constexpr Node_kind call_term    = make_term_node(34); // (t1, ..., tn)
+constexpr Node_kind closure_term = make_term_node(35); // closure, in the machine
+constexpr Node_kind frame_closure_term = make_term_node(36); // closure, in the evaluator
 // Tuples, records, and variants
 constexpr Node_kind tuple_term   = make_term_node(40); // {t1, ..., tn}
 constexpr Node_kind list_term    = make_term_node(41); // [t1, ..., tn]
@@ -62,9 +64,12 @@ constexpr Node_kind union_term   = make_term_node(63); // t1 union t2
 constexpr Node_kind intersect_term = make_term_node(64); // t1 intersect t2
 constexpr Node_kind except_term  = make_term_node(65); // t1 except t2
 constexpr Node_kind col_term     = make_term_node(66); // table.n (col proj)
+constexpr Node_kind aggregate_term = make_term_node(67); // count t, sum t, ...
 // Miscellaneous terms
 constexpr Node_kind ref_term     = make_term_node(100); // ref to decl
 constexpr Node_kind print_term   = make_term_node(101); // print t
+constexpr Node_kind load_term    = make_term_node(102); // load "f" as T
+constexpr Node_kind save_term    = make_term_node(103); // save t to "f"
 constexpr Node_kind prog_term    = make_term_node(500); // t1; ...; tn
 // Types
 constexpr Node_kind kind_type    = make_type_node(1);  // *
@@ -88,28 +93,40 @@ struct Name;
 struct Type;
 struct Term;
 struct Cond;
+struct Index_set;
+struct Code;
 
 // Every distinct phrase in the language is an expression.
 //
 // The expression class also provides a facility for caching the type
 // of the expression. This is generally assigned during elaboration or
 // when nodes are initialized by default.
+//
+// The canonical node of an expression is set when the expression is
+// hash-consed (see make_canonical). The hash is cached in canonical
+// nodes.
 struct Expr : Node { 
   Expr(Node_kind k, Type* t) 
-    : Node(k), tr(t) { }
+    : Node(k), tr(t), canon(nullptr), hc(0) { }
   Expr(Node_kind k, const Location& l, Type* t) 
-    : Node(k, l), tr(t) { }
+    : Node(k, l), tr(t), canon(nullptr), hc(0) { }
   Type* tr;
+  Expr* canon;
+  std::size_t hc;
 };
+template<> struct node_info<Expr> : class_info<name_class, decl_class> { };
 
 // The base class of all identifiers in the language.
 struct Name : Expr { using Expr::Expr; };
+template<> struct node_info<Name> : class_info<name_class> { };
 
 // The base class of all types in the language.
 struct Type : Expr { using Expr::Expr; };
+template<> struct node_info<Type> : class_info<type_class, kind_class> { };
 
 // The base class of all terms in the language.
 struct Term : Expr { using Expr::Expr; };
+template<> struct node_info<Term> : class_info<term_class, decl_class> { };
 
 // A sequence of expressions.
 using Expr_seq = Seq<Expr>;
@@ -136,6 +153,7 @@ struct Id : Name {
 
   String t1;
 };
+template<> struct node_info<Id> : kind_info<id_expr> { };
 
 // -------------------------------------------------------------------------- //
 // Terms
@@ -147,6 +165,7 @@ struct Unit : Term {
   Unit(const Location& l, Type* t) 
     : Term(unit_term, l, t) { }
 };
+template<> struct node_info<Unit> : kind_info<unit_term> { };
 
 // Represents the constant term 'true'.
 struct True : Term {
@@ -155,6 +174,7 @@ struct True : Term {
   True(const Location& l, Type* t) 
     : Term(true_term, l, t) { }
 };
+template<> struct node_info<True> : kind_info<true_term> { };
 
 // Represents the constant term 'false'.
 struct False : Term {
@@ -163,6 +183,7 @@ struct False : Term {
   False(const Location& l, Type* t) 
     : Term(false_term, l, t) { }
 };
+template<> struct node_info<False> : kind_info<false_term> { };
 
 // Represents the conditional term 'if t1 then t2 else t3'.
 struct If : Term {
@@ -179,6 +200,7 @@ struct If : Term {
   Term* t2;
   Term* t3;
 };
+template<> struct node_info<If> : kind_info<if_term> { };
 
 // Represents an integer literal.
 struct Int : Term {
@@ -191,6 +213,7 @@ struct Int : Term {
 
   Integer t1;
 };
+template<> struct node_info<Int> : kind_info<int_term> { };
 
 // Represents the boolean operator term t1 AND t2
 // t1 or t2 has to be type bool
@@ -203,6 +226,7 @@ struct And :Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<And> : kind_info<and_term> { };
 
 // Represents the boolean operator term t1 OR t2
 // t1 or t2 has to be of type bool
@@ -215,6 +239,7 @@ struct Or :Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Or> : kind_info<or_term> { };
 
 // Represents the boolean operator term not t1
 // t1 or t2 has to be of type bool
@@ -226,6 +251,7 @@ struct Not :Term {
 
   Term* t1;
 };
+template<> struct node_info<Not> : kind_info<not_term> { };
 
 // Represents the comparison operator term t1 == t2
 struct Equals :Term {
@@ -237,6 +263,7 @@ struct Equals :Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Equals> : kind_info<equals_term> { };
 
 // Represents the comparison operator term t1 < t2
 struct Less :Term {
@@ -248,6 +275,7 @@ struct Less :Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Less> : kind_info<less_term> { };
 
 // Represents the term 'succ t'.
 struct Succ : Term {
@@ -260,6 +288,7 @@ struct Succ : Term {
 
   Term* t1;
 };
+template<> struct node_info<Succ> : kind_info<succ_term> { };
 
 // Represents the term 'pred t'.
 struct Pred : Term {
@@ -272,6 +301,7 @@ struct Pred : Term {
 
   Term* t1;
 };
+template<> struct node_info<Pred> : kind_info<pred_term> { };
 
 // Represents the term 'iszero t'.
 struct Iszero : Term {
@@ -284,6 +314,7 @@ struct Iszero : Term {
 
   Term* t1;
 };
+template<> struct node_info<Iszero> : kind_info<iszero_term> { };
 
 // Represents the string literal "...", a sequence of characters
 // enclosed in quotes.
@@ -297,6 +328,7 @@ struct Str : Term {
 
   String t1;
 };
+template<> struct node_info<Str> : kind_info<str_term> { };
 
 // A variable declaration of the form 'x : T' in a lambda
 // abstraction. 
@@ -312,37 +344,54 @@ struct Var : Term {
   Name* t1;
   Type* t2;
 };
+template<> struct node_info<Var> : kind_info<var_term> { };
 
 // A lambda abstraction over a term, having the form '\v.t' where 'v' 
 // is a variable declaration and 't' is the abstracted term.
+//
+// t3 owns the code of the abstraction compiled by the virtual machine,
+// which is compiled on first use. Copies do not share the code.
 struct Abs : Term {
   Abs(Type* t0, Term* x, Term* t)
-    : Term(abs_term, t0), t1(x), t2(t) { }
+    : Term(abs_term, t0), t1(x), t2(t), t3(nullptr) { }
   Abs(const Location& l, Type* t0, Term* x, Term* t) 
-    : Term(abs_term, l, t0), t1(x), t2(t) { }
+    : Term(abs_term, l, t0), t1(x), t2(t), t3(nullptr) { }
+  Abs(const Abs& a)
+    : Term(a), t1(a.t1), t2(a.t2), t3(nullptr) { }
+  ~Abs();
 
   Term* var() const { return t1; }
   Term* term() const { return t2; }
+  Code* code() const { return t3; }
 
   Term* t1;
   Term* t2;
+  Code* t3;
 };
+template<> struct node_info<Abs> : kind_info<abs_term> { };
 
 // A function of the form '\(v1, ..., vn).t' where 'vi' is a
 // variable declaration and 't' is the abstracted term. Unlike
 // an abstraction, a function can be called with many arguments.
+// Like an abstraction, t3 owns its compiled code.
 struct Fn : Term {
   Fn(Type* t0, Term_seq* ps, Term* t)
-    : Term(fn_term, t0), t1(ps), t2(t) { }
+    : Term(fn_term, t0), t1(ps), t2(t), t3(nullptr) { }
   Fn(const Location& l, Type* t0, Term_seq* ps, Term* t) 
-    : Term(fn_term, l, t0), t1(ps), t2(t) { }
+    : Term(fn_term, l, t0), t1(ps), t2(t), t3(nullptr) { }
+  Fn(const Fn& f)
+    : Term(f), t1(f.t1), t2(f.t2), t3(nullptr) { }
+  ~Fn();
 
   Term_seq* parms() const { return t1; }
   Term* term() const { return t2; }
+  Code* code() const { return t3; }
 
   Term_seq* t1;
   Term* t2;
+  Code* t3;
 };
+template<> struct node_info<Fn> : kind_info<fn_term> { };
 
 // An application of an abstraction to a term, having the form 't1 t2' 
 // where 't1' is the abstraction and 't2' is the argument.
@@ -358,6 +407,7 @@ struct App : Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<App> : kind_info<app_term> { };
 
 // A function call of the form 't(t1, ..., tn)' where 't' is a 
 // function (not an abstraction) and each 'ti' is an argument.
@@ -373,24 +423,31 @@ struct Call : Term {
   Term* t1;
   Term_seq* t2;
 };
+template<> struct node_info<Call> : kind_info<call_term> { };
 
 
 // A definition of the form 'def n = t'.
 //
 // TODO: Refactor this so that the 'n=t' part is an init
 // expression (see below);
+//
+// When the defined value is a table, t3 caches the indexes that have
+// been built on its columns. Indexes are built on first use.
 struct Def : Term {
   Def(Type* t, Name* n, Expr* v)
-    : Term(def_term, t), t1(n), t2(v) { }
+    : Term(def_term, t), t1(n), t2(v), t3(nullptr) { }
   Def(const Location& l ,Type* t, Name* n, Expr* v)
-    : Term(def_term, l, t), t1(n), t2(v) { }
+    : Term(def_term, l, t), t1(n), t2(v), t3(nullptr) { }
 
   Name* name() const { return t1; }
   Expr* value() const { return t2; }
+  Index_set* indexes() const { return t3; }
 
   Name* t1;
   Expr* t2;
+  Index_set* t3;
 };
+template<> struct node_info<Def> : kind_info<def_term> { };
 
 // An initializer term of the form 'n = t' where 'n' is a name
 // and 't' is the value that name takes on.
@@ -406,6 +463,7 @@ struct Init : Term {
   Name* t1;
   Expr* t2;
 };
+template<> struct node_info<Init> : kind_info<init_term> { };
 
 // A tuple of the form '{t1, ..., tn}' where each 'ti' is a term.
 struct Tuple : Term {
@@ -418,6 +476,7 @@ struct Tuple : Term {
 
   Term_seq* t1;
 };
+template<> struct node_info<Tuple> : kind_info<tuple_term> { };
 
 // A list of the form '[t1, ..., tn]' where each 'ti' is a term.
 struct List : Term {
@@ -430,6 +489,7 @@ struct List : Term {
 
   Term_seq* t1;
 };
+template<> struct node_info<List> : kind_info<list_term> { };
 
 // A record of the form '{n1=t1, ..., nn=tn}' where each ti is
 // a initializer. Note that each subterm is an Init term.
@@ -446,6 +506,7 @@ struct Record : Term {
 
   Term_seq* t1;
 };
+template<> struct node_info<Record> : kind_info<record_term> { };
 
 // A comma term of the form '(e1, ..., en)' is simply a sequence
 // of expressions. These are used internally to represent
@@ -460,6 +521,7 @@ struct Comma : Term {
 
   Expr_seq* t1;
 };
+template<> struct node_info<Comma> : kind_info<comma_term> { };
 
 // A projection of an element in a tuple.
 struct Proj : Term {
@@ -474,6 +536,7 @@ struct Proj : Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Proj> : kind_info<proj_term> { };
 
 // A projection of a field of a record.
 struct Mem : Term {
@@ -488,6 +551,7 @@ struct Mem : Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Mem> : kind_info<mem_term> { };
 
 // A column projection for a table
 struct Col : Term {
@@ -502,20 +566,30 @@ struct Col : Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Col> : kind_info<col_term> { };
 
 // Represefnts a reference to a declared entity in the program 
 // (e.g., a variable, function, etc). Note that the type of the
 // reference is the same as that of its referred-to expression.
+//
+// When the declaration is a parameter of an enclosing function, depth
+// is the number of functions between the reference and that function,
+// and slot is the position of the parameter. Otherwise, depth is -1.
 struct Ref : Term {
   Ref(Expr* e)
-    : Term(ref_term, e->tr), t1(e) { }
+    : Term(ref_term, e->tr), t1(e), depth(-1), slot(0) { }
   Ref(const Location& l, Expr* e)
-    : Term(ref_term, l, e->tr), t1(e) { }
+    : Term(ref_term, l, e->tr), t1(e), depth(-1), slot(0) { }
+  Ref(const Location& l, Expr* e, int d, int s)
+    : Term(ref_term, l, e->tr), t1(e), depth(d), slot(s) { }
 
   Expr* decl() const { return t1; }
 
   Expr* t1;
+  int depth;
+  int slot;
 };
+template<> struct node_info<Ref> : kind_info<ref_term> { };
 
 // Prints an expression to the terminal.
 struct Print : Term {
@@ -528,6 +602,38 @@ struct Print : Term {
 
   Expr* t1;
 };
+template<> struct node_info<Print> : kind_info<print_term> { };
+
+// Loads a table from the file t1. The rows of the table have the
+// record type t2, whose members name the columns of the file.
+struct Load : Term {
+  Load(Type* t, Term* t1, Type* t2)
+    : Term(load_term, t), t1(t1), t2(t2) { }
+  Load(const Location& l, Type* t, Term* t1, Type* t2)
+    : Term(load_term, l, t), t1(t1), t2(t2) { }
+
+  Term* file() const { return t1; }
+  Type* row_type() const { return t2; }
+
+  Term* t1;
+  Type* t2;
+};
+template<> struct node_info<Load> : kind_info<load_term> { };
+
+// Saves the table t1 to the file t2.
+struct Save : Term {
+  Save(Type* t, Term* t1, Term* t2)
+    : Term(save_term, t), t1(t1), t2(t2) { }
+  Save(const Location& l, Type* t, Term* t1, Term* t2)
+    : Term(save_term, l, t), t1(t1), t2(t2) { }
+
+  Term* table() const { return t1; }
+  Term* file() const { return t2; }
+
+  Term* t1;
+  Term* t2;
+};
+template<> struct node_info<Save> : kind_info<save_term> { };
 
 // A program is a sequence of terms called statements.
 struct Prog : Term {
@@ -538,26 +644,56 @@ struct Prog : Term {
 
   Term_seq* t1;
 };
+template<> struct node_info<Prog> : kind_info<prog_term> { };
 
-// select t1 from t2 where t3
-// t1 is a Comma term where each subterm is a Name
+// select t1 from t2 where t3 group by t4
+// t1 is a Comma term where each subterm is a Name or an Aggregate
 // t2 is a Table term
 // t3 is anything that has type bool. Most commonly a term like and, or, equals, less, not
+// t4 is a Comma term where each subterm is a Name, or null when there
+// is no group by clause
 struct Select_from_where : Term {
-  Select_from_where(Type* t, Term* t1, Term* t2, Term* t3)
-    : Term(select_term, t), t1(t1), t2(t2), t3(t3) { }
-  Select_from_where(const Location& l, Type* t, Term* t1, Term* t2, Term* t3)
-    : Term(select_term, l, t), t1(t1), t2(t2), t3(t3) { }
+  Select_from_where(Type* t, Term* t1, Term* t2, Term* t3, Term* t4)
+    : Term(select_term, t), t1(t1), t2(t2), t3(t3), t4(t4) { }
+  Select_from_where(const Location& l, Type* t, Term* t1, Term* t2, Term* t3, Term* t4)
+    : Term(select_term, l, t), t1(t1), t2(t2), t3(t3), t4(t4) { }
 
   Term* projection_list() const { return t1; }
   Term* table() const { return t2; }
   Term* cond() const { return t3; }
+  Term* group_list() const { return t4; }
 
   Term* t1;
   Term* t2;
   Term* t3;
+  Term* t4;
+};
+template<> struct node_info<Select_from_where> : kind_info<select_term> { };
+
+// The aggregate functions of a select statement.
+enum Aggregate_op {
+  count_agg, // The number of rows
+  sum_agg,   // The sum of a Nat column
+  min_agg,   // The least value of a column
+  max_agg    // The greatest value of a column
 };
 
+// A term of form 'f t' where f is an aggregate function and t is a
+// column of the table of a select statement. The aggregate is computed
+// over the rows of each group.
+struct Aggregate : Term {
+  Aggregate(Type* t, Aggregate_op op, Term* t1)
+    : Term(aggregate_term, t), op(op), t1(t1) { }
+  Aggregate(const Location& l, Type* t, Aggregate_op op, Term* t1)
+    : Term(aggregate_term, l, t), op(op), t1(t1) { }
+
+  Term* arg() const { return t1; }
+
+  Aggregate_op op;
+  Term* t1;
+};
+template<> struct node_info<Aggregate> : kind_info<aggregate_term> { };
+
 // A term of form t1 join t2 on t3
 // Evaluates to be a table
 // t1 and t2 must have type table
@@ -576,6 +712,7 @@ struct Join : Term {
   Term* t2;
   Term* t3;
 };
+template<> struct node_info<Join> : kind_info<join_on_term> { };
 
 // t1 union t2
 // t1 and t2 is either a set, tuple, or table
@@ -588,6 +725,7 @@ struct Union: Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Union> : kind_info<union_term> { };
 
 // t1 intersect t2 
 // t1 and t2 is either a set, tuple, or table
@@ -600,6 +738,7 @@ struct Intersect : Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Intersect> : kind_info<intersect_term> { };
 
 // t1 except t2
 // t1 and t2 either a set, tuple, or table
@@ -612,6 +751,7 @@ struct Except : Term {
   Term* t1;
   Term* t2;
 };
+template<> struct node_info<Except> : kind_info<except_term> { };
 
 // -------------------------------------------------------------------------- //
 // Types
@@ -623,6 +763,7 @@ struct Kind_type : Type {
   Kind_type(const Location& l)
     : Type(kind_type, l, nullptr) { }
 };
+template<> struct node_info<Kind_type> : kind_info<kind_type> { };
 
 // Represents the unit type.
 struct Unit_type : Type {
@@ -631,6 +772,7 @@ struct Unit_type : Type {
   Unit_type(const Location& l, Type* k)
     : Type(unit_type, l, k) { }
 };
+template<> struct node_info<Unit_type> : kind_info<unit_type> { };
 
 // Represents the bool type.
 struct Bool_type : Type {
@@ -639,6 +781,7 @@ struct Bool_type : Type {
   Bool_type(const Location& l, Type* k) 
     : Type(bool_type, l, k) { }
 };
+template<> struct node_info<Bool_type> : kind_info<bool_type> { };
 
 // Represents the nat type.
 struct Nat_type : Type {
@@ -647,6 +790,7 @@ struct Nat_type : Type {
   Nat_type(const Location& l, Type* k)
     : Type(nat_type, l, k) { }
 };
+template<> struct node_info<Nat_type> : kind_info<nat_type> { };
 
 // Represents the type of string vales.
 struct Str_type : Type {
@@ -655,6 +799,7 @@ struct Str_type : Type {
   Str_type(const Location& l, Type* k)
     : Type(str_type, l, k) { }
 };
+template<> struct node_info<Str_type> : kind_info<str_type> { };
 
 // An arrow type of the form 'T1->T2'.
 struct Arrow_type : Type {
@@ -669,6 +814,7 @@ struct Arrow_type : Type {
   Type* t1;
   Type* t2;
 };
+template<> struct node_info<Arrow_type> : kind_info<arrow_type> { };
 
 // A function type of the form '(T1, ..., Tn) -> T'.
 struct Fn_type : Type {
@@ -683,6 +829,7 @@ struct Fn_type : Type {
   Type_seq* t1;
   Type* t2;
 };
+template<> struct node_info<Fn_type> : kind_info<fn_type> { };
 
 // The type of a tuple has the form '{T1, ..., Tn}'.
 struct Tuple_type : Type {
@@ -695,6 +842,7 @@ struct Tuple_type : Type {
 
   Type_seq* t1;
 };
+template<> struct node_info<Tuple_type> : kind_info<tuple_type> { };
 
 // The type of a list has the form [T].
 struct List_type : Type {
@@ -707,6 +855,7 @@ struct List_type : Type {
 
   Type* t1;
 };
+template<> struct node_info<List_type> : kind_info<list_type> { };
 
 // The type of a record has the form '{n1:T1, ..., nn:Tn}' 
 // where each ni:Ti is a member variable.
@@ -722,6 +871,7 @@ struct Record_type : Type {
 
   Term_seq* t1;
 };
+template<> struct node_info<Record_type> : kind_info<record_type> { };
 
 // A wildcard type of the form '*x:T' where 'x' is the name of the
 // the wildcard and T is its type. Wildcard types are used to represent
@@ -741,12 +891,25 @@ struct Wild_type : Type {
   Type_seq* attr() const { return schema; }
   Type_seq* schema;
 };
+template<> struct node_info<Wild_type> : kind_info<wild_type> { };
 
 
 // -------------------------------------------------------------------------- //
 // Properties
 
 int size(Term*);
+std::size_t hash_value(Expr*);
+
+// Hash-consing
+Expr* make_canonical(Expr*);
+
+// Returns the canonical node of e, which has the same kind as e.
+template<typename T>
+  inline T*
+  make_canonical(T* e) { return static_cast<T*>(make_canonical(static_cast<Expr*>(e))); }
+
+// Evacuation
+Expr* evacuate(Expr*, const Arena&);
 
 // Relations
 bool is_same(Expr*, Expr*);
@@ -759,6 +922,17 @@ struct Expr_eq {
   bool operator()(Expr* e1, Expr* e2) const { return is_same(e1, e2); }
 };
 
+// Mix the hash value h into the seed.
+inline std::size_t
+hash_combine(std::size_t seed, std::size_t h) {
+  return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+// A hash function on expressions that is consistent with is_same.
+struct Expr_hash {
+  std::size_t operator()(Expr* e) const { return hash_value(e); }
+};
+
 // A strict weak order on expressions.
 struct Expr_less {
   bool operator()(Expr* e1, Expr* e2) const { return is_less(e1, e2); }
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "language.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "syntax.hpp"
+#include "elab.hpp"
+#include "ast.hpp"
+#include "eval.hpp"
+#include "vm.hpp"
+#include "load.hpp"
+
+// This program compares the running times of the evaluator and the
+// virtual machine. Each program named on the command line is run by
+// both, as are several generated programs. The result of each run
+// must be the same for both.
+//
+//    waffle-bench [-n reps] file...
+//
+// Each program is elaborated anew before each run, and only its
+// evaluation is timed. Printed output is discarded.
+
+namespace {
+
+// A program to run, given by its name and text.
+struct Program {
+  std::string name;
+  std::string text;
+};
+
+// Returns the elaborated program of the given text, or nullptr if the
+// program is ill-formed.
+Term*
+elaborate(const std::string& text) try {
+  Lexer lex;
+  Tokens toks = lex(text);
+  if (not lex.diags.empty())
+    return nullptr;
+  Parser parse;
+  Tree* tree = parse(toks);
+  if (not parse.diags.empty())
+    return nullptr;
+  Elaborator elab;
+  Expr* prog = elab(tree);
+  if (not elab.diags.empty())
+    return nullptr;
+  return as<Term>(prog);
+} catch (std::runtime_error&) {
+  return nullptr;
+}
+
+// The result and running time of one engine on a program.
+struct Timing {
+  std::string result;
+  double ms = 0;
+  bool ok = true;
+};
+
+// Run the program n times with the engine f, returning the result of
+// the last run and the total time. A run that fails produces its
+// error as its result.
+template<typename F>
+  Timing
+  time_runs(const Program& p, int n, F&& f) {
+    Timing t;
+    for (int i = 0; i < n; ++i) {
+      Term* prog = elaborate(p.text);
+      if (not prog) {
+        t.ok = false;
+        return t;
+      }
+      std::ostringstream out;
+      std::streambuf* buf = std::cout.rdbuf(out.rdbuf());
+      auto start = std::chrono::steady_clock::now();
+      std::stringstream ss;
+      try {
+        if (Term* result = f(prog))
+          ss << pretty(result);
+      } catch (std::runtime_error& err) {
+        ss << "error: " << err.what();
+      }
+      auto stop = std::chrono::steady_clock::now();
+      std::cout.rdbuf(buf);
+      t.ms += std::chrono::duration<double, std::milli>(stop - start).count();
+      t.result = out.str() + ss.str();
+    }
+    return t;
+  }
+
+// Returns a program whose calls form a binary tree of the given depth.
+// Each function calls the one below it twice.
+Program
+make_calls(int depth) {
+  std::stringstream ss;
+  ss << "def f0 = \\(a:Bool, b:Bool) => if a then b else not b;\n";
+  for (int i = 1; i <= depth; ++i)
+    ss << "def f" << i << " = \\(a:Bool, b:Bool) => "
+       << "f" << i - 1 << "(b, a) and f" << i - 1 << "(a, not b);\n";
+  ss << "f" << depth << "(true, false);\n";
+  return {"calls-" + std::to_string(depth), ss.str()};
+}
+
+// Write a balanced condition of the given depth over the parameters
+// x and y of a function.
+void
+write_condition(std::ostream& os, int depth, int& n) {
+  if (depth == 0) {
+    os << "(if x eq " << n++ % 4 << " then iszero y else y eq x)";
+    return;
+  }
+  os << (depth % 2 ? "(" : "(not ");
+  write_condition(os, depth - 1, n);
+  os << (depth % 2 ? " or " : " and ");
+  write_condition(os, depth - 1, n);
+  os << ")";
+}
+
+// Returns a program that calls a function with a large condition
+// for each pair of arguments.
+Program
+make_conditions(int depth, int calls) {
+  std::stringstream ss;
+  int n = 0;
+  ss << "def g = \\(x:Nat, y:Nat) => ";
+  write_condition(ss, depth, n);
+  ss << ";\n";
+  for (int i = 0; i < calls; ++i)
+    ss << "print g(" << i % 5 << ", " << i % 3 << ");\n";
+  ss << "g(1, 0);\n";
+  return {"conditions-" + std::to_string(depth), ss.str()};
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[]) {
+  Language lang;
+
+  int reps = 10;
+  std::vector<Program> progs;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-n" and i + 1 < argc) {
+      reps = std::max(std::atoi(argv[++i]), 1);
+      continue;
+    }
+    std::ifstream f(arg);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    progs.push_back({arg, ss.str()});
+  }
+  progs.push_back(make_calls(12));
+  progs.push_back(make_calls(16));
+  progs.push_back(make_conditions(8, 200));
+  progs.push_back(make_conditions(12, 200));
+
+  std::cout << std::left << std::setw(32) << "program"
+            << std::right << std::setw(12) << "eval (ms)"
+            << std::setw(12) << "vm (ms)"
+            << std::setw(10) << "speedup" << '\n';
+  int status = 0;
+  for (const Program& p : progs) {
+    Timing e = time_runs(p, reps, Evaluator());
+    Timing v = time_runs(p, reps, Machine());
+    std::cout << std::left << std::setw(32) << p.name << std::right;
+    if (not e.ok or not v.ok) {
+      std::cout << "  ill-formed\n";
+      continue;
+    }
+    std::cout << std::fixed << std::setprecision(2)
+              << std::setw(12) << e.ms
+              << std::setw(12) << v.ms
+              << std::setw(9) << e.ms / v.ms << "x";
+    if (e.result != v.result) {
+      std::cout << "  results differ";
+      status = 1;
+    }
+    std::cout << '\n';
+  }
+  return status;
+}
@@ -0,0 +1,329 @@
+#include "ast.hpp"
+#include "type.hpp"
+
+#include "lang/debug.hpp"
+
+#include <mutex>
+#include <unordered_set>
+
+// -------------------------------------------------------------------------- //
+// Hash-consing
+//
+// Values and types are hash-consed: for each class of expressions
+// related by is_same, there is a single canonical node. Once a node
+// has been canonicalized, it refers to its canonical node, whose hash
+// value is cached. Two canonicalized nodes are the same exactly when
+// they refer to the same canonical node, and the hash of either is
+// that of its canonical node.
+//
+// The subterms of a canonical node are canonical. Hashing or comparing
+// a node whose subterms have been canonicalized therefore only looks
+// at the node itself, not the entire tree.
+//
+// Canonical nodes live for the rest of the program, so they are
+// allocated by new. A node allocated in the caller's arena is copied
+// before it becomes canonical, since the arena may be released.
+//
+// Values are canonicalized by the set operations, which may run on
+// several threads at once (see morsel.hpp). The set of canonical nodes
+// is divided into shards, chosen by the hash of a node, and each shard
+// is locked while it is searched or updated. A node is made canonical
+// under the lock of its shard, so each class has a single canonical
+// node even when two threads canonicalize equal values. A node shared
+// between threads may be canonicalized by both, and both then set it
+// to refer to the same canonical node.
+
+namespace {
+
+// The current arena of the caller of make_canonical on this thread.
+thread_local Arena* caller_arena_ = nullptr;
+
+// Returns true when n is allocated in the caller's arena.
+inline bool
+is_temporary(const Node* n) { return caller_arena_ and caller_arena_->owns(n); }
+
+// A hash function on canonical nodes, which returns the cached hash.
+struct Canon_hash {
+  std::size_t operator()(Expr* e) const { return e->hc; }
+};
+
+using Canon_set = std::unordered_set<Expr*, Canon_hash, Expr_eq>;
+
+// A shard of the set of canonical nodes.
+struct Canon_shard {
+  Expr* find(Expr*);
+  Expr* insert(Expr*);
+
+  std::mutex mutex;
+  Canon_set set;
+};
+
+// Returns the canonical node equal to the candidate c, or nullptr if
+// there is none.
+Expr*
+Canon_shard::find(Expr* c) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto iter = set.find(c);
+  return iter == set.end() ? nullptr : *iter;
+}
+
+// Returns the canonical node equal to the candidate c. When there is
+// none, c becomes the canonical node of its class.
+Expr*
+Canon_shard::insert(Expr* c) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto iter = set.find(c);
+  if (iter != set.end())
+    return *iter;
+  c->canon = c;
+  set.insert(c);
+  return c;
+}
+
+// The number of shards is a power of two. The low bits of a hash
+// select the shard.
+constexpr std::size_t canon_shard_count = 64;
+
+// Returns the shard of the canonical nodes whose hash is h.
+Canon_shard&
+get_canon_shard(std::size_t h) {
+  static Canon_shard shards[canon_shard_count];
+  return shards[h & (canon_shard_count - 1)];
+}
+
+Expr* canonicalize(Expr*);
+
+// Returns the canonical node of e, when e is a name, type, or term,
+// or nullptr otherwise.
+template<typename T>
+  inline T*
+  canonicalize_as(T* e) {
+    return static_cast<T*>(canonicalize(e));
+  }
+
+// Canonicalize each element of s. Returns s when each element is its
+// own canonical node and s is not temporary, a new sequence of
+// canonical nodes otherwise, or nullptr when some element cannot be
+// made canonical.
+template<typename T>
+  Seq<T>*
+  canonicalize_seq(Seq<T>* s) {
+    Seq<T>* r = is_temporary(s) ? make<Seq<T>>() : nullptr;
+    for (std::size_t i = 0; i < s->size(); ++i) {
+      T* c = canonicalize_as((*s)[i]);
+      if (not c)
+        return nullptr;
+      if (c != (*s)[i] and not r) {
+        r = make<Seq<T>>();
+        r->assign(s->begin(), s->begin() + i);
+      }
+      if (r)
+        r->push_back(c);
+    }
+    return r ? r : s;
+  }
+
+// Returns a node like e whose subterms are canonical, or nullptr
+// when e has a subterm that cannot be made canonical. The result is
+// e itself when its subterms are already canonical.
+Expr*
+make_candidate(Expr* e) {
+  switch (e->kind) {
+  case id_expr:
+  case unit_term:
+  case true_term:
+  case false_term:
+  case int_term:
+  case str_term:
+  case kind_type:
+  case unit_type:
+  case bool_type:
+  case nat_type:
+  case str_type:
+    return e;
+
+  case var_term: {
+    Var* v = as<Var>(e);
+    Name* n = canonicalize_as(v->name());
+    Type* t = canonicalize_as(v->type());
+    if (not n or not t)
+      return nullptr;
+    if (n == v->name() and t == v->type())
+      return e;
+    return make<Var>(n, t);
+  }
+
+  case init_term: {
+    Init* i = as<Init>(e);
+    Name* n = canonicalize_as(i->name());
+    Expr* v = canonicalize(i->value());
+    if (not n or not v)
+      return nullptr;
+    if (n == i->name() and v == i->value())
+      return e;
+    return make<Init>(get_type(i), n, v);
+  }
+
+  case tuple_term: {
+    Tuple* t = as<Tuple>(e);
+    Term_seq* s = canonicalize_seq(t->elems());
+    if (not s)
+      return nullptr;
+    return s == t->elems() ? e : make<Tuple>(get_type(t), s);
+  }
+
+  case list_term: {
+    List* l = as<List>(e);
+    Term_seq* s = canonicalize_seq(l->elems());
+    if (not s)
+      return nullptr;
+    return s == l->elems() ? e : make<List>(get_type(l), s);
+  }
+
+  case record_term: {
+    Record* r = as<Record>(e);
+    Term_seq* s = canonicalize_seq(r->members());
+    if (not s)
+      return nullptr;
+    return s == r->members() ? e : make<Record>(get_type(r), s);
+  }
+
+  case arrow_type: {
+    Arrow_type* t = as<Arrow_type>(e);
+    Type* t1 = canonicalize_as(t->t1);
+    Type* t2 = canonicalize_as(t->t2);
+    if (not t1 or not t2)
+      return nullptr;
+    if (t1 == t->t1 and t2 == t->t2)
+      return e;
+    return make<Arrow_type>(get_type(t), t1, t2);
+  }
+
+  case fn_type: {
+    Fn_type* t = as<Fn_type>(e);
+    Type_seq* s = canonicalize_seq(t->parms());
+    Type* r = canonicalize_as(t->result());
+    if (not s or not r)
+      return nullptr;
+    if (s == t->parms() and r == t->result())
+      return e;
+    return make<Fn_type>(get_type(t), s, r);
+  }
+
+  case tuple_type: {
+    Tuple_type* t = as<Tuple_type>(e);
+    Type_seq* s = canonicalize_seq(t->types());
+    if (not s)
+      return nullptr;
+    return s == t->types() ? e : make<Tuple_type>(get_type(t), s);
+  }
+
+  case record_type: {
+    Record_type* t = as<Record_type>(e);
+    Term_seq* s = canonicalize_seq(t->members());
+    if (not s)
+      return nullptr;
+    return s == t->members() ? e : make<Record_type>(get_type(t), s);
+  }
+
+  case list_type: {
+    List_type* t = as<List_type>(e);
+    Type* t1 = canonicalize_as(t->type());
+    if (not t1)
+      return nullptr;
+    return t1 == t->type() ? e : make<List_type>(get_type(t), t1);
+  }
+
+  default:
+    break;
+  }
+  return nullptr;
+}
+
+// Returns a copy of the node e, which is a candidate returned by
+// make_candidate.
+template<typename T>
+  inline Expr*
+  copy_node(Expr* e) { return make<T>(*static_cast<T*>(e)); }
+
+Expr*
+copy_candidate(Expr* e) {
+  switch (e->kind) {
+  case id_expr: return copy_node<Id>(e);
+  case unit_term: return copy_node<Unit>(e);
+  case true_term: return copy_node<True>(e);
+  case false_term: return copy_node<False>(e);
+  case int_term: return copy_node<Int>(e);
+  case str_term: return copy_node<Str>(e);
+  case var_term: return copy_node<Var>(e);
+  case init_term: return copy_node<Init>(e);
+  case tuple_term: return copy_node<Tuple>(e);
+  case list_term: return copy_node<List>(e);
+  case record_term: return copy_node<Record>(e);
+  case kind_type: return copy_node<Kind_type>(e);
+  case unit_type: return copy_node<Unit_type>(e);
+  case bool_type: return copy_node<Bool_type>(e);
+  case nat_type: return copy_node<Nat_type>(e);
+  case str_type: return copy_node<Str_type>(e);
+  case arrow_type: return copy_node<Arrow_type>(e);
+  case fn_type: return copy_node<Fn_type>(e);
+  case tuple_type: return copy_node<Tuple_type>(e);
+  case list_type: return copy_node<List_type>(e);
+  case record_type: return copy_node<Record_type>(e);
+  default: break;
+  }
+  lang_unreachable(format("copying non-canonical node '{}'", node_name(e)));
+}
+
+// Returns the canonical node of e, or nullptr if e cannot be made
+// canonical.
+Expr*
+canonicalize(Expr* e) {
+  if (not e)
+    return nullptr;
+  if (e->canon)
+    return e->canon;
+  Expr* c = make_candidate(e);
+  if (not c)
+    return nullptr;
+
+  // The subterms of c are canonical, so its hash and comparison only
+  // visit c itself.
+  c->hc = hash_value(c);
+  Canon_shard& s = get_canon_shard(c->hc);
+  if (Expr* k = s.find(c)) {
+    e->canon = k;
+    return k;
+  }
+
+  // Only a node that is its own candidate can be temporary. The type
+  // of the new canonical node is made canonical as well, so that it
+  // does not refer to a temporary type. This is done without holding
+  // the lock, since the type may belong to the same shard. Another
+  // thread may insert an equal node in the meantime, in which case
+  // that node is canonical instead.
+  if (is_temporary(c))
+    c = copy_candidate(c);
+  if (Type* t = canonicalize_as(c->tr))
+    c->tr = t;
+  e->canon = s.insert(c);
+  return e->canon;
+}
+
+} // namespace
+
+// Returns the canonical node of e. When e is not a value or a type,
+// or has a subterm that is not, e has no canonical node and is
+// returned unchanged.
+//
+// Afterwards, e refers to its canonical node, so that comparing and
+// hashing e take constant time.
+Expr*
+make_canonical(Expr* e) {
+  Arena* prev = caller_arena_;
+  caller_arena_ = get_arena();
+  Arena_scope scope(nullptr);
+  Expr* c = canonicalize(e);
+  caller_arena_ = prev;
+  return c ? c : e;
+}
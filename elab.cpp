@@ -41,7 +41,7 @@ template<typename C, typename T>
 Name*
 elab_name(Id_tree* t) {
   const Token* tok = t->value();
-  return new Id(t->loc, tok->text);
+  return make<Id>(t->loc, tok->text);
 }
 
 // Create an id from a parse tree representing a name.
@@ -65,8 +65,12 @@ elab_type(Tree* t) {
     if (Def* def = as<Def>(ref->decl()))
       e = def->value();
 
-  if (Type* type = as<Type>(e))
+  // Hash-cons the type so that it can be compared with others in
+  // constant time. The type itself keeps its location.
+  if (Type* type = as<Type>(e)) {
+    make_canonical(type);
     return type;
+  }
   
   error(t->loc) << format("expression '{}' does not name a type", pretty(t));
   return nullptr;
@@ -96,12 +100,14 @@ elab_term(Tree* t) {
 //    G |- n : T
 //
 // The result of an elaborated id is a reference to its declaring
-// expression.
+// expression. A reference to a parameter also records where the
+// evaluator finds its argument.
 Expr*
 elab_id(Id_tree* t) { 
   Name* name = elab_name(t);
-  if (Expr* decl = lookup(name))
-    return new Ref(t->loc, decl);
+  int depth, slot;
+  if (Expr* decl = lookup(name, depth, slot))
+    return make<Ref>(t->loc, decl, depth, slot);
   else
     error(t->loc) << format("no matching declaration for '{}'", pretty(name));
   return nullptr; 
@@ -130,21 +136,23 @@ elab_lit(Lit_tree* t) {
   const Token* k = t->value();
   switch (k->kind) {
   case unit_tok: 
-    return new Unit(t->loc, get_unit_type());
+    return make<Unit>(t->loc, get_unit_type());
   case true_tok: 
-    return new True(t->loc, get_bool_type());
+    return make<True>(t->loc, get_bool_type());
   case false_tok: 
-    return new False(t->loc, get_bool_type());
+    return make<False>(t->loc, get_bool_type());
   case decimal_literal_tok: 
-    return new Int(t->loc, get_nat_type(), as_integer(*k));
+    return make<Int>(t->loc, get_nat_type(), as_integer(*k));
   case string_literal_tok:
-    return new Str(t->loc, get_str_type(), as_string(*k));
+    return make<Str>(t->loc, get_str_type(), as_string(*k));
   case unit_type_tok: 
-    return new Unit_type(t->loc, get_kind_type());
+    return make<Unit_type>(t->loc, get_kind_type());
   case bool_type_tok: 
-    return new Bool_type(t->loc, get_kind_type());
+    return make<Bool_type>(t->loc, get_kind_type());
   case nat_type_tok: 
-    return new Nat_type(t->loc, get_kind_type());
+    return make<Nat_type>(t->loc, get_kind_type());
+  case str_type_tok: 
+    return make<Str_type>(t->loc, get_kind_type());
   default: 
     break;
   }
@@ -170,7 +178,7 @@ elab_def(Def_tree* t) {
 
   // The type is deduced from the value.
   Type* type = get_type(value);
-  Def* def = new Def(t->loc, type, name, value);
+  Def* def = make<Def>(t->loc, type, name, value);
   return declare(def);
 }
 
@@ -188,7 +196,7 @@ elab_init(Init_tree* t) {
   if (not name)
     return nullptr;
   Type* type = get_type(term);
-  return new Init(t->loc, type, name, term);
+  return make<Init>(t->loc, type, name, term);
 }
 
 // Elaborate a variable declared as part of a lambda expression.
@@ -209,7 +217,7 @@ elab_var(Var_tree* t) {
     return nullptr;
 
   // Create and declare the parameter.
-  Var* var = new Var(t->loc, name, type);
+  Var* var = make<Var>(t->loc, name, type);
   return declare(var);
 }
 
@@ -234,10 +242,10 @@ elab_abs(Abs_tree* t) {
   Type* kind = get_kind_type();
   Type* t0 = get_type(var);
   Type* u0 = get_type(term);
-  Type* type = new Arrow_type(no_location, kind, t0, u0);
+  Type* type = make<Arrow_type>(no_location, kind, t0, u0);
 
   // Create the abstraction.
-  return new Abs(t->loc, type, var, term);
+  return make<Abs>(t->loc, type, var, term);
 }
 
 // Elaborate an anonymous multi-parameter function.
@@ -254,7 +262,7 @@ elab_fn(Fn_tree* t) {
 
   // Elaborate the parameters and the abstracted term. Note that
   // each paramteer is declared as it is elaborated.
-  Term_seq* parms = new Term_seq();
+  Term_seq* parms = make<Term_seq>();
   for (Tree *t0 : *t->parms()) {
     Term* t1 = elab_term(t0);
     if (not t1)
@@ -273,10 +281,10 @@ elab_fn(Fn_tree* t) {
   Type* kind = get_kind_type();
   Type_seq* t0 = get_type(parms);
   Type* u0 = get_type(term);
-  Type* type = new Fn_type(no_location, kind, t0, u0);
+  Type* type = make<Fn_type>(no_location, kind, t0, u0);
 
   // Create the abstraction.
-  return new Fn(t->loc, type, parms, term);
+  return make<Fn>(t->loc, type, parms, term);
 }
 
 
@@ -302,13 +310,13 @@ elab_app(App_tree* t, Term* fn, Term* arg, Arrow_type* fn_type) {
 
   // Build the application.
   Type* result_type = fn_type->result();
-  return new App(t->loc, result_type, fn, arg);
+  return make<App>(t->loc, result_type, fn, arg);
 }
 
 // Create a list of arguments from a list of elaborated expresions.
 Term_seq*
 make_args(Expr_seq* es) {
-  Term_seq* ts = new Term_seq();
+  Term_seq* ts = make<Term_seq>();
   for (Expr* e : *es) {
     if (Term* t = as<Term>(e)) {
       ts->push_back(t);
@@ -323,7 +331,7 @@ make_args(Expr_seq* es) {
 // Create a singleton list of arguments.
 Term_seq*
 make_args(Term* arg) {
-  return new Term_seq {arg};
+  return make<Term_seq>(1, arg);
 }
 
 // Elaborate a funtion call.
@@ -374,7 +382,7 @@ elab_call(App_tree* t, Term* fn, Term* arg, Fn_type* fn_type) {
 
   // Build the function call.
   Type* result_type = fn_type->result();
-  return new Call(t->loc, result_type, fn, args);
+  return make<Call>(t->loc, result_type, fn, args);
 }
 
 // Elaborate an application or function call.
@@ -436,7 +444,7 @@ elab_if(If_tree* t) {
     return nullptr;
   }
 
-  return new If(t->loc, type2, t1, t2, t3);
+  return make<If>(t->loc, type2, t1, t2, t3);
 }
 
 // TODO: The succ, pred, and iszero elaborators have a lot in
@@ -462,7 +470,7 @@ elab_succ(Succ_tree* t) {
       return nullptr;
   }
 
-  return new Succ(t->loc, nat_type, t1); 
+  return make<Succ>(t->loc, nat_type, t1); 
 }
 
 // Elaborate a predecessor term.
@@ -485,7 +493,7 @@ elab_pred(Pred_tree* t) {
       return nullptr;
   }
 
-  return new Pred(t->loc, nat_type, t1);
+  return make<Pred>(t->loc, nat_type, t1);
 }
 
 // Elaborate a iszero term.
@@ -509,7 +517,7 @@ elab_iszero(Iszero_tree* t) {
   }
   Type* bool_type = get_bool_type();
 
-  return new Iszero(t->loc, bool_type, t1); 
+  return make<Iszero>(t->loc, bool_type, t1); 
 }
 
 // Elaborate an arrow expression. When both sub-expressions
@@ -540,7 +548,7 @@ elab_arrow(Arrow_tree* t) {
   Type* type1 = static_cast<Type*>(t1);
   Type* type2 = static_cast<Type*>(t2);
 
-  return new Arrow_type(t->loc, kind_type, type1, type2);
+  return make<Arrow_type>(t->loc, kind_type, type1, type2);
 }
 
 // Elaborate a tuple.
@@ -550,8 +558,8 @@ elab_arrow(Arrow_tree* t) {
 //    G |- {t1, ..., tn} : {T1, ..., Tn}
 Expr*
 elab_tuple(Tuple_tree* t, Term* t0) {
-  Term_seq* terms = new Term_seq();
-  Type_seq* types = new Type_seq();
+  Term_seq* terms = make<Term_seq>();
+  Type_seq* types = make<Type_seq>();
 
   // Add the previously elaborated term to the tuple.
   terms->push_back(t0);
@@ -574,8 +582,8 @@ elab_tuple(Tuple_tree* t, Term* t0) {
     ++iter;
   }
 
-  Type* type = new Tuple_type(get_kind_type(), types);
-  return new Tuple(t->loc, type, terms);
+  Type* type = make_canonical(make<Tuple_type>(get_kind_type(), types));
+  return make<Tuple>(t->loc, type, terms);
 }
 
 // Elaborate a tuple type.
@@ -585,7 +593,7 @@ elab_tuple(Tuple_tree* t, Term* t0) {
 //    G |- {T1, ..., Tn} :: *
 Expr*
 elab_tuple_type(Tuple_tree* t, Type* t0) {
-  Type_seq* types = new Type_seq();
+  Type_seq* types = make<Type_seq>();
 
   // Add the previously elaborated term to the tuple.
   types->push_back(t0);
@@ -606,14 +614,14 @@ elab_tuple_type(Tuple_tree* t, Type* t0) {
     ++iter;
   }
 
-  return new Tuple_type(t->loc, get_kind_type(), types);
+  return make<Tuple_type>(t->loc, get_kind_type(), types);
 }
 
 
 // Return the variable describing an initializer.
 Term*
 get_var(Init* t) {
-  return new Var(t->name(), get_type(t->value()));
+  return make<Var>(t->name(), get_type(t->value()));
 }
 
 // Elaborate a record.
@@ -627,8 +635,8 @@ get_var(Init* t) {
 // functions.
 Expr*
 elab_record(Tuple_tree* t, Init* t0) {
-  Term_seq* inits = new Term_seq();
-  Term_seq* vars = new Term_seq();
+  Term_seq* inits = make<Term_seq>();
+  Term_seq* vars = make<Term_seq>();
 
   // Add the previously elaborated term to the tuple.
   inits->push_back(t0);
@@ -651,8 +659,8 @@ elab_record(Tuple_tree* t, Init* t0) {
     ++iter;
   }
 
-  Type* type = new Record_type(get_kind_type(), vars);
-  return new Record(t->loc, type, inits);
+  Type* type = make_canonical(make<Record_type>(get_kind_type(), vars));
+  return make<Record>(t->loc, type, inits);
 }
 
 // Elaborate a record type.
@@ -662,7 +670,7 @@ elab_record(Tuple_tree* t, Init* t0) {
 //    G |- {n1:T1, ..., nn:Tn} : *
 Expr*
 elab_record_type(Tuple_tree* t, Var* t0) {
-  Term_seq* vars = new Term_seq();
+  Term_seq* vars = make<Term_seq>();
 
   // Add the previously elaborated term to the tuple.
   vars->push_back(t0);
@@ -683,7 +691,7 @@ elab_record_type(Tuple_tree* t, Var* t0) {
     ++iter;
   }
 
-  return new Record_type(get_kind_type(), vars);
+  return make<Record_type>(get_kind_type(), vars);
 }
 
 // Elaborate a tuple expression. Note that there are many
@@ -695,8 +703,8 @@ elab_record_type(Tuple_tree* t, Var* t0) {
 Expr*
 elab_tuple(Tuple_tree* t) {
   if (t->elems()->empty()) {
-    Tuple_type* type = new Tuple_type(get_kind_type(), new Type_seq());
-    return new Tuple(t->loc, type, new Term_seq());
+    Tuple_type* type = make<Tuple_type>(get_kind_type(), make<Type_seq>());
+    return make<Tuple>(t->loc, type, make<Term_seq>());
   }
 
   // Elaborate the first element of the tuple. It determines
@@ -723,13 +731,13 @@ elab_list_type(List_tree* t, Type* t0) {
     error(t->loc) << format("ill-formed list type '{}'", pretty(t));
     return nullptr;
   }
-  return new List_type(get_kind_type(), t0);
+  return make<List_type>(get_kind_type(), t0);
 }
 
 // Elaborate a list of terms.
 Expr*
 elab_list(List_tree* t, Term* t0) {
-  Term_seq* terms = new Term_seq {t0};
+  Term_seq* terms = make<Term_seq>(1, t0);
   Type* value_type = get_type(t0);
 
   auto iter = std::next(t->elems()->begin());
@@ -753,8 +761,8 @@ elab_list(List_tree* t, Term* t0) {
     ++iter;
   }
 
-  Type* type = new List_type(get_kind_type(), value_type);
-  return new List(t->loc, type, terms);
+  Type* type = make_canonical(make<List_type>(get_kind_type(), value_type));
+  return make<List>(t->loc, type, terms);
 }
 
 // Elaborate a list of expressions. The elaboration depends on the
@@ -774,9 +782,9 @@ Expr*
 elab_list(List_tree *t) {
   if (t->elems()->empty()) {
     Name* n = fresh_name();
-    Type* wild = new Wild_type(get_kind_type(), n, get_kind_type());
-    Type* type = new List_type(get_kind_type(), wild);
-    Term* list = new List(type, new Term_seq());
+    Type* wild = make<Wild_type>(get_kind_type(), n, get_kind_type());
+    Type* type = make<List_type>(get_kind_type(), wild);
+    Term* list = make<List>(type, make<Term_seq>());
     return list;
   }
 
@@ -793,7 +801,7 @@ elab_list(List_tree *t) {
 // Return a variable describing an initializer.
 Expr*
 elab_variant(Variant_tree* t) {
-  return new Unit(t->loc, get_unit_type());
+  return make<Unit>(t->loc, get_unit_type());
 }
 
 // Elaborate a print expression.
@@ -806,7 +814,88 @@ elab_print(Print_tree* t) {
   Expr* t1 = elab_expr(t->expr());
   if (not t1)
     return nullptr;
-  return new Print(t->loc, get_unit_type(), t1);
+  return make<Print>(t->loc, get_unit_type(), t1);
+}
+
+// Returns true when the rows of type r can be stored in a file. Each
+// member must be a Bool, Nat, or Str. Otherwise, diagnose the first
+// member that cannot be stored.
+bool
+check_stored_type(Record_type* r) {
+  for (Term* v : *r->members()) {
+    Type* vt = get_type(v);
+    if (not is_bool_type(vt) and not is_nat_type(vt) and not is_str_type(vt)) {
+      error(v->loc) << format("member {} cannot be stored in a file", typed(v));
+      return false;
+    }
+  }
+  return true;
+}
+
+// Elaborate a load statement. The file must be a string literal, and
+// the type a record type whose members are Bool, Nat, or Str.
+//
+//    G |- f : Str   R = {n1:T1, ..., nk:Tk}   each Ti in {Bool, Nat, Str}
+//    -------------------------------------------------------------------- T-load
+//                        G |- load f as R : [R]
+Expr*
+elab_load(Load_tree* t) {
+  Term* t1 = elab_term(t->file());
+  if (not t1)
+    return nullptr;
+  if (not is<Str>(t1)) {
+    error(t1->loc) << format("'{}' is not a file name", pretty(t1));
+    return nullptr;
+  }
+  // The members of the row type are not declared in the enclosing
+  // scope.
+  Type* t2;
+  {
+    Scope_guard scope(member_scope);
+    t2 = elab_type(t->type());
+  }
+  if (not t2)
+    return nullptr;
+
+  Record_type* r = as<Record_type>(t2);
+  if (not r) {
+    error(t2->loc) << format("'{}' is not a record type", pretty(t2));
+    return nullptr;
+  }
+  if (not check_stored_type(r))
+    return nullptr;
+
+  return make<Load>(t->loc, make<List_type>(get_kind_type(), r), t1, r);
+}
+
+// Elaborate a save statement. The table must be a list of records
+// whose members are Bool, Nat, or Str, and the file a string literal.
+//
+//    G |- t : [R]   R = {n1:T1, ..., nk:Tk}   each Ti in {Bool, Nat, Str}
+//    --------------------------------------------------------------------- T-save
+//                        G |- save t to f : Unit
+Expr*
+elab_save(Save_tree* t) {
+  Term* t1 = elab_term(t->table());
+  if (not t1)
+    return nullptr;
+  Record_type* r = get_row_type(get_type(t1));
+  if (not r) {
+    error(t1->loc) << format("'{}' is not a table", pretty(t1));
+    return nullptr;
+  }
+  if (not check_stored_type(r))
+    return nullptr;
+
+  Term* t2 = elab_term(t->file());
+  if (not t2)
+    return nullptr;
+  if (not is<Str>(t2)) {
+    error(t2->loc) << format("'{}' is not a file name", pretty(t2));
+    return nullptr;
+  }
+
+  return make<Save>(t->loc, get_unit_type(), t1, t2);
 }
 
 // A typeof expression is an alias for the type of the 
@@ -834,20 +923,20 @@ elab_typeof(Typeof_tree* t) {
 //    G |- (t1, ..., tn) : Unit
 Expr*
 elab_comma(Comma_tree* t) {
-  Expr_seq* exprs = new Expr_seq();
+  Expr_seq* exprs = make<Expr_seq>();
   for (Tree* t0 : *t->elems()) {
     if (Expr* e = elab_expr(t0))
       exprs->push_back(e);
     else
       return nullptr;
   }
-  return new Comma(t->loc, get_unit_type(), exprs);
+  return make<Comma>(t->loc, get_unit_type(), exprs);
 }
 
 // FIXME: Implement me.
 Expr*
 elab_proj(Dot_tree* t, Term* t1, Term* t2, Tuple_type* tup_type) {
-  return new Unit(t->loc, get_unit_type());
+  return make<Unit>(t->loc, get_unit_type());
 }
 
 // Returns a Mem term whose t1 is a record and whose t2 is a Var
@@ -863,7 +952,7 @@ elab_mem(Dot_tree* t, Term* t1, Tree* t2, Record_type* rec_type) {
   // the scope so it'll recognize the label following the '.'
   Term* proj = elab_term(t2);
 
-  return new Mem(t->loc, get_unit_type(), t1, proj);
+  return make<Mem>(t->loc, get_unit_type(), t1, proj);
 }
 
 // Elaboration for a column projection 
@@ -879,7 +968,7 @@ elab_col(Dot_tree* t, Term* t1, Tree* t2, List_type* list_type) {
       declare(v);
     }
     Term* col = elab_term(t2);
-    return new Mem(t->loc, get_unit_type(), t1, col);
+    return make<Mem>(t->loc, get_unit_type(), t1, col);
   }
   else
     return nullptr; // TODO: should try some other form of proj
@@ -922,6 +1011,149 @@ elab_dot(Dot_tree* t) {
   return nullptr;
 }
 
+// Returns the aggregate function named by the token k.
+Aggregate_op
+get_aggregate_op(const Token* k) {
+  switch (k->kind) {
+  case count_tok: return count_agg;
+  case sum_tok: return sum_agg;
+  case min_tok: return min_agg;
+  case max_tok: return max_agg;
+  default: break;
+  }
+  lang_unreachable("unknown aggregate");
+}
+
+// Elaborate an aggregate of a column. The argument must be a column
+// of a table.
+//
+//    G |- t.n : T
+//    ------------------ T-count
+//    G |- count t.n : Nat
+//
+//    G |- t.n : Nat
+//    ------------------ T-sum
+//    G |- sum t.n : Nat
+//
+//    G |- t.n : T
+//    ------------------ T-min (and T-max)
+//    G |- min t.n : T
+Expr*
+elab_aggregate(Aggregate_tree* t) {
+  Term* t1 = elab_term(t->arg());
+  if (not t1)
+    return nullptr;
+
+  Mem* m = as<Mem>(t1);
+  Ref* ref = m ? as<Ref>(m->member()) : nullptr;
+  if (not ref) {
+    error(t1->loc) << format("'{}' is not a column", pretty(t1));
+    return nullptr;
+  }
+
+  Aggregate_op op = get_aggregate_op(t->op());
+  Type* type = get_type(ref);
+  if (op == count_agg)
+    type = get_nat_type();
+  if (op == sum_agg and not is_same(type, get_nat_type())) {
+    error(t1->loc) << 
+      format("column {} does not have type '{}'", typed(ref), pretty(get_nat_type()));
+    return nullptr;
+  }
+
+  return make<Aggregate>(t->loc, type, op, t1);
+}
+
+// Returns the elements of the projection or group list t.
+Tree_seq
+get_select_elems(Tree* t) {
+  if (Comma_tree* c = as<Comma_tree>(t))
+    return *c->elems();
+  return {t};
+}
+
+// Returns true if a and b are the same column of the same table.
+bool
+is_same_column(Term* a, Term* b) {
+  Mem* m1 = as<Mem>(a);
+  Mem* m2 = as<Mem>(b);
+  if (not m1 or not m2)
+    return false;
+  Ref* r1 = as<Ref>(m1->record());
+  Ref* r2 = as<Ref>(m2->record());
+  if (not r1 or not r2)
+    return false;
+  return is_same(r1, r2) and is_same(m1->member(), m2->member());
+}
+
+// Returns true if t is one of the grouped columns.
+bool
+is_grouped(Term* t, Term_seq* groups) {
+  if (groups) {
+    for (Term* g : *groups) {
+      if (is_same_column(t, g))
+        return true;
+    }
+  }
+  return false;
+}
+
+// Elaborate the projection list of a select statement. Aggregates
+// may only appear as the elements of a projection list. When the
+// statement is grouped, or has aggregates, each other element must
+// be one of the grouped columns.
+Term*
+elab_projection(Tree* t, Term_seq* groups) {
+  Expr_seq* exprs = make<Expr_seq>();
+  bool grouped = groups != nullptr;
+  for (Tree* t0 : get_select_elems(t)) {
+    Term* e;
+    if (Aggregate_tree* a = as<Aggregate_tree>(t0)) {
+      e = as<Term>(elab_aggregate(a));
+      grouped = true;
+    } else {
+      e = elab_term(t0);
+    }
+    if (not e)
+      return nullptr;
+    exprs->push_back(e);
+  }
+
+  if (grouped) {
+    for (Expr* e : *exprs) {
+      if (is<Aggregate>(e))
+        continue;
+      if (not is_grouped(as<Term>(e), groups)) {
+        error(e->loc) << format("'{}' is not aggregated or grouped", pretty(e));
+        return nullptr;
+      }
+    }
+  }
+
+  if (not is<Comma_tree>(t))
+    return as<Term>(exprs->front());
+  return make<Comma>(t->loc, get_unit_type(), exprs);
+}
+
+// Elaborate the group list of a select statement. Each element must
+// be a column.
+Term*
+elab_group(Tree* t, Term_seq* groups) {
+  Expr_seq* exprs = make<Expr_seq>();
+  for (Tree* t0 : get_select_elems(t)) {
+    Term* e = elab_term(t0);
+    if (not e)
+      return nullptr;
+    if (not is<Mem>(e)) {
+      error(e->loc) << format("'{}' is not a column", pretty(e));
+      return nullptr;
+    }
+    exprs->push_back(e);
+    groups->push_back(e);
+  }
+  return make<Comma>(t->loc, get_unit_type(), exprs);
+}
+
 // Elaboration for the table term
 Expr*
 elab_select(Select_tree* t) { 
@@ -937,28 +1169,57 @@ elab_select(Select_tree* t) {
       error(t->loc) << format("'{}' is not a list of records", pretty(t2));
   }
 
+  //elab the group list
+  Term* t4 = nullptr;
+  Term_seq* groups = nullptr;
+  if (t->t4) {
+    groups = make<Term_seq>();
+    t4 = elab_group(t->t4, groups);
+    if (not t4)
+      return nullptr;
+  }
+
   //elab the projection list
-  Term* t1 = elab_term(t->t1);
+  Term* t1 = elab_projection(t->t1, groups);
+  if (not t1)
+    return nullptr;
   //elab the condition
   Term* t3 = elab_term(t->t3);
 
-  return new Select_from_where(get_kind_type(), t1, t2, t3);
+  return make<Select_from_where>(get_kind_type(), t1, t2, t3, t4);
 }
 
+// Elaborate a join.
+//
+//    G |- t1 : [R1]   G |- t2 : [R2]   G |- t3 : Bool
+//    ------------------------------------------------ T-join
+//          G |- t1 join t2 on t3 : [R1 ++ R2]
+//
+// where R1 ++ R2 is the record type whose members are those of
+// R1 followed by those of R2.
 Expr*
 elab_join(Join_on_tree* t) {
   Term* t1 = elab_term(t->t1);
+  if (not t1)
+    return nullptr;
   Term* t2 = elab_term(t->t2);
+  if (not t2)
+    return nullptr;
   Term* t3 = elab_term(t->t3);
+  if (not t3)
+    return nullptr;
 
-  Type* type_t1 = get_type(t1);
-  Type* type_t2 = get_type(t2);
-
-  //check that t1 and t2 are the same type
-  if(!is_same(type_t1, type_t2))
-    error(t->loc) << format("mismatched types '{0}' and '{1}'", 
-                            pretty(type_t1), 
-                            pretty(type_t2));
+  //check that t1 and t2 are tables
+  Record_type* row_t1 = get_row_type(get_type(t1));
+  if (not row_t1) {
+    error(t1->loc) << format("'{}' is not a list of records", pretty(t1));
+    return nullptr;
+  }
+  Record_type* row_t2 = get_row_type(get_type(t2));
+  if (not row_t2) {
+    error(t2->loc) << format("'{}' is not a list of records", pretty(t2));
+    return nullptr;
+  }
 
   //check that t3 is bool type
   Type* type_t3 = get_type(t3);
@@ -968,7 +1229,9 @@ elab_join(Join_on_tree* t) {
     return nullptr;
   }
 
-  return new Join(type_t1, t1, t2, t3);
+  Type* row_type = merge_record_types(row_t1, row_t2);
+  Type* type = make<List_type>(get_kind_type(), row_type);
+  return make<Join>(t->loc, type, t1, t2, t3);
 }
 
 Expr*
@@ -985,7 +1248,7 @@ elab_union(Union_tree* t) {
                             pretty(type_t2));
 
   Type* type1 = get_type(t1);
-  return new Union(type1, t1, t2);
+  return make<Union>(type1, t1, t2);
 }
 
 Expr*
@@ -1002,7 +1265,7 @@ elab_intersect(Intersect_tree* t) {
                             pretty(type_t2));
 
   Type* type1 = get_type(t1);
-  return new Intersect(type1, t1, t2);
+  return make<Intersect>(type1, t1, t2);
 }
 
 Expr*
@@ -1019,7 +1282,7 @@ elab_except(Except_tree* t) {
                             pretty(type_t2));
 
   Type* type1 = get_type(t1);
-  return new Except(type1, t1, t2);
+  return make<Except>(type1, t1, t2);
 }
 
 Expr*
@@ -1044,7 +1307,7 @@ elab_and(And_tree* t) {
     return nullptr;
   }
 
-  return new And(t1->loc, get_bool_type(), t1, t2);
+  return make<And>(t1->loc, get_bool_type(), t1, t2);
 }
 
 Expr*
@@ -1069,7 +1332,7 @@ elab_or(Or_tree* t) {
     return nullptr;
   }
 
-  return new Or(t1->loc, get_bool_type(), t1, t2);
+  return make<Or>(t1->loc, get_bool_type(), t1, t2);
 }
 
 Expr*
@@ -1085,21 +1348,21 @@ elab_not(Not_tree* t) {
     return nullptr;
   }
 
-  return new Not(t1->loc, get_bool_type(), t1);
+  return make<Not>(t1->loc, get_bool_type(), t1);
 }
 
 Expr*
 elab_eq(Eq_comp_tree* t) {
   Term* t1 = elab_term(t->t1);
   Term* t2 = elab_term(t->t2);
-  return new Equals(t1->loc, get_bool_type(), t1, t2);
+  return make<Equals>(t1->loc, get_bool_type(), t1, t2);
 }
 
 Expr*
 elab_less(Less_tree* t) {
   Term* t1 = elab_term(t->t1);
   Term* t2 = elab_term(t->t2);
-  return new Less(t1->loc, get_bool_type(), t1, t2);
+  return make<Less>(t1->loc, get_bool_type(), t1, t2);
 }
 
 // Elaborate a program. The result type of the entire program
@@ -1116,7 +1379,7 @@ elab_prog(Prog_tree* t) {
   Scope_guard scope(global_scope);
 
   // Elaborate each statement in turn.
-  Term_seq* stmts = new Term_seq();
+  Term_seq* stmts = make<Term_seq>();
   for (Tree* s : *t->stmts()) {
     if (Term* term = elab_term(s)) {
       stmts->push_back(term);
@@ -1127,7 +1390,7 @@ elab_prog(Prog_tree* t) {
 
   // The type is that of the last statement.
   Type* type = get_type(stmts->back());
-  return new Prog(type, stmts);
+  return make<Prog>(type, stmts);
 }
 
 Expr* 
@@ -1153,11 +1416,16 @@ elab_expr(Tree* t) {
   case list_tree: return elab_list(as<List_tree>(t));
   case variant_tree: return elab_variant(as<Variant_tree>(t));
   case print_tree: return elab_print(as<Print_tree>(t));
+  case load_tree: return elab_load(as<Load_tree>(t));
+  case save_tree: return elab_save(as<Save_tree>(t));
   case typeof_tree: return elab_typeof(as<Typeof_tree>(t));
   case comma_tree: return elab_comma(as<Comma_tree>(t));
   case dot_tree: return elab_dot(as<Dot_tree>(t));
   case select_tree: return elab_select(as<Select_tree>(t));
   case join_on_tree: return elab_join(as<Join_on_tree>(t));
+  case aggregate_tree:
+    error(t->loc) << format("aggregate '{}' is not in a projection list", pretty(t));
+    return nullptr;
   case and_tree: return elab_and(as<And_tree>(t));
   case or_tree: return elab_or(as<Or_tree>(t));
   case not_tree: return elab_not(as<Not_tree>(t));
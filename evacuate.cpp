@@ -0,0 +1,213 @@
+#include "ast.hpp"
+#include "table.hpp"
+
+#include <unordered_map>
+
+// -------------------------------------------------------------------------- //
+// Evacuation
+//
+// Evacuating an expression copies the nodes of the expression that are
+// allocated in an arena, so that the arena can be released while the
+// expression is still in use. The copies are allocated by new.
+//
+// Nodes outside the arena are shared with the copy and are not
+// visited, so they must not refer to nodes in the arena. A node
+// reached along several paths is copied once, and references to a
+// declaration within the expression refer to the copied declaration.
+
+namespace {
+
+// The state of an evacuation. Each copied node is mapped to its copy.
+// When a node in the arena cannot be copied, the evacuation fails.
+struct Evacuation {
+  Evacuation(const Arena& a)
+    : arena(a), failed(false) { }
+
+  const Arena& arena;
+  std::unordered_map<Node*, Node*> copies;
+  bool failed;
+};
+
+Expr* evacuate(Evacuation&, Expr*);
+
+template<typename T>
+  inline T*
+  evacuate_as(Evacuation& ev, T* e) {
+    return static_cast<T*>(evacuate(ev, e));
+  }
+
+// Returns s, or a copy of s when s is in the arena.
+template<typename T>
+  Seq<T>*
+  evacuate_seq(Evacuation& ev, Seq<T>* s) {
+    if (not s or not ev.arena.owns(s))
+      return s;
+    auto iter = ev.copies.find(s);
+    if (iter != ev.copies.end())
+      return static_cast<Seq<T>*>(iter->second);
+    Seq<T>* r = make<Seq<T>>();
+    ev.copies.emplace(s, r);
+    r->reserve(s->size());
+    for (T* e : *s)
+      r->push_back(evacuate_as(ev, e));
+    return r;
+  }
+
+// Returns a copy of e, whose type is evacuated. The subterms of the
+// copy are those of e until the caller evacuates them.
+template<typename T>
+  inline T*
+  copy_node(Evacuation& ev, T* e) {
+    T* c = make<T>(*e);
+    ev.copies.emplace(e, c);
+    c->tr = evacuate_as(ev, e->tr);
+    return c;
+  }
+
+template<typename T>
+  inline T*
+  evacuate_nullary(Evacuation& ev, T* e) { return copy_node(ev, e); }
+
+template<typename T>
+  inline T*
+  evacuate_unary(Evacuation& ev, T* e) {
+    T* c = copy_node(ev, e);
+    c->t1 = evacuate_as(ev, e->t1);
+    return c;
+  }
+
+template<typename T>
+  inline T*
+  evacuate_binary(Evacuation& ev, T* e) {
+    T* c = copy_node(ev, e);
+    c->t1 = evacuate_as(ev, e->t1);
+    c->t2 = evacuate_as(ev, e->t2);
+    return c;
+  }
+
+template<typename T>
+  inline T*
+  evacuate_ternary(Evacuation& ev, T* e) {
+    T* c = copy_node(ev, e);
+    c->t1 = evacuate_as(ev, e->t1);
+    c->t2 = evacuate_as(ev, e->t2);
+    c->t3 = evacuate_as(ev, e->t3);
+    return c;
+  }
+
+// For nodes whose first operand is a sequence.
+template<typename T>
+  inline T*
+  evacuate_list(Evacuation& ev, T* e) {
+    T* c = copy_node(ev, e);
+    c->t1 = evacuate_seq(ev, e->t1);
+    return c;
+  }
+
+// For nodes of the form 'f(t1, ..., tn)'.
+inline Call*
+evacuate_call(Evacuation& ev, Call* e) {
+  Call* c = copy_node(ev, e);
+  c->t1 = evacuate_as(ev, e->t1);
+  c->t2 = evacuate_seq(ev, e->t2);
+  return c;
+}
+
+// For nodes of the form '\(p1, ..., pn).t' and '(T1, ..., Tn) -> T'.
+template<typename T>
+  inline T*
+  evacuate_fn(Evacuation& ev, T* e) {
+    T* c = copy_node(ev, e);
+    c->t1 = evacuate_seq(ev, e->t1);
+    c->t2 = evacuate_as(ev, e->t2);
+    return c;
+  }
+
+// The columns of a table are copied with it. Only the types of the
+// columns and the values of term columns can refer to other nodes.
+inline Table*
+evacuate_table(Evacuation& ev, Table* e) {
+  Table* c = copy_node(ev, e);
+  for (Column& col : c->t1) {
+    col.type = evacuate_as(ev, col.type);
+    for (Term*& t : col.terms)
+      t = evacuate_as(ev, t);
+  }
+  return c;
+}
+
+// Returns a copy of e, which is in the arena.
+Expr*
+copy_expr(Evacuation& ev, Expr* e) {
+  switch (e->kind) {
+  case id_expr: return evacuate_nullary(ev, as<Id>(e));
+  case unit_term: return evacuate_nullary(ev, as<Unit>(e));
+  case true_term: return evacuate_nullary(ev, as<True>(e));
+  case false_term: return evacuate_nullary(ev, as<False>(e));
+  case int_term: return evacuate_nullary(ev, as<Int>(e));
+  case str_term: return evacuate_nullary(ev, as<Str>(e));
+  case if_term: return evacuate_ternary(ev, as<If>(e));
+  case and_term: return evacuate_binary(ev, as<And>(e));
+  case or_term: return evacuate_binary(ev, as<Or>(e));
+  case not_term: return evacuate_unary(ev, as<Not>(e));
+  case equals_term: return evacuate_binary(ev, as<Equals>(e));
+  case less_term: return evacuate_binary(ev, as<Less>(e));
+  case succ_term: return evacuate_unary(ev, as<Succ>(e));
+  case pred_term: return evacuate_unary(ev, as<Pred>(e));
+  case iszero_term: return evacuate_unary(ev, as<Iszero>(e));
+  case var_term: return evacuate_binary(ev, as<Var>(e));
+  case abs_term: return evacuate_binary(ev, as<Abs>(e));
+  case fn_term: return evacuate_fn(ev, as<Fn>(e));
+  case app_term: return evacuate_binary(ev, as<App>(e));
+  case call_term: return evacuate_call(ev, as<Call>(e));
+  case init_term: return evacuate_binary(ev, as<Init>(e));
+  case tuple_term: return evacuate_list(ev, as<Tuple>(e));
+  case list_term: return evacuate_list(ev, as<List>(e));
+  case record_term: return evacuate_list(ev, as<Record>(e));
+  case proj_term: return evacuate_binary(ev, as<Proj>(e));
+  case mem_term: return evacuate_binary(ev, as<Mem>(e));
+  case ref_term: return evacuate_unary(ev, as<Ref>(e));
+  case print_term: return evacuate_unary(ev, as<Print>(e));
+  case save_term: return evacuate_binary(ev, as<Save>(e));
+  case table_term: return evacuate_table(ev, as<Table>(e));
+  case kind_type: return evacuate_nullary(ev, as<Kind_type>(e));
+  case unit_type: return evacuate_nullary(ev, as<Unit_type>(e));
+  case bool_type: return evacuate_nullary(ev, as<Bool_type>(e));
+  case nat_type: return evacuate_nullary(ev, as<Nat_type>(e));
+  case str_type: return evacuate_nullary(ev, as<Str_type>(e));
+  case arrow_type: return evacuate_binary(ev, as<Arrow_type>(e));
+  case fn_type: return evacuate_fn(ev, as<Fn_type>(e));
+  case tuple_type: return evacuate_list(ev, as<Tuple_type>(e));
+  case list_type: return evacuate_unary(ev, as<List_type>(e));
+  case record_type: return evacuate_list(ev, as<Record_type>(e));
+  default: break;
+  }
+  ev.failed = true;
+  return e;
+}
+
+// Returns e, or its copy when e is in the arena.
+Expr*
+evacuate(Evacuation& ev, Expr* e) {
+  if (not e or not ev.arena.owns(e))
+    return e;
+  auto iter = ev.copies.find(e);
+  if (iter != ev.copies.end())
+    return static_cast<Expr*>(iter->second);
+  return copy_expr(ev, e);
+}
+
+} // namespace
+
+// Returns an expression like e in which no node is allocated in the
+// arena a. The result is e when none of its nodes is in a, and nullptr
+// when e has a node in a that cannot be copied.
+//
+// The nodes of the result that are not in e are allocated by new.
+Expr*
+evacuate(Expr* e, const Arena& a) {
+  Arena_scope scope(nullptr);
+  Evacuation ev(a);
+  Expr* r = evacuate(ev, e);
+  return ev.failed ? nullptr : r;
+}
@@ -1,53 +1,173 @@
-
 #include "eval.hpp"
 #include "ast.hpp"
 #include "scope.hpp"
 #include "type.hpp"
 #include "value.hpp"
 #include "subst.hpp"
+#include "table.hpp"
+#include "plan.hpp"
+#include "exec.hpp"
+#include "load.hpp"
 
 #include "lang/debug.hpp"
 
+#include <deque>
 #include <iostream>
 #include <set>
+#include <unordered_set>
+#include <vector>
 
 // -------------------------------------------------------------------------- //
 // Evaluator class
 
 Term*
 Evaluator::operator()(Term* t) {
+  Arena_scope scope(&arena);
+  if (Prog* p = as<Prog>(t))
+    return eval_prog(p);
   return eval(t);
 }
 
+// Evaluate each statement of the program p in turn, returning the
+// value of the last.
+//
+// Each statement is an epoch: the nodes it allocates are released
+// before the next statement is evaluated. The only nodes that outlive
+// a statement are the values of definitions, which are the roots of
+// later statements. Hash-consed values and tables are allocated by
+// new. Any other value of a definition (e.g., a closure) is evacuated
+// from the arena. A value that cannot be evacuated keeps the arena up
+// to the end of its statement.
+Term*
+Evaluator::eval_prog(Prog* p) {
+  Term_seq* ss = p->stmts();
+  if (ss->empty())
+    return get_unit();
+  Arena::Mark floor = arena.mark();
+  for (std::size_t i = 0; i < ss->size() - 1; ++i) {
+    Term* s = (*ss)[i];
+    eval(s);
+    if (Def* def = as<Def>(s)) {
+      Expr* v = evacuate(def->value(), arena);
+      if (not v) {
+        floor = arena.mark();
+        continue;
+      }
+      def->t2 = v;
+    }
+    arena.release(floor);
+  }
+  return eval(ss->back());
+}
+
 
 // -------------------------------------------------------------------------- //
 // Multi-step evaluation
 //
 // The following function computes the multi-step evaluation (or
-// simply evaluation) of a term t. Note that the evaluation is reflexive, 
+// simply evaluation) of a term t. Note that the evaluation is reflexive,
 // meaning that the evaluation of a value (or normal form) is simply
 // an identity operation.
+//
+// Evaluation is performed by an abstract machine in the style of the
+// CEK machine. Its state is a control (the term being evaluated, or
+// the value just computed), an environment (see below), and a stack of
+// continuations, each recording what remains to be done with the value
+// of a subterm. Continuations and frames are kept on stacks in the
+// heap, so the depth of a term or of a chain of calls is not limited
+// by the native stack.
 
 Term* eval(Term*);
 
+// -------------------------------------------------------------------------- //
+// Environments
+//
+// Rather than substituting arguments into the body of a function, a
+// call binds the parameters of the function to its arguments in a
+// frame, and references to a parameter evaluate to its argument. The
+// frame of the innermost call is the environment of the evaluation.
+//
+// An abstraction evaluated in an environment is a closure that refers
+// to the frame of that environment. Calling the closure makes that
+// frame the parent of the frame of the call. Frames of calls are
+// reused once the call returns, so a closure keeps a copy of the
+// innermost frame. Its parent is already a copy kept by the closure
+// that was called, or a frame that outlives the evaluation (see
+// eval(Term*, const Frame*)).
+//
+// Closures are values of the evaluator only. A closure that leaves
+// the evaluator, as when it is printed or defined, is converted to its
+// function with the arguments of its frames substituted into it.
+
+// Returns the argument in the given slot of the frame depth levels
+// above this one, or nullptr if there is no such frame.
+Term*
+Frame::get(int depth, int slot) const {
+  const Frame* f = this;
+  for (; f and depth; --depth)
+    f = f->parent;
+  if (f and std::size_t(slot) < f->size)
+    return f->args[slot];
+  return nullptr;
+}
+
+// A function together with the frame in which it was evaluated. The
+// arguments of the frame are copied into the closure.
+struct Frame_closure : Term {
+  Frame_closure(Term* f, Term_seq* as, const Frame* e)
+    : Term(frame_closure_term, get_type(f)), t1(f), t2(as),
+      frame(e->parms, as->data(), as->size(), e->parent) { }
+
+  Term* fn() const { return t1; }
+  Term_seq* args() const { return t2; }
+
+  Term* t1;
+  Term_seq* t2;
+  Frame frame;
+};
+template<> struct node_info<Frame_closure> : kind_info<frame_closure_term> { };
+
 namespace {
 
-// Compute the multistep evaluation of an if term
+// The environment of the current thread.
+thread_local const Frame* env = nullptr;
+
+} // namespace
+
+// Returns the environment of the current thread.
+const Frame*
+get_env() { return env; }
+
+Env_guard::Env_guard(const Frame* f)
+  : prev(env) { env = f; }
+
+Env_guard::~Env_guard() { env = prev; }
+
+namespace {
+
+// -------------------------------------------------------------------------- //
+// Evaluation rules
+//
+// The functions below compute the result of a term once the machine
+// has evaluated its subterms. Each is given the term and the values
+// of its subterms.
+
+// Returns the branch of an if term whose condition has the value bv.
+// The branch is then evaluated in place of the if term.
 //
 //             t1 ->* true
 //    ---------------------------- E-if-true
 //    if t1 then t2 else t3 ->* t2
 //
-//             t1 ->* true
+//             t1 ->* false
 //    ---------------------------- E-if-false
-//    if t1 then t2 else t3 ->* t2
+//    if t1 then t2 else t3 ->* t3
 Term*
-eval_if(If* t) {
-  Term* bv = eval(t->cond());
+eval_if(If* t, Term* bv) {
   if (is_true(bv))
-    return eval(t->if_true());
+    return t->if_true();
   if (is_false(bv))
-    return eval(t->if_false());
+    return t->if_false();
   lang_unreachable(format("'{}' is not a boolean value", pretty(bv)));
 }
 
@@ -59,11 +179,10 @@ eval_if(If* t) {
 //
 // Here, 'n' is an integer value.
 Term*
-eval_succ(Succ* t) {
-  Term* t1 = eval(t->arg());
+eval_succ(Term* t1) {
   if (Int* n = as<Int>(t1)) {
     const Integer& z = n->value();
-    return new Int(t->loc, get_type(t), z + 1);
+    return get_nat(z + 1);
   }
   lang_unreachable(format("'{}' is not a numeric value", pretty(t1)));
 }
@@ -80,14 +199,13 @@ eval_succ(Succ* t) {
 //
 // Here, 'n' is an integer value.
 Term*
-eval_pred(Pred* t) {
-  Term* t1 = eval(t->arg());
+eval_pred(Term* t1) {
   if (Int* n = as<Int>(t1)) {
     const Integer& z = n->value();
     if (z == 0)
       return n;
     else
-      return new Int(t->loc, get_type(t), z - 1);
+      return get_nat(z - 1);
   }
   lang_unreachable(format("'{}' is not a numeric value", pretty(t1)));
 }
@@ -102,72 +220,73 @@ eval_pred(Pred* t) {
 //    ------------------ E-iszero-succ
 //    iszero t ->* false
 Term*
-eval_iszero(Iszero* t) {
-  Term* t1 = eval(t->arg());
+eval_iszero(Term* t1) {
   if (Int* n = as<Int>(t1)) {
     const Integer& z = n->value();
-    if (z == 0)
-      return new True(t->loc, get_bool_type());
-    else
-      return new False(t->loc, get_bool_type());
+    return get_bool(z == 0);
   }
   lang_unreachable(format("'{}' is not a numeric value", pretty(t1)));
 }
 
-// Evaluate an application.
-//
-//        t1 ->* \x:T.t
-//    --------------------- E-app-1
-//    t1 t2 ->* (\x:T.t) t2
+// Evaluate an abstraction or function. In an environment, the result
+// is a closure of t in that environment.
 //
-//          t2 ->* v
-//    --------------------- E-app-2
-//    \x:T.t t2 ->* [x->v]t
+//    ------------ E-abs
+//    \x:T.t ->* \x:T.t
 Term*
-eval_app(App* t) {
-  Abs* fn = as<Abs>(eval(t->abs())); // E-app-1
-  lang_assert(fn, format("ill-formed application target '{}'", pretty(t->abs())));
-
-  Term* arg = eval(t->arg()); // E-app-2
-    
-  // Perform a beta reduction and evaluate the result.
-  Subst sub {fn->var(), arg};
-  Term* res = subst_term(fn->term(), sub);
-  return eval(res);
+eval_abs(Term* t) {
+  if (not env)
+    return t;
+  Term_seq* as = make<Term_seq>();
+  as->assign(env->args, env->args + env->size);
+  return make<Frame_closure>(t, as, env);
 }
 
-// Evaluate a function call. This is virtually identical to
-// application except that all arguments are evaluated in turn.
-//
-// TODO: Document the semantics of these operations.
+// Returns the value v as a term that can leave the evaluator. A
+// closure is converted to its function, substituting the argument of
+// each parameter bound by its frames.
 Term*
-eval_call(Call* t) {
-  // Evaluate the function.
-  Fn* fn = as<Fn>(eval(t->fn()));
-  lang_assert(fn, format("ill-formed call target '{}'", pretty(t->fn())));
-
-  // Evaluate arguments in place. That is, we're not creating
-  // a new sequence of arguments, just replacing the entries
-  // in the existing sequence.
-  Term_seq* args = t->args();
-  for (Term*& a : *args)
-    a = eval(a);
-
-  // Beta reduce and evaluate.
-  Subst sub {fn->parms(), args};
-  Term* result = subst_term(fn->term(), sub);
-  return eval(result);
+reify(Term* v) {
+  Frame_closure* k = as<Frame_closure>(v);
+  if (not k)
+    return v;
+  Subst sub;
+  for (const Frame* f = &k->frame; f; f = f->parent) {
+    for (std::size_t i = 0; i < f->size; ++i)
+      sub.insert({f->parms[i], reify(f->args[i])});
+  }
+  return subst_term(k->fn(), sub);
 }
 
+// Returns the abstraction or function of type T that is the value f,
+// or nullptr if there is none. The frame in which the function was
+// evaluated, if any, is stored in p.
+template<typename T>
+  T*
+  get_callee(Term* f, const Frame*& p) {
+    if (Frame_closure* k = as<Frame_closure>(f)) {
+      p = &k->frame;
+      return as<T>(k->fn());
+    }
+    p = nullptr;
+    return as<T>(f);
+  }
+
 // Elaborate a declaration reference. When the reference
-// is to a definition, replace it with the definition's value.
-// Otherwise, preserve the reference.
+// is to a parameter bound in the environment, replace it with
+// its argument. When the reference is to a definition, replace
+// it with the definition's value. Otherwise, preserve the
+// reference.
 //
 // If the reference is to a type, then we can't evaluate this.
 // Just return nullptr and hope that the caller knows how to
 // handle the results.
 Term*
 eval_ref(Ref* t) {
+  if (env and t->depth >= 0) {
+    if (Term* arg = env->get(t->depth, t->slot))
+      return arg;
+  }
   if (Def* def = as<Def>(t->decl())) {
     if (Term* replace = as<Term>(def->value()))
       return replace;
@@ -178,25 +297,58 @@ eval_ref(Ref* t) {
   }
 }
 
-// Evaluate the definition by evaluating the defined term. When the
-// definition's value is not a term, then there isn't anything
-// interesting that we can do. Just return the value.
+// Evaluate the definition by evaluating the defined term, whose value
+// is v. When the definition's value is not a term, then there isn't
+// anything interesting that we can do, and the machine does not
+// evaluate it.
 Term*
-eval_def(Def* t) {
-  if (Term* t0 = as<Term>(t->value())) {
-    // This is a little weird. We're actually going to update
-    // the defined term with its evaluated initializer. We do this
-    // because other expressions may already refer to t and we don't
-    // really want to re-resolve all of those things.
-    //
-    // Note that we could choose to do this during elaboration
-    // in order to avoid the weirdness.
-    t->t2 = eval(t0);
-  }
+eval_def(Def* t, Term* v) {
+  // This is a little weird. We're actually going to update
+  // the defined term with its evaluated initializer. We do this
+  // because other expressions may already refer to t and we don't
+  // really want to re-resolve all of those things.
+  //
+  // Note that we could choose to do this during elaboration
+  // in order to avoid the weirdness.
+  //
+  // Defined values are hash-consed, and defined tables are stored
+  // by column. Both outlive the statement that defines them, so a
+  // table of canonical values is allocated by new. A value that is not
+  // canonical stays in the current arena until it is evacuated.
+  Term* c = make_canonical(reify(v));
+  Arena_scope scope(c->canon ? nullptr : get_arena());
+  t->t2 = to_table(c);
   return t;
 }
 
-// Elaborate a print statement.
+// Evaluation for 'load "f" as R'. The table is read from the file f
+// each time the term is evaluated. Files ending in '.wtbl' are binary
+// tables; others are delimited text.
+Term*
+eval_load(Load* t) {
+  std::string f = unquote(as<Str>(t->file())->value());
+  if (is_table_file(f))
+    return load_table(f, get_type(t));
+  return load_csv(f, get_type(t));
+}
+
+// Evaluation for 'save t to "f"'. The table is written to the file
+// f as a binary table.
+//
+//            t ->* v
+//    ----------------------- E-save
+//    save t to "f" -> unit
+Term*
+eval_save(Save* t, Term* v) {
+  std::string f = unquote(as<Str>(t->file())->value());
+  Table* table = as<Table>(to_table(v));
+  lang_assert(table, format("ill-formed table '{}'", pretty(t->table())));
+  save_table(f, table);
+  return get_unit();
+}
+
+// Elaborate a print statement. When the expression is a term, val
+// is its value. Otherwise, val is nullptr.
 //
 //          t ->* v
 //    ------------------- E-print-term
@@ -209,20 +361,15 @@ eval_def(Def* t) {
 //    print T -> unit
 //
 Term*
-eval_print(Print* t) {
-  // Try to evaluate the expression.
-  Term* val = nullptr;
-  if (Term* term = as<Term>(t->expr()))
-    val = eval(term);
-
+eval_print(Print* t, Term* val) {
   // Print the result, or if the expression is not
   // evaluable, just print the expression.
   if (val)
-    std::cout << pretty(val) << '\n';
+    std::cout << pretty(reify(val)) << '\n';
   else
     std::cout << pretty(t->expr()) << '\n';
 
-  return new Unit(t->loc, get_unit_type());
+  return get_unit();
 }
 
 // FIXME: Actually evaluate each expression in turn.
@@ -231,18 +378,11 @@ eval_comma(Comma* t) {
   return get_unit();
 }
 
-// Evaluate each statement in turn; the result of the program is
-// the result of the last statemnt. 
-//
-//    for each i ei ->* vi
-//    -------------------- E-prog
-//     e1; ...; en ->* vn
-Term*
-eval_prog(Prog* t) {
-  Term* tn;
-  for (Term* ti : *t->stmts())
-    tn = eval(ti);
-  return tn;
+// Ensure that the operand t of a logical operator is a boolean value.
+inline void
+check_boolean(Term* t) {
+  if (not is_boolean_value(t))
+    lang_unreachable(format("'{}' is not a boolean value", pretty(t)));
 }
 
 // Evaluation for 't1 and t2'
@@ -263,13 +403,12 @@ eval_prog(Prog* t) {
 // ------------------------
 // t1 and t2 ->* false
 Term*
-eval_and(And* t) {
-  Term* t1 = eval(t->t1);
-  Term* t2 = eval(t->t2);
-
+eval_and(Term* t1, Term* t2) {
+  check_boolean(t1);
+  check_boolean(t2);
   if(is_true(t1) && is_true(t2))
     return get_true();
-  else 
+  else
     return get_false();
 }
 
@@ -292,18 +431,17 @@ eval_and(And* t) {
 // t1 or t2 ->* false
 //
 Term*
-eval_or(Or* t) {
-  Term* t1 = eval(t->t1);
-  Term* t2 = eval(t->t2);
-
+eval_or(Term* t1, Term* t2) {
+  check_boolean(t1);
+  check_boolean(t2);
   if(is_false(t1) && is_false(t2))
     return get_false();
-  else 
+  else
     return get_true();
 }
 
 // Evaluation for 'not t1'
-// 
+//
 // t1 ->* false
 // --------------
 // not t1 ->* true
@@ -313,26 +451,22 @@ eval_or(Or* t) {
 // not t1 ->* false
 //
 Term*
-eval_not(Not* t) {
-  Term* t1 = eval(t->t1);
-
+eval_not(Term* t1) {
   if(is_true(t1))
     return get_false();
   if(is_false(t1))
     return get_true();
+  lang_unreachable(format("'{}' is not a boolean value", pretty(t1)));
 }
 
 // Evaluation for t1 == t2
-// 
+//
 // Online works for types defined by is_equals
 // Does not actually require the same type on both
 // operands since different typed terms fail the first cond anyway
 Term*
-eval_equals(Equals* t) {
-  Term* t1 = eval(t->t1);
-  Term* t2 = eval(t->t2);
-
-  if(is_same(t1, t2))
+eval_equals(Term* t1, Term* t2) {
+  if(is_same(reify(t1), reify(t2)))
     return get_true();
   else
     return get_false();
@@ -342,11 +476,8 @@ eval_equals(Equals* t) {
 // Only works on types defined by is_less
 //
 Term*
-eval_less(Less* t) {
-  Term* t1 = eval(t->t1);
-  Term* t2 = eval(t->t2);
-
-  if(is_less(t1, t2))
+eval_less(Term* t1, Term* t2) {
+  if(is_less(reify(t1), reify(t2)))
     return get_true();
   else
     return get_false();
@@ -363,45 +494,25 @@ eval_proj(Proj* t) {
   return nullptr;
 }
 
-// Returns a column projection for tables
-Term*
-eval_col(Mem* t) {
-  List* table = as<List>(eval(t->t1));
-  Ref* member = as<Ref>(t->member());
-  Var* v = as<Var>(member->decl());
-  Name* n = v->name();
-
-  Term_seq* records = table->elems();
-  Term_seq* vars = new Term_seq();
-  vars->push_back(v);
-  Type* rec_type = new Record_type(get_kind_type(), vars);
-
-  // resulting column
-  Term_seq* col = new Term_seq();
-  for (auto r : *records) {
-    for (auto i : *as<Record>(r)->members()) {
-      if (is_same(n, as<Init>(i)->name())) {
-        Term_seq* e = new Term_seq();
-        e->push_back(i);
-        col->push_back(new Record(rec_type, e));
-      }
-    }
-  }
-  Type* type = new List_type(get_kind_type(), rec_type);
-  return new List(type, col);
+// Returns the name of the member referred to by the member
+// access t.
+Name*
+get_member_name(Mem* t) {
+  Ref* ref = as<Ref>(t->member());
+  return as<Var>(ref->decl())->name();
 }
 
 // Returns a term from the record such that the label in the record matches l
 // Returns nullptr if the label l does not match anything in record r
+//
+// When t1 is a table, the member access is relational, and is not
+// evaluated here.
 Term*
-eval_mem(Mem* t) {
-  Term* t1 = eval(t->t1);
-
+eval_mem(Mem* t, Term* t1) {
   // If its a record type get the term with the corresponding label
   if (Record_type* r_type = as<Record_type>(get_type(t1))) {
     Term_seq* r = as<Record>(t1)->members();
-    Ref* ref = as<Ref>(t->member());
-    Name* n = as<Var>(ref->decl())->name();
+    Name* n = get_member_name(t);
 
     for (auto i : *r) {
       if (is_same(n, as<Init>(i)->name())) {
@@ -410,270 +521,802 @@ eval_mem(Mem* t) {
     }
   }
 
-  // Else return the column
-  if (List_type* l_type = as<List_type>(get_type(t1))) {
-    return eval_col(t);
-  }
-
   return nullptr;
 }
 
-// Merges records a and b
-Record*
-merge_records(Record* a, Record* b) {
-  Term_seq* a_mem = a->members();
-  Term_seq* b_mem = b->members();
-  Term_seq* elems = new Term_seq();
-
-  elems->insert(elems->end(), a_mem->begin(), a_mem->end());
-  elems->insert(elems->end(), b_mem->begin(), b_mem->end());
-  
-  Record_type* ar_type = as<Record_type>(get_type(a));
-  Record_type* br_type = as<Record_type>(get_type(b));
-
-  Term_seq* vars = new Term_seq();
-  vars->insert(vars->end(), ar_type->members()->begin(), ar_type->members()->end());
-  vars->insert(vars->end(), br_type->members()->begin(), br_type->members()->end());
-
-  Record_type* type = new Record_type(get_kind_type(), vars);
-  return new Record(type, elems);
-}
-
-// Appends table b to the rhs of table a
-// a and b must be a list of Records to work
-// else bad things happen
-List*
-merge_tables(List* a, List* b) {
-  // assume the record type because these are supposed to be tables
-  List_type* al_type = as<List_type>(get_type(a));
-  List_type* bl_type = as<List_type>(get_type(b));
-  Record_type* ar_type = as<Record_type>(al_type->type());
-  Record_type* br_type = as<Record_type>(bl_type->type());
-
-  Term_seq* vars = new Term_seq();
-  vars->insert(vars->end(), ar_type->members()->begin(), ar_type->members()->end());
-  vars->insert(vars->end(), br_type->members()->begin(), br_type->members()->end());
-  Record_type* nr_type = new Record_type(get_kind_type(), vars);
-
-  //merge the individual records in the table
-  Term_seq* rec = new Term_seq();
-  auto it_a = a->elems()->begin();
-  auto it_b = b->elems()->begin();
-  while (it_a != a->elems()->end()) {
-    rec->push_back(merge_records(as<Record>(*it_a), as<Record>(*it_b)));
-    ++it_a;
-    ++it_b;
-  }
-
-  List_type* l_type = new List_type(get_kind_type(), nr_type);
-  List* res = new List(l_type, rec);
-  return res;
-}
-
-//evaluation for select t1 from t2 where t3
-Term*
-eval_select_from_where(Select_from_where* t) {
-  //evaluate the list first
-  List* t2 = as<List>(eval(t->t2));
-
-  //new term seq to hold var list for record type
-  Term_seq* cols = new Term_seq();
-  //if its more than one projection operator
-  if (Comma* c = as<Comma>(t->t1)) {
-    for (auto p : *c->elems()) {
-      Mem* m = as<Mem>(p);
-      List* col = as<List>(eval(m));
-      cols->push_back(col);
-    }
-  }
+// A set of values. Elements are hashed structurally and compared
+// with the same-term relation.
+using Term_set = std::unordered_set<Term*, Expr_hash, Expr_eq>;
 
-  //in case its just one projection
-  if (Mem* m = as<Mem>(t->t1)) {
-    cols->push_back(eval(m));
-  }
+// Evaluate the relational term t. The term is lowered into a logical
+// plan, which is optimized and then executed. The plans are released
+// after execution. The terms made while planning are not, since the
+// result may refer to them.
+//
+// This includes 'select t1 from t2 where t3' and 't1 join t2 on t3',
+// whose result contains the merge of each pair of rows of t1 and t2
+// for which t3 is true.
+Term*
+eval_relation(Term* t) {
+  Arena plans;
+  return run_plan(optimize(plans, make_plan(plans, t)));
+}
 
-  //construct the new table after projection
-  List* n_table = as<List>(*cols->begin());
-  if(cols->size() > 1) {
-    auto it1 = cols->begin() + 1;
-    while (it1 != cols->end()) {
-      n_table = merge_tables(n_table, as<List>(*it1));
-      ++it1;
-    }
-  }
+// Hash-cons the elements of s so that they are hashed and compared
+// in constant time.
+void
+make_canonical_elems(Term_seq* s) {
+  for (Term* t : *s)
+    make_canonical(t);
+}
 
-  // t2 should be a Def or a Ref
-  // we cannot have a table with no name here
-  Term* subst;
-  if (Ref* ref = as<Ref>(t->t2))
-    subst = eval(as<Def>(ref->decl()));
-  if (Def* def = as<Def>(t->t2))
-    subst = eval(def);
-
-  // first we need to produce a set of conditions
-  // t3 is not just 1 condition, it is a condition for every record in the list
-  // for each record in t2, we need to substitute the ref t2 in t3 with that record
-  // this gives us a list of conditions which we can evaluate
-  Term_seq* records = t2->elems();
-  Term_seq* conds = new Term_seq();
-  for(auto r : *records) {
-    Subst sub { subst, r };
-    Term* res = subst_term(t->cond(), sub);
-    conds->push_back(res);
-  }
-
-  // iterate through the table's records and the conditions
-  // if the condition evaluates to true then add the record to result
-  auto cond_it = conds->begin();
-  auto table_it = n_table->elems()->begin();
-  if(conds->size() == n_table->elems()->size()) {
-    Term_seq* sel_rec = new Term_seq();
-    // true
-    Term* _true = get_true();
-    while(cond_it != conds->end()) {
-      //check if the evaluation of the condition is true
-      if(is_same(_true, eval(*cond_it))) {
-        sel_rec->push_back(*table_it);
-      }
-      ++cond_it;
-      ++table_it;
-    }
-    n_table->t1 = sel_rec;
+// Returns the elements of a that are (or are not) in b, in the
+// order of a, with duplicates removed.
+Term_seq*
+filter_elems(Term_seq* e1, Term_seq* e2, bool in_e2) {
+  make_canonical_elems(e1);
+  make_canonical_elems(e2);
+  Term_set s2(e2->begin(), e2->end());
+  Term_seq* u = make<Term_seq>();
+  Term_set seen(e1->size());
+  for (auto re1 : *e1) {
+    if (s2.count(re1) == in_e2 && seen.insert(re1).second)
+      u->push_back(re1);
   }
-
-  return eval(n_table);
+  return u;
 }
 
+// Evaluation for 't1 intersect t2'. The result contains each element
+// of t1 that also appears in t2, in the order of t1, with duplicates
+// removed.
+//
+// Assume t1 and t2 are both lists or tables.
 Term*
-eval_join(Join* t) {
-  //perform product between tables
-  //perform selection of resulting product
-  //perform projection on table
-  //populate new table
-  //ereturn new table
-  return nullptr;
+eval_intersect(Term* t1, Term* t2) {
+  Term_seq* e1 = as<List>(t1)->elems();
+  Term_seq* e2 = as<List>(t2)->elems();
+  return make<List>(get_type(t1), filter_elems(e1, e2, true));
 }
 
+// Evaluation for 't1 union t2'. The result contains each element
+// of t1 followed by each element of t2, with duplicates removed.
+//
+// Assume t1 and t2 are both lists or tables.
 Term*
-eval_intersect(Intersect* t) {
-  //eval t1
-  Term* t1 = eval(t->t1);
+eval_union(Term* t1, Term* t2) {
   Term_seq* e1 = as<List>(t1)->elems();
-  //eval t2
-  Term* t2 = eval(t->t2);
   Term_seq* e2 = as<List>(t2)->elems();
-  //perform intersect
-  Term_seq* u = new Term_seq();
-  for(auto re1 : *e1) {
-    bool contained = false;
-    for(auto re2: *e2) {
-      if(is_same(re1, re2)) {
-        contained = true;
-        break;
-      }
-    }
-    if(contained)
-      u->push_back(re1);
-  }
 
-  //remove duplicates
-  return new List(get_type(t1), u);
+  //perform union, removing duplicates
+  make_canonical_elems(e1);
+  make_canonical_elems(e2);
+  Term_seq* u = make<Term_seq>();
+  u->reserve(e1->size() + e2->size());
+  Term_set seen(e1->size() + e2->size());
+  for (auto e0 : *e1) {
+    if (seen.insert(e0).second)
+      u->push_back(e0);
+  }
+  for (auto e0 : *e2) {
+    if (seen.insert(e0).second)
+      u->push_back(e0);
+  }
+  return make<List>(get_type(t1), u);
 }
 
-//Assum t1 and t2 are both lists
+// Evaluation for 't1 except t2'. The result contains each element
+// of t1 that does not appear in t2, in the order of t1, with
+// duplicates removed.
+//
+// Assume t1 and t2 are both lists or tables.
 Term*
-eval_union(Union* t) {
-  //eval t1
-  Term* t1 = eval(t->t1);
+eval_except(Term* t1, Term* t2) {
   Term_seq* e1 = as<List>(t1)->elems();
-  //eval t2
-  Term* t2 = eval(t->t2);
   Term_seq* e2 = as<List>(t2)->elems();
+  return make<List>(get_type(t1), filter_elems(e1, e2, false));
+}
 
-  //perform union
-  Term_seq* u = new Term_seq();
-  u->assign(e1->begin(), e1->end());
-  for(auto e0 : *e2) {
-    bool contained = false;
-    for(auto elem : *u) {
-      //if we find it in the union set already break
-      if(is_same(e0, elem)) {
-        contained = true;
-        break;
-      } 
-    }
-    if(!contained)
-      u->push_back(e0);
+// Returns the value of the term t, which has a single subterm whose
+// value is v.
+Term*
+eval_unary(Term* t, Term* v) {
+  switch (t->kind) {
+  case not_term: return eval_not(v);
+  case succ_term: return eval_succ(v);
+  case pred_term: return eval_pred(v);
+  case iszero_term: return eval_iszero(v);
+  case mem_term: return eval_mem(static_cast<Mem*>(t), v);
+  case print_term: return eval_print(static_cast<Print*>(t), v);
+  case save_term: return eval_save(static_cast<Save*>(t), v);
+  case def_term: return eval_def(static_cast<Def*>(t), v);
+  default: break;
   }
-  return new List(get_type(t1), u);
+  lang_unreachable(format("ill-formed term '{}'", pretty(t)));
 }
 
-//Assume t1 and t2 are both lists
+// Returns the value of the term t, whose operands have the values
+// v1 and v2.
 Term*
-eval_except(Except* t) {
-  //eval t1
-  Term* t1 = eval(t->t1);
-  Term_seq* e1 = as<List>(t1)->elems();
-  //eval t2
-  Term* t2 = eval(t->t2);
-  Term_seq* e2 = as<List>(t2)->elems();
-  //perform except
-  Term_seq* u = new Term_seq();
-  for(auto re1 : *e1) {
-    bool contained = false;
-    for(auto re2: *e2) {
-      if(is_same(re1, re2)) {
-        contained = true;
+eval_binary(Term* t, Term* v1, Term* v2) {
+  switch (t->kind) {
+  case and_term: return eval_and(v1, v2);
+  case or_term: return eval_or(v1, v2);
+  case equals_term: return eval_equals(v1, v2);
+  case less_term: return eval_less(v1, v2);
+  case union_term: return eval_union(v1, v2);
+  case intersect_term: return eval_intersect(v1, v2);
+  case except_term: return eval_except(v1, v2);
+  default: break;
+  }
+  lang_unreachable(format("ill-formed term '{}'", pretty(t)));
+}
+
+
+// -------------------------------------------------------------------------- //
+// Abstract machine
+
+// The kinds of continuation. The comment of each gives the context
+// in which the value is used, where [] is the value.
+enum Cont_kind {
+  if_cont,     // if [] then t2 else t3
+  unary_cont,  // op []
+  left_cont,   // [] op t2
+  right_cont,  // v1 op []
+  fn_cont,     // [] t2
+  arg_cont,    // v1 []
+  call_cont,   // f(v1, ..., [], ..., tn), or [](t1, ..., tn)
+  stmt_cont,   // v1; ...; []; ...; tn
+  return_cont  // the end of a call
+};
+
+// A continuation records what remains to be done with the value of a
+// subterm of the term t. The value holds the second operand of t or
+// the value of its first, and the index is the position of the next
+// argument or statement of t.
+struct Cont {
+  Cont_kind kind;
+  Term* term;
+  Term* value;
+  std::size_t index;
+};
+
+// An activation holds the frame of a call and the arguments bound by
+// it, along with the environment of the caller.
+struct Activation {
+  std::vector<Term*> args;
+  Frame frame {nullptr, nullptr, 0, nullptr};
+  const Frame* prev;
+};
+
+// The stacks of the machine. The value stack holds the values of the
+// function and arguments of calls whose arguments are being evaluated.
+// Activations are kept in a deque so that they are not moved as it
+// grows, and are reused by later calls.
+//
+// Nested evaluations on the same thread (e.g., of the predicates of a
+// query) share the stacks, each using only the part of the stacks
+// above that of its caller.
+struct Stacks {
+  std::vector<Cont> conts;
+  std::vector<Term*> vals;
+  std::deque<Activation> acts;
+  std::size_t depth = 0;
+};
+
+thread_local Stacks stacks;
+
+// Restores the stacks and environment to their state on entry to an
+// evaluation, including when the evaluation throws.
+struct Run_guard {
+  Run_guard(Stacks& s)
+    : s(s), conts(s.conts.size()), vals(s.vals.size()),
+      depth(s.depth), prev(env) { }
+  ~Run_guard() {
+    s.conts.resize(conts);
+    s.vals.resize(vals);
+    s.depth = depth;
+    env = prev;
+  }
+
+  Stacks& s;
+  std::size_t conts;
+  std::size_t vals;
+  std::size_t depth;
+  const Frame* prev;
+};
+
+// Push a continuation for the single subterm t1 of t, returning t1.
+Term*
+push_unary(Stacks& s, Term* t, Term* t1) {
+  s.conts.push_back({unary_cont, t, nullptr, 0});
+  return t1;
+}
+
+// Push a continuation for the first operand of t, returning it.
+template<typename T>
+  Term*
+  push_binary(Stacks& s, T* t) {
+    s.conts.push_back({left_cont, t, t->t2, 0});
+    return t->t1;
+  }
+
+// Bind the parameters ps of a function to the n values on top of the
+// value stack, making the new frame the environment. The parent of the
+// frame is p, the frame in which the function was evaluated. The frame
+// is removed when the body has been evaluated.
+void
+push_frame(Stacks& s, Term* const* ps, std::size_t n, const Frame* p) {
+  if (s.depth == s.acts.size())
+    s.acts.emplace_back();
+  Activation& a = s.acts[s.depth++];
+  a.args.assign(s.vals.end() - n, s.vals.end());
+  s.vals.resize(s.vals.size() - n);
+  a.frame = Frame(ps, a.args.data(), n, p);
+  a.prev = env;
+  env = &a.frame;
+  s.conts.push_back({return_cont, nullptr, nullptr, 0});
+}
+
+// Returns the value of the term t in the current environment.
+//
+// The machine alternates between two modes. When c is a term, it
+// either computes its value directly or pushes a continuation and
+// evaluates a subterm. When c is a value, it is passed to the
+// continuation on top of the stack. The evaluation ends when there
+// are no more continuations than on entry.
+//
+// The kind of each term is known from the switch that dispatches on
+// it, so terms are converted with static_cast rather than as<>.
+Term*
+run(Term* t) {
+  Stacks& s = stacks;
+  Run_guard guard(s);
+  std::size_t base = s.conts.size();
+  Term* c = t;
+  bool is_val = false;
+  for (;;) {
+    if (not is_val) {
+      switch (c->kind) {
+      case if_term:
+        s.conts.push_back({if_cont, c, nullptr, 0});
+        c = static_cast<If*>(c)->cond();
+        continue;
+      case not_term:
+        c = push_unary(s, c, static_cast<Not*>(c)->t1);
+        continue;
+      case succ_term:
+        c = push_unary(s, c, static_cast<Succ*>(c)->arg());
+        continue;
+      case pred_term:
+        c = push_unary(s, c, static_cast<Pred*>(c)->arg());
+        continue;
+      case iszero_term:
+        c = push_unary(s, c, static_cast<Iszero*>(c)->arg());
+        continue;
+      case and_term:
+        c = push_binary(s, static_cast<And*>(c));
+        continue;
+      case or_term:
+        c = push_binary(s, static_cast<Or*>(c));
+        continue;
+      case equals_term:
+        c = push_binary(s, static_cast<Equals*>(c));
+        continue;
+      case less_term:
+        c = push_binary(s, static_cast<Less*>(c));
+        continue;
+
+      case abs_term:
+      case fn_term:
+        c = eval_abs(c);
+        break;
+
+      // E-app-1
+      case app_term:
+        s.conts.push_back({fn_cont, c, nullptr, 0});
+        c = static_cast<App*>(c)->abs();
+        continue;
+
+      // E-call-1
+      case call_term:
+        s.conts.push_back({call_cont, c, nullptr, 0});
+        c = static_cast<Call*>(c)->fn();
+        continue;
+
+      case ref_term:
+        c = eval_ref(static_cast<Ref*>(c));
+        break;
+
+      case print_term:
+        if (Term* t1 = as<Term>(static_cast<Print*>(c)->expr())) {
+          c = push_unary(s, c, t1);
+          continue;
+        }
+        c = eval_print(static_cast<Print*>(c), nullptr);
+        break;
+
+      case load_term:
+        c = eval_load(static_cast<Load*>(c));
+        break;
+
+      case save_term:
+        c = push_unary(s, c, static_cast<Save*>(c)->table());
+        continue;
+
+      case def_term:
+        if (Term* t1 = as<Term>(static_cast<Def*>(c)->value())) {
+          c = push_unary(s, c, t1);
+          continue;
+        }
+        break;
+
+      // E-prog
+      case prog_term: {
+        Term_seq* ss = static_cast<Prog*>(c)->stmts();
+        if (ss->empty()) {
+          c = get_unit();
+          break;
+        }
+        s.conts.push_back({stmt_cont, c, nullptr, 1});
+        c = ss->front();
+        continue;
+      }
+
+      case comma_term:
+        c = eval_comma(static_cast<Comma*>(c));
+        break;
+
+      case proj_term:
+        c = eval_proj(static_cast<Proj*>(c));
+        break;
+
+      case mem_term:
+        if (is_relational(static_cast<Mem*>(c)->t1)) {
+          c = eval_relation(c);
+          break;
+        }
+        c = push_unary(s, c, static_cast<Mem*>(c)->t1);
+        continue;
+
+      case select_term:
+      case join_on_term:
+        c = eval_relation(c);
+        break;
+
+      case union_term:
+        if (is_relational(c)) {
+          c = eval_relation(c);
+          break;
+        }
+        c = push_binary(s, static_cast<Union*>(c));
+        continue;
+      case intersect_term:
+        if (is_relational(c)) {
+          c = eval_relation(c);
+          break;
+        }
+        c = push_binary(s, static_cast<Intersect*>(c));
+        continue;
+      case except_term:
+        if (is_relational(c)) {
+          c = eval_relation(c);
+          break;
+        }
+        c = push_binary(s, static_cast<Except*>(c));
+        continue;
+
+      default:
         break;
       }
+      is_val = true;
     }
-    if(!contained)
-      u->push_back(re1);
-  }
 
-  //remove duplicates
-  return new List(get_type(t1), u);
+    // Pass the value c to the innermost continuation.
+    if (s.conts.size() == base)
+      return c;
+    Cont k = s.conts.back();
+    s.conts.pop_back();
+    switch (k.kind) {
+    case if_cont:
+      c = eval_if(static_cast<If*>(k.term), c);
+      is_val = false;
+      break;
+
+    case unary_cont:
+      c = eval_unary(k.term, c);
+      break;
+
+    case left_cont:
+      s.conts.push_back({right_cont, k.term, c, 0});
+      c = k.value;
+      is_val = false;
+      break;
+
+    case right_cont:
+      c = eval_binary(k.term, k.value, c);
+      break;
+
+    // Evaluate the body of an application in a frame binding its
+    // variable to the argument, which is equivalent to evaluating
+    // the substitution [x->v]t.
+    //
+    //        t1 ->* \x:T.t
+    //    --------------------- E-app-1
+    //    t1 t2 ->* (\x:T.t) t2
+    //
+    //          t2 ->* v
+    //    --------------------- E-app-2
+    //    \x:T.t t2 ->* [x->v]t
+    case fn_cont: {
+      App* app = static_cast<App*>(k.term);
+      const Frame* p;
+      lang_assert(get_callee<Abs>(c, p), format("ill-formed application target '{}'", pretty(app->abs())));
+      s.conts.push_back({arg_cont, app, c, 0});
+      c = app->arg();
+      is_val = false;
+      break;
+    }
+
+    case arg_cont: {
+      const Frame* p;
+      Abs* fn = get_callee<Abs>(k.value, p);
+      s.vals.push_back(c);
+      push_frame(s, &fn->t1, 1, p);
+      c = fn->term();
+      is_val = false;
+      break;
+    }
+
+    // A function call is virtually identical to application except
+    // that all arguments are evaluated in turn, in the caller's
+    // environment.
+    //
+    //              f ->* \(x1:T1, ..., xn:Tn).t
+    //    --------------------------------------------- E-call-1
+    //    f(t1, ..., tn) ->* \(x1:T1, ..., xn:Tn).t(t1, ..., tn)
+    //
+    //                     ti ->* vi
+    //    ------------------------------------------------- E-call-2
+    //    \(x1:T1, ..., xn:Tn).t(t1, ..., tn) ->* [xi->vi]t
+    case call_cont: {
+      Call* call = static_cast<Call*>(k.term);
+      Term_seq* args = call->args();
+      const Frame* p;
+      if (k.index == 0)
+        lang_assert(get_callee<Fn>(c, p), format("ill-formed call target '{}'", pretty(call->fn())));
+      s.vals.push_back(c);
+      if (k.index < args->size()) {
+        s.conts.push_back({call_cont, call, nullptr, k.index + 1});
+        c = (*args)[k.index];
+        is_val = false;
+        break;
+      }
+
+      // Evaluate the body with each parameter bound to its argument.
+      std::size_t n = args->size();
+      Fn* fn = get_callee<Fn>(s.vals[s.vals.size() - n - 1], p);
+      lang_assert(n == fn->parms()->size(), "invalid call");
+      push_frame(s, fn->parms()->data(), n, p);
+      s.vals.pop_back();
+      c = fn->term();
+      is_val = false;
+      break;
+    }
+
+    // Evaluate each statement in turn; the result of the program is
+    // the result of the last statemnt.
+    //
+    //    for each i ei ->* vi
+    //    -------------------- E-prog
+    //     e1; ...; en ->* vn
+    case stmt_cont: {
+      Term_seq* ss = static_cast<Prog*>(k.term)->stmts();
+      if (k.index < ss->size()) {
+        s.conts.push_back({stmt_cont, k.term, nullptr, k.index + 1});
+        c = (*ss)[k.index];
+        is_val = false;
+      }
+      break;
+    }
+
+    case return_cont:
+      env = s.acts[--s.depth].prev;
+      break;
+    }
+  }
 }
 
 } // namespace
 
-// Compute the multi-step evaluation of the term t. 
+// Compute the multi-step evaluation of the term t.
 Term*
 eval(Term* t) {
+  return reify(run(t));
+}
+
+
+// Compute the multi-step evaluation of the term t in the environment
+// e. This is used by the virtual machine for terms that it does not
+// compile.
+Term*
+eval(Term* t, const Frame* e) {
+  Env_guard guard(e);
+  return eval(t);
+}
+
+
+// -------------------------------------------------------------------------- //
+// One-step evaluation
+//
+// A term steps by contracting its redex: the first subterm, in the
+// order of evaluation, that is not in normal form but whose own
+// subterms are. The redex is found by descending through the term,
+// recording the path on a stack in the heap. The contracted redex is
+// then put in place of the original by rebuilding each term on the
+// path.
+//
+// One-step evaluation substitutes arguments into the bodies of
+// functions rather than using environments, so its intermediate terms
+// are ordinary terms.
+
+namespace {
+
+bool is_normal(Term*);
+
+// Returns the i-th operand of the binary term t.
+template<typename T>
+  inline Term*
+  get_operand(T* t, std::size_t i) {
+    if (i == 0)
+      return t->t1;
+    if (i == 1)
+      return t->t2;
+    return nullptr;
+  }
+
+// Returns the i-th subterm of t in the order of evaluation, or nullptr
+// if t has no such subterm.
+Term*
+get_subterm(Term* t, std::size_t i) {
   switch (t->kind) {
-  case if_term: return eval_if(as<If>(t));
-  case and_term: return eval_and(as<And>(t));
-  case or_term: return eval_or(as<Or>(t));
-  case not_term: return eval_not(as<Not>(t));
-  case equals_term: return eval_equals(as<Equals>(t));
-  case less_term: return eval_less(as<Less>(t));
-  case succ_term: return eval_succ(as<Succ>(t));
-  case pred_term: return eval_pred(as<Pred>(t));
-  case iszero_term: return eval_iszero(as<Iszero>(t));
-  case app_term: return eval_app(as<App>(t));
-  case call_term: return eval_call(as<Call>(t));
-  case ref_term: return eval_ref(as<Ref>(t));
-  case print_term: return eval_print(as<Print>(t));
-  case def_term: return eval_def(as<Def>(t));
-  case prog_term: return eval_prog(as<Prog>(t));
-  case comma_term: return eval_comma(as<Comma>(t));
-  case proj_term: return eval_proj(as<Proj>(t));
-  case mem_term: return eval_mem(as<Mem>(t));
-  //case col_term: return eval_col(as<Col>(t));
-  case select_term: return eval_select_from_where(as<Select_from_where>(t));
-  case join_on_term: return eval_join(as<Join>(t));
-  case union_term: return eval_union(as<Union>(t));
-  case intersect_term: return eval_intersect(as<Intersect>(t));
-  case except_term: return eval_except(as<Except>(t));
-  default: break;
+  case if_term: return i == 0 ? as<If>(t)->cond() : nullptr;
+  case not_term: return i == 0 ? as<Not>(t)->t1 : nullptr;
+  case succ_term: return i == 0 ? as<Succ>(t)->arg() : nullptr;
+  case pred_term: return i == 0 ? as<Pred>(t)->arg() : nullptr;
+  case iszero_term: return i == 0 ? as<Iszero>(t)->arg() : nullptr;
+  case and_term: return get_operand(as<And>(t), i);
+  case or_term: return get_operand(as<Or>(t), i);
+  case equals_term: return get_operand(as<Equals>(t), i);
+  case less_term: return get_operand(as<Less>(t), i);
+  case app_term: return get_operand(as<App>(t), i);
+  case save_term: return i == 0 ? as<Save>(t)->table() : nullptr;
+  case print_term: return i == 0 ? as<Term>(as<Print>(t)->expr()) : nullptr;
+  case def_term: return i == 0 ? as<Term>(as<Def>(t)->value()) : nullptr;
+
+  case call_term: {
+    Call* c = as<Call>(t);
+    if (i == 0)
+      return c->fn();
+    return i <= c->args()->size() ? (*c->args())[i - 1] : nullptr;
   }
-  return t;
+
+  case prog_term: {
+    Term_seq* ss = as<Prog>(t)->stmts();
+    return i == 0 and not ss->empty() ? ss->front() : nullptr;
+  }
+
+  // Relational terms are evaluated in a single step.
+  case mem_term:
+    if (is_relational(as<Mem>(t)->t1))
+      return nullptr;
+    return i == 0 ? as<Mem>(t)->t1 : nullptr;
+  case union_term:
+    return is_relational(t) ? nullptr : get_operand(as<Union>(t), i);
+  case intersect_term:
+    return is_relational(t) ? nullptr : get_operand(as<Intersect>(t), i);
+  case except_term:
+    return is_relational(t) ? nullptr : get_operand(as<Except>(t), i);
+
+  default:
+    break;
+  }
+  return nullptr;
 }
 
+// Returns true when t is in normal form; that is, when t is its own
+// evaluation.
+bool
+is_normal(Term* t) {
+  switch (t->kind) {
+  case if_term:
+  case and_term:
+  case or_term:
+  case not_term:
+  case equals_term:
+  case less_term:
+  case succ_term:
+  case pred_term:
+  case iszero_term:
+  case app_term:
+  case call_term:
+  case print_term:
+  case load_term:
+  case save_term:
+  case prog_term:
+  case comma_term:
+  case proj_term:
+  case mem_term:
+  case select_term:
+  case join_on_term:
+  case union_term:
+  case intersect_term:
+  case except_term:
+    return false;
+
+  // A reference to a definition steps to its value.
+  case ref_term:
+    if (Def* def = as<Def>(as<Ref>(t)->decl()))
+      return not as<Term>(def->value());
+    return true;
+
+  case def_term:
+    if (Term* v = as<Term>(as<Def>(t)->value()))
+      return is_normal(v);
+    return true;
+
+  default:
+    break;
+  }
+  return true;
+}
 
-// Compute the one-step evaluation of the term t.
+// Returns a copy of the sequence s with its i-th element replaced
+// by t.
+Term_seq*
+replace_elem(Term_seq* s, std::size_t i, Term* t) {
+  Term_seq* r = make<Term_seq>();
+  r->assign(s->begin(), s->end());
+  (*r)[i] = t;
+  return r;
+}
+
+// Returns a copy of the binary term t with its i-th operand
+// replaced by c.
+template<typename T>
+  Term*
+  replace_operand(T* t, std::size_t i, Term* c) {
+    if (i == 0)
+      return make<T>(t->loc, get_type(t), c, t->t2);
+    return make<T>(t->loc, get_type(t), t->t1, c);
+  }
+
+// Returns a copy of t whose i-th subterm is replaced by c.
+//
+// A definition is instead updated in place, for the same reason as
+// in its evaluation.
 Term*
-step(Term* t) {
-  lang_unreachable("not implemented");
+replace_subterm(Term* t, std::size_t i, Term* c) {
+  switch (t->kind) {
+  case if_term: {
+    If* t0 = as<If>(t);
+    return make<If>(t->loc, get_type(t), c, t0->if_true(), t0->if_false());
+  }
+  case not_term: return make<Not>(t->loc, get_type(t), c);
+  case succ_term: return make<Succ>(t->loc, get_type(t), c);
+  case pred_term: return make<Pred>(t->loc, get_type(t), c);
+  case iszero_term: return make<Iszero>(t->loc, get_type(t), c);
+  case and_term: return replace_operand(as<And>(t), i, c);
+  case or_term: return replace_operand(as<Or>(t), i, c);
+  case equals_term: return replace_operand(as<Equals>(t), i, c);
+  case less_term: return replace_operand(as<Less>(t), i, c);
+  case union_term: return replace_operand(as<Union>(t), i, c);
+  case intersect_term: return replace_operand(as<Intersect>(t), i, c);
+  case except_term: return replace_operand(as<Except>(t), i, c);
+  case app_term: return replace_operand(as<App>(t), i, c);
+  case mem_term: return make<Mem>(t->loc, get_type(t), c, as<Mem>(t)->member());
+  case print_term: return make<Print>(t->loc, get_type(t), c);
+  case save_term: return make<Save>(t->loc, get_type(t), c, as<Save>(t)->file());
+
+  case call_term: {
+    Call* t0 = as<Call>(t);
+    if (i == 0)
+      return make<Call>(t->loc, get_type(t), c, t0->args());
+    return make<Call>(t->loc, get_type(t), t0->fn(), replace_elem(t0->args(), i - 1, c));
+  }
+
+  case prog_term:
+    return make<Prog>(get_type(t), replace_elem(as<Prog>(t)->stmts(), i, c));
+
+  case def_term:
+    as<Def>(t)->t2 = c;
+    return t;
+
+  default:
+    break;
+  }
+  lang_unreachable(format("ill-formed term '{}'", pretty(t)));
+}
+
+// Contract the redex t, whose subterms are in normal form.
+Term*
+contract(Term* t) {
+  switch (t->kind) {
+  case if_term:
+    return eval_if(as<If>(t), as<If>(t)->cond());
+
+  case app_term: {
+    App* app = as<App>(t);
+    Abs* fn = as<Abs>(app->abs());
+    lang_assert(fn, format("ill-formed application target '{}'", pretty(app->abs())));
+    return subst_term(fn->term(), Subst(fn->var(), app->arg()));
+  }
+
+  case call_term: {
+    Call* call = as<Call>(t);
+    Fn* fn = as<Fn>(call->fn());
+    lang_assert(fn, format("ill-formed call target '{}'", pretty(call->fn())));
+    lang_assert(call->args()->size() == fn->parms()->size(), "invalid call");
+    return subst_term(fn->term(), Subst(fn->parms(), call->args()));
+  }
+
+  // The first statement of the program is done. A definition is
+  // updated with its value, and the statement is removed.
+  //
+  //    ------------------------- E-prog-next
+  //    v1; t2; ...; tn -> t2; ...; tn
+  //
+  //    ------ E-prog-last
+  //    v -> v
+  case prog_term: {
+    Term_seq* ss = as<Prog>(t)->stmts();
+    if (ss->empty())
+      return get_unit();
+    Term* s1 = ss->front();
+    if (Def* def = as<Def>(s1)) {
+      if (Term* v = as<Term>(def->value()))
+        eval_def(def, v);
+    }
+    if (ss->size() == 1)
+      return s1;
+    Term_seq* rest = make<Term_seq>();
+    rest->assign(ss->begin() + 1, ss->end());
+    return make<Prog>(get_type(t), rest);
+  }
+
+  default:
+    break;
+  }
+
+  // Every other redex is a term whose subterms are values, which
+  // evaluates in a single step.
+  return eval(t);
 }
 
+} // namespace
+
+// Compute the one-step evaluation of the term t. When t is in normal
+// form, the result is t.
+Term*
+step(Term* t) {
+  std::vector<std::pair<Term*, std::size_t>> path;
+  Term* r = t;
+  while (not is_normal(r)) {
+    std::size_t i = 0;
+    Term* s;
+    while ((s = get_subterm(r, i)) and is_normal(s))
+      ++i;
+    if (not s)
+      break;
+    path.push_back({r, i});
+    r = s;
+  }
+  if (is_normal(r))
+    return t;
+
+  Term* c = contract(r);
+  while (not path.empty()) {
+    c = replace_subterm(path.back().first, path.back().second, c);
+    path.pop_back();
+  }
+  return c;
+}
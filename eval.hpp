@@ -3,21 +3,61 @@
 #define EVAL_HPP
 
 #include "lang/error.hpp"
+#include "lang/arena.hpp"
+
+#include <cstddef>
 
 // This module defines the interface to the evaluation rules of
 // the programming language.
 
 struct Term;
+struct Prog;
 
 // The evaluator class is the primary interface for evaluating
-// terms. Note that it keeps its own 
+// terms. Note that it keeps its own arena, in which the nodes
+// created by evaluation are allocated. The result of an evaluation
+// lives as long as the evaluator.
 struct Evaluator {
   Term* operator()(Term*);
+  Term* eval_prog(Prog*);
 
   Diagnostics diags;
+  Arena arena;
+};
+
+// A frame binds the parameters of a function to the arguments of a
+// call. The parent of a frame binds the parameters of the function
+// enclosing that one, so that a reference to a parameter is found by
+// its depth and slot (see Ref).
+struct Frame {
+  Frame(Term* const* ps, Term* const* as, std::size_t n, const Frame* p = nullptr)
+    : parms(ps), args(as), size(n), parent(p) { }
+
+  Term* get(int, int) const;
+
+  Term* const* parms;
+  Term* const* args;
+  std::size_t size;
+  const Frame* parent;
+};
+
+// The environment of an evaluation is the frame of the innermost call.
+// Terms evaluated by other threads on behalf of an evaluation, such as
+// the conditions of a query, must be evaluated in its environment.
+
+const Frame* get_env();
+
+// Sets the environment of the current thread, restoring the previous
+// environment on exit.
+struct Env_guard {
+  Env_guard(const Frame*);
+  ~Env_guard();
+
+  const Frame* prev;
 };
 
 Term* step(Term*);
 Term* eval(Term*);
+Term* eval(Term*, const Frame*);
 
 #endif
@@ -0,0 +1,830 @@
+
+#include "exec.hpp"
+#include "filter.hpp"
+#include "type.hpp"
+#include "value.hpp"
+#include "eval.hpp"
+#include "morsel.hpp"
+
+#include "lang/debug.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// The maximum number of rows read from a table at a time. A batch is
+// never larger than a morsel.
+inline std::size_t
+get_batch_size() {
+  return std::min<std::size_t>(1024, get_morsel_size());
+}
+
+// A set of rows. Rows are hashed and compared by their values.
+using Row_set = std::unordered_set<Row_key, Row_key_hash, Row_key_eq>;
+
+// A hash table mapping join keys to the rows having that key, in
+// their original order.
+using Join_table = std::unordered_map<Row_key, std::vector<std::size_t>, Row_key_hash, Row_key_eq>;
+
+// Append the remaining rows of op to the table res.
+void
+collect(Operator* op, Table* res) {
+  while (Table* b = op->next()) {
+    for (std::size_t j = 0; j < res->t1.size(); ++j)
+      res->t1[j].append(b->t1[j], 0, b->size());
+    delete b;
+  }
+}
+
+// Read the remaining rows of op into a table of type t.
+Table*
+collect(Operator* op, Type* t) {
+  Table* res = make_table(t);
+  collect(op, res);
+  return res;
+}
+
+// Returns b if it has rows. Otherwise, b is deleted and the result is
+// nullptr.
+inline Table*
+non_empty(Table* b) {
+  if (b->size())
+    return b;
+  delete b;
+  return nullptr;
+}
+
+// Read up to one batch of op for each thread. Batches are the morsels
+// of operators that process their input in parallel.
+std::vector<Table*>
+next_batches(Operator* op) {
+  std::vector<Table*> bs;
+  while (bs.size() < get_thread_count()) {
+    Table* b = op->next();
+    if (not b)
+      break;
+    bs.push_back(b);
+  }
+  return bs;
+}
+
+// Call f for each batch of bs, in parallel. The batches are processed
+// in the environment of the calling thread.
+template<typename F>
+  inline void
+  for_each_batch(const std::vector<Table*>& bs, F f) {
+    const Frame* env = get_env();
+    for_each_morsel(bs.size(), 1, [&](std::size_t first, std::size_t last) {
+      Env_guard guard(env);
+      for (std::size_t k = first; k < last; ++k)
+        f(k);
+    });
+  }
+
+// Returns the concatenation of the tables bs, which have type t, in
+// that order. The tables are deleted.
+Table*
+concat(const std::vector<Table*>& bs, Type* t) {
+  if (bs.size() == 1)
+    return bs.front();
+  Table* res = make_table(t);
+  for (Table* b : bs) {
+    for (std::size_t j = 0; j < res->t1.size(); ++j)
+      res->t1[j].append(b->t1[j], 0, b->size());
+    delete b;
+  }
+  return res;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Scans
+
+// Produces the rows of a table.
+struct Scan_op : Operator {
+  Scan_op(Table* t)
+    : table(t), pos(0) { }
+
+  Table* next() override {
+    if (pos == table->size())
+      return nullptr;
+    std::size_t last = std::min(pos + get_batch_size(), table->size());
+    Table* b = get_rows(table, pos, last);
+    pos = last;
+    return b;
+  }
+
+  Table* table;
+  std::size_t pos;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Filters
+
+// Copy the rows of t selected by s, starting at position pos, into
+// the batch b until it has n rows. Only the columns cols are copied
+// when given. Returns the position of the next row to copy.
+std::size_t
+copy_rows(Table* t, const Selection& s, std::size_t pos,
+          const std::vector<int>* cols, Table* b, std::size_t n) {
+  for (; pos < t->size() and b->size() < n; ++pos) {
+    if (not s.test(pos))
+      continue;
+    if (cols)
+      append_row(b, t, pos, *cols);
+    else
+      append_row(b, t, pos);
+  }
+  return pos;
+}
+
+// Produces the rows of a table that satisfy the conditions of a
+// filter. The conditions are evaluated over the whole table at once so
+// that the indexes of a defined table can be used.
+//
+// When the filter is the input of a projection, only the projected
+// columns are produced.
+struct Select_op : Operator {
+  Select_op(Filter_plan* f, Plan* p, const std::vector<int>* cols)
+    : type(get_table_type(p->attrs)), cols(cols), pos(0),
+      table(as<Scan_plan>(f->input)->table),
+      sel(select_rows(table, f->input->attrs, f->conds))
+  { }
+
+  Table* next() override {
+    while (pos < table->size()) {
+      Table* b = make_table(type);
+      pos = copy_rows(table, sel, pos, cols, b, get_batch_size());
+      if (non_empty(b))
+        return b;
+    }
+    return nullptr;
+  }
+
+  Type* type;
+  const std::vector<int>* cols;
+  std::size_t pos;
+  Table* table;
+  Selection sel;
+};
+
+// Produces the rows of each batch of the input that satisfy the
+// conditions of a filter. Several batches are filtered in parallel,
+// and their rows are produced in the order of the input.
+struct Filter_op : Operator {
+  Filter_op(Filter_plan* f, Plan* p, const std::vector<int>* cols)
+    : plan(f), type(get_table_type(p->attrs)), cols(cols),
+      input(make_operator(f->input))
+  { }
+
+  ~Filter_op() { delete input; }
+
+  Table* next() override {
+    while (true) {
+      std::vector<Table*> in = next_batches(input);
+      if (in.empty())
+        return nullptr;
+      std::vector<Table*> out(in.size());
+      for_each_batch(in, [&](std::size_t k) {
+        Selection sel = select_rows(in[k], plan->input->attrs, plan->conds);
+        out[k] = make_table(type);
+        copy_rows(in[k], sel, 0, cols, out[k], in[k]->size());
+        delete in[k];
+      });
+      if (Table* b = non_empty(concat(out, type)))
+        return b;
+    }
+  }
+
+  Filter_plan* plan;
+  Type* type;
+  const std::vector<int>* cols;
+  Operator* input;
+};
+
+// Returns the operator for the filter f, whose result is the table of
+// the plan p.
+Operator*
+make_filter(Filter_plan* f, Plan* p, const std::vector<int>* cols) {
+  if (f->input->kind == scan_plan)
+    return new Select_op(f, p, cols);
+  return new Filter_op(f, p, cols);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Projections
+
+// Produces the columns of each batch of the input at the positions
+// of a projection.
+struct Project_op : Operator {
+  Project_op(Project_plan* p)
+    : plan(p), type(get_table_type(p->attrs)), input(make_operator(p->input))
+  { }
+
+  ~Project_op() { delete input; }
+
+  Table* next() override {
+    Table* in = input->next();
+    if (not in)
+      return nullptr;
+    Table* b = make_table(type);
+    for (std::size_t j = 0; j < plan->cols.size(); ++j)
+      b->t1[j] = in->t1[plan->cols[j]];
+    delete in;
+    return b;
+  }
+
+  Project_plan* plan;
+  Type* type;
+  Operator* input;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Joins
+
+// The equi-join keys of a join condition. Each key pairs a column
+// of the left table with a column of the right table. Conjuncts that
+// are not equalities between such columns are kept as residual
+// conditions, which are evaluated for each pair of matching rows.
+struct Join_keys {
+  std::vector<int> left;
+  std::vector<int> right;
+  Term_seq* rest;
+};
+
+// Partition the conjuncts of a join condition into equi-join keys
+// and residual conditions. A column of both inputs refers to the
+// left one.
+Join_keys
+get_join_keys(Term_seq* cs, const Attr_seq& la, const Attr_seq& ra) {
+  Join_keys keys;
+  keys.rest = make<Term_seq>();
+  for (Term* c : *cs) {
+    if (Equals* eq = as<Equals>(c)) {
+      int a1 = get_column_index(eq->t1, la);
+      int a2 = get_column_index(eq->t2, la);
+      int b1 = a1 < 0 ? get_column_index(eq->t1, ra) : -1;
+      int b2 = a2 < 0 ? get_column_index(eq->t2, ra) : -1;
+      if (a1 >= 0 and b2 >= 0) {
+        keys.left.push_back(a1);
+        keys.right.push_back(b2);
+        continue;
+      }
+      if (b1 >= 0 and a2 >= 0) {
+        keys.left.push_back(a2);
+        keys.right.push_back(b1);
+        continue;
+      }
+    }
+    keys.rest->push_back(c);
+  }
+  return keys;
+}
+
+// Produces the merge of each pair of rows of the inputs for which the
+// join conditions are true. The rows of the left input are streamed
+// in batches and matched against the right input, which is read in
+// full before the first batch is produced. Each batch of the result
+// holds the matches of one batch of the left input, ordered by the
+// rows of the left input and then by the rows of the right input.
+//
+// When the conditions contain equalities between columns of the left
+// and right inputs, the right input is hashed on those columns and
+// probed with each left row. Otherwise, every pair of rows is
+// compared.
+struct Join_op : Operator {
+  Join_op(Join_plan* p)
+    : plan(p), type(get_table_type(p->attrs)),
+      keys(get_join_keys(p->conds, p->left->attrs, p->right->attrs)),
+      left(make_operator(p->left)), right_op(make_operator(p->right)),
+      right(nullptr)
+  { }
+
+  ~Join_op() {
+    delete left;
+    delete right_op;
+    delete right;
+  }
+
+  Table* next() override;
+
+  void build();
+  bool is_match(Table*, std::size_t, std::size_t);
+  void nested_loop_join(Table*, Table*);
+  void hash_join(Table*, Table*);
+
+  Join_plan* plan;
+  Type* type;
+  Join_keys keys;
+  Operator* left;
+  Operator* right_op;
+  Table* right;
+  Join_table hash;
+  Arena scratch;
+};
+
+// Read the right input and, when there are join keys, build its hash
+// table.
+void
+Join_op::build() {
+  right = collect(right_op, get_table_type(plan->right->attrs));
+  if (keys.left.empty())
+    return;
+  hash.reserve(right->size());
+  for (std::size_t j = 0; j < right->size(); ++j)
+    hash[{right, j, &keys.right}].push_back(j);
+}
+
+// Returns true when each residual condition evaluates to true for the
+// i-th row of a and the j-th row of the right input. The nodes made for
+// the pair of rows are allocated in the scratch arena of the join, which
+// is released before returning.
+bool
+Join_op::is_match(Table* a, std::size_t i, std::size_t j) {
+  if (keys.rest->empty())
+    return true;
+  Arena_scope scope(&scratch);
+  Arena::Mark m = scratch.mark();
+  bool b = true;
+  {
+    Subst sub = bind_row(a, plan->left->attrs, i, right, plan->right->attrs, j);
+    for (Term* c : *keys.rest) {
+      if (not is_true(eval(subst_term(c, sub)))) {
+        b = false;
+        break;
+      }
+    }
+  }
+  scratch.release(m);
+  return b;
+}
+
+// Join the batch a with the right input using a nested loop. The
+// batch is compared against each row of the right input in turn so
+// that it stays resident while the right input is scanned. Matches
+// are buffered per row so that the result is ordered by the rows of a.
+void
+Join_op::nested_loop_join(Table* a, Table* out) {
+  std::vector<std::vector<std::size_t>> matches(a->size());
+  for (std::size_t j = 0; j < right->size(); ++j) {
+    for (std::size_t i = 0; i < a->size(); ++i) {
+      if (is_match(a, i, j))
+        matches[i].push_back(j);
+    }
+  }
+  for (std::size_t i = 0; i < a->size(); ++i) {
+    for (std::size_t j : matches[i])
+      append_row(out, a, i, right, j);
+  }
+}
+
+// Join the batch a with the right input by probing the hash table
+// with the keys of each row of a.
+void
+Join_op::hash_join(Table* a, Table* out) {
+  for (std::size_t i = 0; i < a->size(); ++i) {
+    auto iter = hash.find({a, i, &keys.left});
+    if (iter == hash.end())
+      continue;
+    for (std::size_t j : iter->second) {
+      if (is_match(a, i, j))
+        append_row(out, a, i, right, j);
+    }
+  }
+}
+
+Table*
+Join_op::next() {
+  if (not right)
+    build();
+  while (Table* a = left->next()) {
+    Table* b = make_table(type);
+    if (keys.left.empty())
+      nested_loop_join(a, b);
+    else
+      hash_join(a, b);
+    delete a;
+    if (non_empty(b))
+      return b;
+  }
+  return nullptr;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Set operations
+
+// The distinct rows produced by a set operation. The rows are kept so
+// that duplicates can be found.
+struct Distinct_rows {
+  Distinct_rows(Type* t)
+    : rows(make_table(t)) { }
+
+  bool contains(Table* t, std::size_t i) const { return seen.count({t, i, nullptr}); }
+  bool insert(Table*, std::size_t);
+
+  Table* rows;
+  Row_set seen;
+};
+
+// Add the i-th row of t to the distinct rows. Returns false if it is
+// already one of them.
+bool
+Distinct_rows::insert(Table* t, std::size_t i) {
+  if (contains(t, i))
+    return false;
+  append_row(rows, t, i);
+  seen.insert({rows, rows->size() - 1, nullptr});
+  return true;
+}
+
+// Returns the rows of the batches bs that are new distinct rows, in
+// order, adding them to d. A row is a candidate when it is selected by
+// the predicate p and is not one of the distinct rows found so far.
+// Candidates are found for each batch in parallel; since rows may be
+// repeated across the batches, each candidate is checked again when it
+// is added. The batches are deleted.
+template<typename P>
+  Table*
+  add_distinct(const std::vector<Table*>& bs, Distinct_rows& d, Type* t, P p) {
+    std::vector<Selection> cands;
+    for (Table* b : bs)
+      cands.emplace_back(b->size());
+    for_each_batch(bs, [&](std::size_t k) {
+      for (std::size_t i = 0; i < bs[k]->size(); ++i) {
+        if (p(bs[k], i) and not d.contains(bs[k], i))
+          cands[k].set(i);
+      }
+    });
+
+    Table* res = make_table(t);
+    for (std::size_t k = 0; k < bs.size(); ++k) {
+      for (std::size_t i = 0; i < bs[k]->size(); ++i) {
+        if (cands[k].test(i) and d.insert(bs[k], i))
+          append_row(res, bs[k], i);
+      }
+      delete bs[k];
+    }
+    return res;
+  }
+
+// Produces each distinct row of the left input followed by each
+// distinct row of the right input that is not in the left input.
+struct Union_op : Operator {
+  Union_op(Set_plan* p)
+    : type(get_table_type(p->attrs)), left(make_operator(p->left)),
+      right(make_operator(p->right)), rows(type)
+  { }
+
+  ~Union_op() {
+    delete left;
+    delete right;
+  }
+
+  Table* next() override {
+    while (true) {
+      std::vector<Table*> in;
+      if (left)
+        in = next_batches(left);
+      if (in.empty() and left) {
+        delete left;
+        left = nullptr;
+      }
+      if (in.empty())
+        in = next_batches(right);
+      if (in.empty())
+        return nullptr;
+
+      auto any = [](Table*, std::size_t) { return true; };
+      if (Table* b = non_empty(add_distinct(in, rows, type, any)))
+        return b;
+    }
+  }
+
+  Type* type;
+  Operator* left;
+  Operator* right;
+  Distinct_rows rows;
+};
+
+// Produces each distinct row of the left input that is (intersect),
+// or is not (except), in the right input. The right input is read in
+// full before the first batch is produced.
+struct Member_op : Operator {
+  Member_op(Set_plan* p)
+    : plan(p), type(get_table_type(p->attrs)), in_right(p->kind == intersect_plan),
+      left(make_operator(p->left)), right_op(make_operator(p->right)),
+      right(nullptr), rows(type)
+  { }
+
+  ~Member_op() {
+    delete left;
+    delete right_op;
+    delete right;
+  }
+
+  Table* next() override {
+    if (not right) {
+      right = collect(right_op, get_table_type(plan->right->attrs));
+      for (std::size_t j = 0; j < right->size(); ++j)
+        right_rows.insert({right, j, nullptr});
+    }
+    while (true) {
+      std::vector<Table*> in = next_batches(left);
+      if (in.empty())
+        return nullptr;
+
+      auto is_member = [this](Table* t, std::size_t i) {
+        return right_rows.count({t, i, nullptr}) == in_right;
+      };
+      if (Table* b = non_empty(add_distinct(in, rows, type, is_member)))
+        return b;
+    }
+  }
+
+  Set_plan* plan;
+  Type* type;
+  bool in_right;
+  Operator* left;
+  Operator* right_op;
+  Table* right;
+  Row_set right_rows;
+  Distinct_rows rows;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Aggregation
+
+// A hash table mapping the keys of each group to its position.
+using Group_table = std::unordered_map<Row_key, std::size_t, Row_key_hash, Row_key_eq>;
+
+// The values of one aggregate for each group. Counts and sums are
+// accumulated as 64-bit integers until a sum overflows, after which
+// they are accumulated with arbitrary precision. The least or greatest
+// value of each group is kept in a column of the aggregated type.
+struct Accumulator {
+  Accumulator(const Aggregate_col& a, Type* t)
+    : op(a.op), col(a.col), big(false), best(t) { }
+
+  void resize(std::size_t);
+  void promote();
+  void add(const Column&, const std::vector<std::size_t>&);
+  void add_sums(const Column&, const std::vector<std::size_t>&);
+  void add_best(const Column&, const std::vector<std::size_t>&);
+  Column result(Type*);
+
+  Aggregate_op op;
+  int col;
+  bool big;
+  std::vector<std::int64_t> nats;
+  std::vector<Integer> ints;
+  Column best;
+};
+
+// Make room for the counts or sums of n groups. The least or greatest
+// values are added when each group is first seen.
+void
+Accumulator::resize(std::size_t n) {
+  if (op == min_agg or op == max_agg)
+    return;
+  if (big)
+    ints.resize(n);
+  else
+    nats.resize(n, 0);
+}
+
+// Continue accumulating with arbitrary precision.
+void
+Accumulator::promote() {
+  ints.reserve(nats.size());
+  for (std::int64_t n : nats)
+    ints.push_back(Integer(n));
+  nats.clear();
+  big = true;
+}
+
+// Accumulate the values of the column c, where groups[i] is the group
+// of the i-th value.
+void
+Accumulator::add(const Column& c, const std::vector<std::size_t>& groups) {
+  switch (op) {
+  case count_agg:
+    for (std::size_t g : groups)
+      ++nats[g];
+    return;
+  case sum_agg:
+    return add_sums(c, groups);
+  case min_agg:
+  case max_agg:
+    return add_best(c, groups);
+  }
+}
+
+// Add the values of the column c to the sums of their groups.
+void
+Accumulator::add_sums(const Column& c, const std::vector<std::size_t>& groups) {
+  if (c.kind == nat_column and not big) {
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+      std::int64_t n;
+      if (__builtin_add_overflow(nats[groups[i]], c.nats[i], &n)) {
+        promote();
+        for (; i < groups.size(); ++i)
+          ints[groups[i]] += Integer(c.nats[i]);
+        return;
+      }
+      nats[groups[i]] = n;
+    }
+    return;
+  }
+  if (not big)
+    promote();
+  for (std::size_t i = 0; i < groups.size(); ++i) {
+    if (c.kind == nat_column)
+      ints[groups[i]] += Integer(c.nats[i]);
+    else
+      ints[groups[i]] += c.ints[i];
+  }
+}
+
+// Returns true when the i-th value of a is less than the j-th value of
+// b. Strings are ordered by their characters rather than by the
+// addresses at which they are interned, so that the least and greatest
+// strings are the same in every run.
+inline bool
+is_less_value(const Column& a, std::size_t i, const Column& b, std::size_t j) {
+  if (a.kind != str_column or b.kind != str_column)
+    return a.is_less(i, b, j);
+  String x = a.strs[i];
+  String y = b.strs[j];
+  int r = std::memcmp(x.data(), y.data(), std::min(x.size(), y.size()));
+  return r < 0 or (r == 0 and x.size() < y.size());
+}
+
+// Groups are numbered in the order they are first seen, so a group
+// is new exactly when its number is the number of values kept.
+void
+Accumulator::add_best(const Column& c, const std::vector<std::size_t>& groups) {
+  for (std::size_t i = 0; i < groups.size(); ++i) {
+    std::size_t g = groups[i];
+    if (g == best.size())
+      best.append(c, i);
+    else if (op == min_agg ? is_less_value(c, i, best, g) : is_less_value(best, g, c, i))
+      best.set(g, c, i);
+  }
+}
+
+// Returns the column of aggregates, whose type is t.
+Column
+Accumulator::result(Type* t) {
+  if (op == min_agg or op == max_agg)
+    return std::move(best);
+  Column c(t);
+  if (big) {
+    c.kind = int_column;
+    c.ints = std::move(ints);
+  } else {
+    c.nats = std::move(nats);
+  }
+  return c;
+}
+
+// Produces one row for each group of rows of the input having the same
+// values in the grouped columns. Each group is found by hashing those
+// values, and its aggregates are updated one column of a batch at a
+// time. The input is read in full before the first batch is produced.
+//
+// When there are no grouped columns, all rows of the input form a
+// single group, and an empty input produces one row in which each
+// count and sum is 0. A least or greatest value of no rows is an
+// error. When there are grouped columns, an empty input has no groups.
+struct Group_op : Operator {
+  Group_op(Aggregate_plan* p)
+    : plan(p), type(get_table_type(p->attrs)), input(make_operator(p->input)),
+      result(nullptr), pos(0)
+  {
+    for (std::size_t i = 0; i < p->keys.size(); ++i)
+      key_cols.push_back(i);
+  }
+
+  ~Group_op() { delete input; }
+
+  Table* next() override;
+
+  void build();
+
+  Aggregate_plan* plan;
+  Type* type;
+  Operator* input;
+  std::vector<int> key_cols;
+  Table* result;
+  std::size_t pos;
+};
+
+// Read the input, accumulating the aggregates of each group. The keys
+// of the groups are stored in the leading columns of the result.
+void
+Group_op::build() {
+  result = make_table(type);
+  std::vector<Accumulator> accs;
+  for (const Aggregate_col& a : plan->aggs)
+    accs.emplace_back(a, get_type(plan->input->attrs[a.col].var));
+
+  Group_table table;
+  std::size_t n = 0;
+  std::vector<std::size_t> groups;
+  while (Table* in = input->next()) {
+    groups.resize(in->size());
+    for (std::size_t i = 0; i < in->size(); ++i) {
+      auto iter = table.find({in, i, &plan->keys});
+      if (iter != table.end()) {
+        groups[i] = iter->second;
+        continue;
+      }
+      append_row(result, in, i, plan->keys);
+      table.emplace(Row_key {result, n, &key_cols}, n);
+      groups[i] = n++;
+    }
+    for (Accumulator& a : accs) {
+      a.resize(n);
+      a.add(in->t1[a.col], groups);
+    }
+    delete in;
+  }
+
+  if (n == 0 and plan->keys.empty()) {
+    for (Accumulator& a : accs) {
+      if (a.op == min_agg or a.op == max_agg)
+        lang_unreachable("least or greatest value of no rows");
+      a.resize(1);
+    }
+  }
+
+  std::size_t k = plan->keys.size();
+  for (std::size_t j = 0; j < accs.size(); ++j)
+    result->t1[k + j] = accs[j].result(result->t1[k + j].type);
+}
+
+Table*
+Group_op::next() {
+  if (not result)
+    build();
+  if (pos == result->size())
+    return nullptr;
+  std::size_t last = std::min(pos + get_batch_size(), result->size());
+  Table* b = get_rows(result, pos, last);
+  pos = last;
+  return b;
+}
+
+} // namespace
+
+
+// Returns the operator that executes the plan p.
+Operator*
+make_operator(Plan* p) {
+  switch (p->kind) {
+  case scan_plan:
+    return new Scan_op(as<Scan_plan>(p)->table);
+  case filter_plan:
+    return make_filter(as<Filter_plan>(p), p, nullptr);
+  case project_plan: {
+    // A filter and the projection of its result are done together.
+    Project_plan* pr = as<Project_plan>(p);
+    if (Filter_plan* f = as<Filter_plan>(pr->input))
+      return make_filter(f, p, &pr->cols);
+    return new Project_op(pr);
+  }
+  case join_plan:
+    return new Join_op(as<Join_plan>(p));
+  case union_plan:
+    return new Union_op(as<Set_plan>(p));
+  case intersect_plan:
+  case except_plan:
+    return new Member_op(as<Set_plan>(p));
+  case aggregate_plan:
+    return new Group_op(as<Aggregate_plan>(p));
+  }
+  lang_unreachable("unknown plan");
+}
+
+// Execute the plan p, returning the table it computes. The result is
+// allocated in the current arena. Batches are deleted once they have
+// been read, so the nodes of the operators are allocated by new. The
+// nodes made while evaluating a condition for a row are allocated in a
+// scratch arena instead, and released after the row.
+Table*
+run_plan(Plan* p) {
+  Table* res = make_table(get_table_type(p->attrs));
+  Arena_scope scope(nullptr);
+  Operator* op = make_operator(p);
+  collect(op, res);
+  delete op;
+  return res;
+}
@@ -0,0 +1,32 @@
+
+#ifndef EXEC_HPP
+#define EXEC_HPP
+
+#include "plan.hpp"
+
+// This module defines the execution of logical plans. Each plan is
+// executed by an operator that produces the rows of its table in
+// batches. Operators pull batches from their inputs as needed, so the
+// tables computed by nested plans are never stored in full. The
+// exceptions are the inputs that an operator must read entirely before
+// it can produce any row: the right input of a join, intersect, or
+// except.
+//
+// Filters and set operations read several batches of their input at a
+// time and process them in parallel, one batch per thread. The results
+// are combined in the order of the input, so the rows of each table
+// are produced in the same order as if they were processed serially.
+
+// An operator produces the rows of a plan in batches. Each call to
+// next returns a new batch, owned by the caller, or nullptr when no
+// rows remain. Batches are never empty.
+struct Operator {
+  virtual ~Operator() { }
+
+  virtual Table* next() = 0;
+};
+
+Operator* make_operator(Plan*);
+Table* run_plan(Plan*);
+
+#endif
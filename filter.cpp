@@ -0,0 +1,539 @@
+
+#include "filter.hpp"
+#include "index.hpp"
+#include "type.hpp"
+#include "value.hpp"
+#include "subst.hpp"
+#include "eval.hpp"
+#include "morsel.hpp"
+
+#include "lang/debug.hpp"
+
+#include <algorithm>
+#include <functional>
+
+// Integer comparisons over Nat columns use AVX2 when the processor
+// supports it. The kernels are compiled for AVX2 regardless of the
+// target flags and selected at run time.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define WAFFLE_AVX2 1
+#  define AVX2_TARGET __attribute__((target("avx2")))
+#  include <immintrin.h>
+#endif
+
+// -------------------------------------------------------------------------- //
+// Selections
+
+Selection::Selection(std::size_t n, bool v)
+  : n(n), words((n + 63) / 64, v ? ~std::uint64_t(0) : 0)
+{
+  if (v and n % 64)
+    words.back() = (std::uint64_t(1) << (n % 64)) - 1;
+}
+
+// Returns the number of selected rows.
+std::size_t
+Selection::count() const {
+  std::size_t n = 0;
+  for (std::uint64_t w : words)
+    n += __builtin_popcountll(w);
+  return n;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Comparison kernels
+
+namespace {
+
+enum Compare_op { eq_op, lt_op, gt_op };
+
+// Returns the comparison op' such that 'b op' a' whenever 'a op b'.
+inline Compare_op
+flip(Compare_op op) {
+  switch (op) {
+  case eq_op: return eq_op;
+  case lt_op: return gt_op;
+  case gt_op: return lt_op;
+  }
+  lang_unreachable("unknown comparison");
+}
+
+// An operand of a comparison that has the same value for each row.
+template<typename T>
+  struct Const_rhs {
+    T operator[](std::size_t) const { return value; }
+    T value;
+  };
+
+// An operand of a comparison whose values are materialized from a
+// column.
+struct Column_values {
+  Term* operator[](std::size_t i) const { return col->get(i); }
+  const Column* col;
+};
+
+struct Same_op {
+  bool operator()(Term* a, Term* b) const { return is_same(a, b); }
+};
+
+struct Less_op {
+  bool operator()(Term* a, Term* b) const { return is_less(a, b); }
+};
+
+// A range of rows, from first up to, but not including, last. The
+// first row is the first row of a word of a selection, and the last
+// row is either the first row of a word or the end of the selection.
+struct Rows {
+  std::size_t first;
+  std::size_t last;
+};
+
+// Set the bits of the selection s for the rows r for which 'a[i] op
+// b[i]' holds.
+template<typename Op, typename A, typename B>
+  void
+  compare_rows(Op op, const A& a, const B& b, Rows r, Selection& s) {
+    for (std::size_t i = r.first; i < r.last; i += 64) {
+      std::size_t m = std::min<std::size_t>(64, r.last - i);
+      std::uint64_t bits = 0;
+      for (std::size_t k = 0; k < m; ++k)
+        bits |= std::uint64_t(op(a[i + k], b[i + k])) << k;
+      s.words[i / 64] = bits;
+    }
+  }
+
+// Select the rows r for which 'a op b' holds.
+template<typename T, typename A, typename B>
+  void
+  compare_values(Compare_op op, const A& a, const B& b, Rows r, Selection& s) {
+    switch (op) {
+    case eq_op: return compare_rows(std::equal_to<T>(), a, b, r, s);
+    case lt_op: return compare_rows(std::less<T>(), a, b, r, s);
+    case gt_op: return compare_rows(std::greater<T>(), a, b, r, s);
+    }
+  }
+
+#if WAFFLE_AVX2
+struct Avx2_eq {
+  AVX2_TARGET __m256i
+  operator()(__m256i a, __m256i b) const { return _mm256_cmpeq_epi64(a, b); }
+};
+
+struct Avx2_lt {
+  AVX2_TARGET __m256i
+  operator()(__m256i a, __m256i b) const { return _mm256_cmpgt_epi64(b, a); }
+};
+
+struct Avx2_gt {
+  AVX2_TARGET __m256i
+  operator()(__m256i a, __m256i b) const { return _mm256_cmpgt_epi64(a, b); }
+};
+
+// Set the bits of the selection s for each full word of the rows r
+// for which 'a[i] op b[i]' holds, four rows at a time. When b is null,
+// each a[i] is compared with c. Returns the first row not compared.
+template<typename Op>
+  AVX2_TARGET std::size_t
+  compare_nats_avx2(Op op, const std::int64_t* a, const std::int64_t* b,
+                    std::int64_t c, Rows r, Selection& s) {
+    std::size_t n = r.first + (r.last - r.first) / 64 * 64;
+    __m256i vc = _mm256_set1_epi64x(c);
+    for (std::size_t i = r.first; i < n; i += 64) {
+      std::uint64_t bits = 0;
+      for (std::size_t k = 0; k < 64; k += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i + k));
+        __m256i vb = b ? _mm256_loadu_si256((const __m256i*)(b + i + k)) : vc;
+        __m256i m = op(va, vb);
+        bits |= std::uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(m))) << k;
+      }
+      s.words[i / 64] = bits;
+    }
+    return n;
+  }
+
+// Returns true if the processor supports AVX2.
+inline bool
+has_avx2() {
+  static bool b = __builtin_cpu_supports("avx2");
+  return b;
+}
+#endif
+
+// Select the rows r for which 'a[i] op b[i]' holds. When b is null,
+// each a[i] is compared with c.
+void
+compare_nats(Compare_op op, const std::int64_t* a, const std::int64_t* b,
+             std::int64_t c, Rows r, Selection& s) {
+#if WAFFLE_AVX2
+  if (has_avx2()) {
+    switch (op) {
+    case eq_op: r.first = compare_nats_avx2(Avx2_eq(), a, b, c, r, s); break;
+    case lt_op: r.first = compare_nats_avx2(Avx2_lt(), a, b, c, r, s); break;
+    case gt_op: r.first = compare_nats_avx2(Avx2_gt(), a, b, c, r, s); break;
+    }
+  }
+#endif
+  if (b)
+    compare_values<std::int64_t>(op, a, b, r, s);
+  else
+    compare_values<std::int64_t>(op, a, Const_rhs<std::int64_t>{c}, r, s);
+}
+
+// An operand of a comparison. This is either a column of the table
+// or a constant value.
+struct Operand {
+  const Column* col;
+  Term* value;
+};
+
+// Returns true if t is a value that does not depend on the row being
+// filtered.
+inline bool
+is_constant(Term* t) {
+  switch (t->kind) {
+  case true_term:
+  case false_term:
+  case int_term:
+  case str_term:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Determine the operand of a comparison for the term t. Returns
+// false if t is neither a column of the table nor a constant.
+bool
+get_operand(Term* t, Table* table, const Attr_seq& attrs, Operand& x) {
+  int i = get_column_index(t, attrs);
+  if (i >= 0) {
+    x = {&table->t1[i], nullptr};
+    return true;
+  }
+  if (is_constant(t)) {
+    x = {nullptr, t};
+    return true;
+  }
+  return false;
+}
+
+// Returns true if the constant t is an integer that can be compared
+// with the values of a Nat column, storing it in n.
+inline bool
+get_nat(Term* t, std::int64_t& n) {
+  if (Int* z = as<Int>(t)) {
+    if (z->value().is_small()) {
+      n = z->value().small();
+      return true;
+    }
+  }
+  return false;
+}
+
+// Select the rows r for which 'a op b' holds, where a is a column.
+// Columns of the same storage class are compared directly. Other
+// operands are compared by value.
+void
+compare_column(Compare_op op, const Column& a, Operand b, Rows r, Selection& s) {
+  const Column* c = b.col;
+  std::int64_t n;
+  switch (a.kind) {
+  case nat_column:
+    if (c and c->kind == nat_column)
+      return compare_nats(op, a.nats.data(), c->nats.data(), 0, r, s);
+    if (not c and get_nat(b.value, n))
+      return compare_nats(op, a.nats.data(), nullptr, n, r, s);
+    break;
+  case int_column:
+    if (c and c->kind == int_column)
+      return compare_values<Integer>(op, a.ints.data(), c->ints.data(), r, s);
+    if (not c and b.value->kind == int_term)
+      return compare_values<Integer>(op, a.ints.data(), Const_rhs<const Integer&>{as<Int>(b.value)->value()}, r, s);
+    break;
+  case str_column:
+    // Strings are only compared for equality.
+    if (op != eq_op)
+      break;
+    if (c and c->kind == str_column)
+      return compare_values<String>(op, a.strs.data(), c->strs.data(), r, s);
+    if (not c and b.value->kind == str_term)
+      return compare_values<String>(op, a.strs.data(), Const_rhs<String>{as<Str>(b.value)->value()}, r, s);
+    break;
+  default:
+    break;
+  }
+
+  Column_values va {&a};
+  Column_values vb {c};
+  Const_rhs<Term*> kb {b.value};
+  if (op == eq_op)
+    return c ? compare_rows(Same_op(), va, vb, r, s) : compare_rows(Same_op(), va, kb, r, s);
+  if (op == lt_op)
+    return c ? compare_rows(Less_op(), va, vb, r, s) : compare_rows(Less_op(), va, kb, r, s);
+  auto gt = [](Term* x, Term* y) { return is_less(y, x); };
+  return c ? compare_rows(gt, va, vb, r, s) : compare_rows(gt, va, kb, r, s);
+}
+
+// Select the rows for which 'a op b' holds, comparing each morsel of
+// the column in parallel.
+void
+compare_column(Compare_op op, const Column& a, Operand b, Selection& s) {
+  for_each_morsel(s.n, get_morsel_size(), [&](std::size_t first, std::size_t last) {
+    compare_column(op, a, b, {first, last}, s);
+  });
+}
+
+// Select the rows for which 'a op v' holds using an index on the
+// i-th column of the table t. Indexes are only available when t is
+// the value of a definition. Equality is answered by a hash index and
+// ordering by a sorted index. Returns false if no index can be used.
+bool
+select_indexed(Compare_op op, Table* t, Def* d, int i, Term* v, Selection& s) {
+  Index_set* ix = d ? get_indexes(d) : nullptr;
+  if (not ix or ix->table != t)
+    return false;
+  const Column* a = &t->t1[i];
+
+  if (op == eq_op) {
+    if (not is_same(get_type(v), a->type))
+      return false;
+    s = Selection(t->size());
+    if (const Row_list* rows = get_hash_index(ix, i)->find(v)) {
+      for (std::size_t r : *rows)
+        s.set(r);
+    }
+    return true;
+  }
+
+  Int* z = as<Int>(v);
+  Sorted_index* si = z ? get_sorted_index(ix, i) : nullptr;
+  if (not si)
+    return false;
+  std::size_t first = 0;
+  std::size_t last = si->rows.size();
+  if (op == lt_op)
+    last = si->lower_bound(z->value());
+  else
+    first = si->upper_bound(z->value());
+  s = Selection(t->size());
+  for (std::size_t k = first; k < last; ++k)
+    s.set(si->rows[k]);
+  return true;
+}
+
+// Select the rows for which 't1 op t2' holds. Returns false if the
+// operands cannot be compared column-wise.
+bool
+select_compare(Compare_op op, Term* t1, Term* t2, Table* t, const Attr_seq& attrs, Selection& s) {
+  Operand a, b;
+  if (not get_operand(t1, t, attrs, a) or not get_operand(t2, t, attrs, b))
+    return false;
+
+  // Comparisons of constants are the same for every row.
+  if (not a.col and not b.col) {
+    bool v = op == eq_op ? is_same(a.value, b.value) : is_less(a.value, b.value);
+    s = Selection(t->size(), v);
+    return true;
+  }
+
+  // Make the column the left operand.
+  if (not a.col) {
+    std::swap(a, b);
+    op = flip(op);
+  }
+
+  // Comparisons with constants can be answered by an index on the
+  // column of a defined table.
+  int i = a.col - t->t1.data();
+  if (not b.col and select_indexed(op, t, attrs[i].def, i, b.value, s))
+    return true;
+  compare_column(op, *a.col, b, s);
+  return true;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Logical operators
+
+void
+select_and(Selection& a, const Selection& b) {
+  for (std::size_t i = 0; i < a.words.size(); ++i)
+    a.words[i] &= b.words[i];
+}
+
+void
+select_or(Selection& a, const Selection& b) {
+  for (std::size_t i = 0; i < a.words.size(); ++i)
+    a.words[i] |= b.words[i];
+}
+
+void
+select_not(Selection& a) {
+  for (std::size_t i = 0; i < a.words.size(); ++i)
+    a.words[i] = ~a.words[i];
+  if (a.n % 64)
+    a.words.back() &= (std::uint64_t(1) << (a.n % 64)) - 1;
+}
+
+// Select the rows for which c holds by evaluating c separately for
+// each row. This is used for conditions that cannot be evaluated
+// column-wise. The morsels of the table are evaluated in parallel, in
+// the environment of the calling thread. The nodes made for a row are
+// allocated in a scratch arena of the morsel, which is released after
+// the row has been evaluated.
+Selection
+select_each(Table* t, const Attr_seq& attrs, Term* c) {
+  Selection s(t->size());
+  const Frame* env = get_env();
+  for_each_morsel(t->size(), get_morsel_size(), [&](std::size_t first, std::size_t last) {
+    Env_guard guard(env);
+    Arena scratch;
+    Arena_scope scope(&scratch);
+    Arena::Mark m = scratch.mark();
+    for (std::size_t i = first; i < last; ++i) {
+      bool b = is_true(eval(subst_term(c, bind_row(t, attrs, i))));
+      scratch.release(m);
+      if (b)
+        s.set(i);
+    }
+  });
+  return s;
+}
+
+} // namespace
+
+
+// Returns the selection of rows of the table t for which the condition
+// c holds. The columns of t are referred to in c by their attributes.
+//
+// Comparisons between columns and constants are evaluated by looping
+// over the values of each column, or by an index on the column when t
+// is the value of a definition. The logical operators combine the
+// resulting selections a word at a time. Any other condition is
+// evaluated for each row. Loops over the rows of t are split into
+// morsels that are evaluated in parallel.
+Selection
+select_rows(Table* t, const Attr_seq& attrs, Term* c) {
+  switch (c->kind) {
+  case true_term:
+    return Selection(t->size(), true);
+  case false_term:
+    return Selection(t->size(), false);
+  case and_term: {
+    And* a = as<And>(c);
+    Selection s = select_rows(t, attrs, a->t1);
+    select_and(s, select_rows(t, attrs, a->t2));
+    return s;
+  }
+  case or_term: {
+    Or* o = as<Or>(c);
+    Selection s = select_rows(t, attrs, o->t1);
+    select_or(s, select_rows(t, attrs, o->t2));
+    return s;
+  }
+  case not_term: {
+    Selection s = select_rows(t, attrs, as<Not>(c)->t1);
+    select_not(s);
+    return s;
+  }
+  case equals_term: {
+    Equals* e = as<Equals>(c);
+    Selection s(t->size());
+    if (select_compare(eq_op, e->t1, e->t2, t, attrs, s))
+      return s;
+    break;
+  }
+  case less_term: {
+    Less* l = as<Less>(c);
+    Selection s(t->size());
+    if (select_compare(lt_op, l->t1, l->t2, t, attrs, s))
+      return s;
+    break;
+  }
+  default:
+    break;
+  }
+  return select_each(t, attrs, c);
+}
+
+// Returns the selection of rows of the table t for which each of the
+// conditions cs holds.
+Selection
+select_rows(Table* t, const Attr_seq& attrs, Term_seq* cs) {
+  Selection s(t->size(), true);
+  for (Term* c : *cs)
+    select_and(s, select_rows(t, attrs, c));
+  return s;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Row bindings
+
+namespace {
+
+// The members of the records bound to each definition.
+using Binding_map = std::map<Def*, Term_seq*>;
+
+// Add the values of the i-th row of t to the records bound to the
+// definitions of its columns. A member that is already bound is not
+// added again.
+void
+add_row(Binding_map& m, Table* t, const Attr_seq& attrs, std::size_t i) {
+  for (std::size_t k = 0; k < attrs.size(); ++k) {
+    const Attr& a = attrs[k];
+    if (not a.def)
+      continue;
+    Term_seq*& inits = m[a.def];
+    if (not inits)
+      inits = make<Term_seq>();
+    bool bound = false;
+    for (Term* init : *inits)
+      bound = bound or is_same(as<Init>(init)->name(), a.var->name());
+    if (bound)
+      continue;
+    Term* v = t->t1[k].get(i);
+    inits->push_back(make<Init>(get_type(v), a.var->name(), v));
+  }
+}
+
+// Returns a substitution mapping each definition to its record.
+Subst
+make_bindings(const Binding_map& m) {
+  Subst s;
+  for (const auto& b : m) {
+    Term_seq* vars = make<Term_seq>();
+    vars->reserve(b.second->size());
+    for (Term* init : *b.second) {
+      Init* i = as<Init>(init);
+      vars->push_back(make<Var>(i->name(), get_type(i)));
+    }
+    s.insert({b.first, make<Record>(make<Record_type>(get_kind_type(), vars), b.second)});
+  }
+  return s;
+}
+
+} // namespace
+
+// Returns a substitution that maps each definition referred to by the
+// columns of t to the record formed by its members in the i-th row.
+// Substituting into a condition yields the value of the condition for
+// that row.
+Subst
+bind_row(Table* t, const Attr_seq& attrs, std::size_t i) {
+  Binding_map m;
+  add_row(m, t, attrs, i);
+  return make_bindings(m);
+}
+
+// Returns a substitution for the row formed by the i-th row of a
+// followed by the j-th row of b.
+Subst
+bind_row(Table* a, const Attr_seq& attrs_a, std::size_t i, 
+         Table* b, const Attr_seq& attrs_b, std::size_t j) {
+  Binding_map m;
+  add_row(m, a, attrs_a, i);
+  add_row(m, b, attrs_b, j);
+  return make_bindings(m);
+}
@@ -0,0 +1,44 @@
+
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include "table.hpp"
+#include "subst.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// This module defines the evaluation of where-clauses over tables.
+// Rather than evaluating the condition once for each row, the
+// condition is evaluated once for the whole table, one column at a
+// time, producing a selection of the rows that satisfy it.
+
+// -------------------------------------------------------------------------- //
+// Selections
+
+// A selection is a bitmap over the rows of a table. Bit i is set when
+// row i is selected. Bits past the last row are always clear.
+struct Selection {
+  Selection(std::size_t, bool = false);
+
+  std::size_t size() const { return n; }
+
+  bool test(std::size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+  void set(std::size_t i) { words[i / 64] |= std::uint64_t(1) << (i % 64); }
+  std::size_t count() const;
+
+  std::size_t n;
+  std::vector<std::uint64_t> words;
+};
+
+Selection select_rows(Table*, const Attr_seq&, Term*);
+Selection select_rows(Table*, const Attr_seq&, Term_seq*);
+
+
+// -------------------------------------------------------------------------- //
+// Row bindings
+
+Subst bind_row(Table*, const Attr_seq&, std::size_t);
+Subst bind_row(Table*, const Attr_seq&, std::size_t, Table*, const Attr_seq&, std::size_t);
+
+#endif
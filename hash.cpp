@@ -0,0 +1,110 @@
+
+#include "ast.hpp"
+#include "table.hpp"
+
+#include "lang/debug.hpp"
+
+#include <functional>
+
+// -------------------------------------------------------------------------- //
+// Structural hashing
+//
+// The hash of an expression is computed from its kind and its subterms.
+// The function is consistent with the same-term relation: whenever
+// is_same(a, b) holds, hash_value(a) == hash_value(b). Expressions that
+// are not compared structurally by is_same are hashed by kind only.
+
+namespace {
+
+inline std::size_t
+hash_value(String s) { return std::hash<String>()(s); }
+
+inline std::size_t
+hash_value(const Integer& z) { return std::hash<Integer>()(z); }
+
+template<typename T>
+  inline std::size_t
+  hash_unary(T* t) {
+    return hash_combine(t->kind, hash_value(t->t1));
+  }
+
+template<typename T>
+  inline std::size_t
+  hash_binary(T* t) {
+    std::size_t h = hash_combine(t->kind, hash_value(t->t1));
+    return hash_combine(h, hash_value(t->t2));
+  }
+
+template<typename T>
+  inline std::size_t
+  hash_ternary(T* t) {
+    std::size_t h = hash_combine(t->kind, hash_value(t->t1));
+    h = hash_combine(h, hash_value(t->t2));
+    return hash_combine(h, hash_value(t->t3));
+  }
+
+// Hash each element of a sequence in order.
+template<typename T>
+  inline std::size_t
+  hash_seq(std::size_t h, Seq<T>* s) {
+    for (T* t : *s)
+      h = hash_combine(h, hash_value(t));
+    return h;
+  }
+
+// Two refs are the same when they refer to the same declaration,
+// so hash the address of the declaration.
+inline std::size_t
+hash_ref(Ref* t) {
+  return hash_combine(t->kind, std::hash<Expr*>()(t->decl()));
+}
+
+// Hash each row of a table in order.
+inline std::size_t
+hash_table(Table* t) {
+  std::size_t h = list_term;
+  for (std::size_t i = 0; i < t->size(); ++i)
+    h = hash_combine(h, hash_row(t, i));
+  return h;
+}
+
+inline std::size_t
+hash_fn_type(Fn_type* t) {
+  std::size_t h = hash_seq(t->kind, t->parms());
+  return hash_combine(h, hash_value(t->result()));
+}
+
+} // namespace
+
+
+std::size_t
+hash_value(Expr* e) {
+  if (e->canon)
+    return e->canon->hc;
+  switch (e->kind) {
+  case id_expr: return hash_unary(as<Id>(e));
+  case int_term: return hash_combine(e->kind, hash_value(as<Int>(e)->value()));
+  case str_term: return hash_combine(e->kind, hash_value(as<Str>(e)->value()));
+  case if_term: return hash_ternary(as<If>(e));
+  case succ_term: return hash_unary(as<Succ>(e));
+  case pred_term: return hash_unary(as<Pred>(e));
+  case iszero_term: return hash_unary(as<Iszero>(e));
+  case var_term: return hash_binary(as<Var>(e));
+  case abs_term: return hash_binary(as<Abs>(e));
+  case app_term: return hash_binary(as<App>(e));
+  case ref_term: return hash_ref(as<Ref>(e));
+  case init_term: return hash_binary(as<Init>(e));
+  case tuple_term: return hash_seq(e->kind, as<Tuple>(e)->elems());
+  case list_term: return hash_seq(e->kind, as<List>(e)->elems());
+  case record_term: return hash_seq(e->kind, as<Record>(e)->members());
+  case table_term: return hash_table(as<Table>(e));
+  case arrow_type: return hash_binary(as<Arrow_type>(e));
+  case fn_type: return hash_fn_type(as<Fn_type>(e));
+  case tuple_type: return hash_seq(e->kind, as<Tuple_type>(e)->types());
+  case record_type: return hash_seq(e->kind, as<Record_type>(e)->members());
+  case list_type: return hash_unary(as<List_type>(e));
+  default: break;
+  }
+  return e->kind;
+}
+
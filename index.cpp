@@ -0,0 +1,162 @@
+
+#include "index.hpp"
+#include "type.hpp"
+
+#include "lang/debug.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+// -------------------------------------------------------------------------- //
+// Hash indexes
+
+// Build a hash index on the i-th column of the table t.
+Hash_index::Hash_index(Table* t, int i)
+  : table(t), col(&t->t1[i]), rows(t->size(), Key_hash {col}, Key_eq {col})
+{
+  for (std::size_t r = 0; r < t->size(); ++r)
+    rows[{r, nullptr}].push_back(r);
+}
+
+// Returns the rows whose value in the indexed column is v, or nullptr
+// if there are none. The type of v must be the type of the column.
+const Row_list*
+Hash_index::find(Term* v) const {
+  auto iter = rows.find({0, v});
+  if (iter == rows.end())
+    return nullptr;
+  return &iter->second;
+}
+
+// The hash of a column value is the structural hash of the value.
+std::size_t
+Hash_index::Key_hash::operator()(const Key& k) const {
+  return k.value ? hash_value(k.value) : col->hash(k.row);
+}
+
+bool
+Hash_index::Key_eq::operator()(const Key& a, const Key& b) const {
+  if (a.value)
+    return b.value ? is_same(a.value, b.value) : col->is_same(b.row, a.value);
+  if (b.value)
+    return col->is_same(a.row, b.value);
+  return col->is_same(a.row, *col, b.row);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Sorted indexes
+
+namespace {
+
+// Returns the result of comparing the i-th value of the column c with
+// the integer z: negative if less, zero if equal, positive if greater.
+inline int
+compare_value(const Column* c, std::size_t i, const Integer& z) {
+  if (c->kind == nat_column)
+    return -compare(z, c->nats[i]);
+  return compare(c->ints[i], z);
+}
+
+} // namespace
+
+// Build a sorted index on the i-th column of the table t, which must
+// be a Nat column.
+Sorted_index::Sorted_index(Table* t, int i)
+  : col(&t->t1[i]), rows(t->size())
+{
+  for (std::size_t r = 0; r < rows.size(); ++r)
+    rows[r] = r;
+  if (col->kind == nat_column) {
+    const std::vector<std::int64_t>& v = col->nats;
+    std::stable_sort(rows.begin(), rows.end(), [&v](std::size_t a, std::size_t b) {
+      return v[a] < v[b];
+    });
+  } else {
+    const std::vector<Integer>& v = col->ints;
+    std::stable_sort(rows.begin(), rows.end(), [&v](std::size_t a, std::size_t b) {
+      return v[a] < v[b];
+    });
+  }
+}
+
+// Returns the position in the index of the first row whose value is
+// not less than z.
+std::size_t
+Sorted_index::lower_bound(const Integer& z) const {
+  auto iter = std::partition_point(rows.begin(), rows.end(), [&](std::size_t r) {
+    return compare_value(col, r, z) < 0;
+  });
+  return iter - rows.begin();
+}
+
+// Returns the position in the index of the first row whose value is
+// greater than z.
+std::size_t
+Sorted_index::upper_bound(const Integer& z) const {
+  auto iter = std::partition_point(rows.begin(), rows.end(), [&](std::size_t r) {
+    return compare_value(col, r, z) <= 0;
+  });
+  return iter - rows.begin();
+}
+
+
+// -------------------------------------------------------------------------- //
+// Index sets
+
+Index_set::Index_set(Table* t)
+  : table(t), hash(t->t1.size()), sorted(t->t1.size())
+{ }
+
+Index_set::~Index_set() {
+  for (Hash_index* h : hash)
+    delete h;
+  for (Sorted_index* s : sorted)
+    delete s;
+}
+
+namespace {
+
+// Guards the creation of indexes, which may be requested by conditions
+// evaluated in parallel. Indexes are not modified once built.
+std::mutex index_mutex;
+
+} // namespace
+
+// Returns the indexes of the table defined by d, or nullptr if d does
+// not define a table. The index set is created on first use. If the
+// definition has been re-evaluated since, its indexes are deleted.
+Index_set*
+get_indexes(Def* d) {
+  Table* t = as<Table>(d->value());
+  if (not t)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(index_mutex);
+  if (not d->t3 or d->t3->table != t) {
+    delete d->t3;
+    d->t3 = new Index_set(t);
+  }
+  return d->t3;
+}
+
+// Returns the hash index on the i-th column, building it if needed.
+Hash_index*
+get_hash_index(Index_set* s, int i) {
+  std::lock_guard<std::mutex> lock(index_mutex);
+  if (not s->hash[i])
+    s->hash[i] = new Hash_index(s->table, i);
+  return s->hash[i];
+}
+
+// Returns the sorted index on the i-th column, building it if needed.
+// Returns nullptr if the column does not store Nat values.
+Sorted_index*
+get_sorted_index(Index_set* s, int i) {
+  Column_kind k = s->table->t1[i].kind;
+  if (k != nat_column and k != int_column)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(index_mutex);
+  if (not s->sorted[i])
+    s->sorted[i] = new Sorted_index(s->table, i);
+  return s->sorted[i];
+}
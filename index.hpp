@@ -0,0 +1,89 @@
+
+#ifndef INDEX_HPP
+#define INDEX_HPP
+
+#include "table.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+// This module defines secondary indexes on the columns of defined
+// tables. Indexes are built on first use and cached on the definition
+// of the table so that later queries can find rows without scanning
+// the table.
+
+using Row_list = std::vector<std::size_t>;
+
+// -------------------------------------------------------------------------- //
+// Hash indexes
+
+// A hash index maps each distinct value of a column to the rows having
+// that value, in increasing order. Hash indexes are used to find the
+// rows for which 'x.n eq v' holds.
+//
+// A key of the index is a row of the table, or, when looking up a
+// value, the value itself. Values are hashed and compared with the
+// column directly, so a lookup allocates nothing.
+struct Hash_index {
+  Hash_index(Table*, int);
+
+  const Row_list* find(Term*) const;
+
+  struct Key {
+    std::size_t row;
+    Term* value;
+  };
+
+  struct Key_hash {
+    std::size_t operator()(const Key&) const;
+    const Column* col;
+  };
+
+  struct Key_eq {
+    bool operator()(const Key&, const Key&) const;
+    const Column* col;
+  };
+
+  Table* table;
+  const Column* col;
+  std::unordered_map<Key, Row_list, Key_hash, Key_eq> rows;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Sorted indexes
+
+// A sorted index orders the rows of a table by the values of a Nat
+// column. Rows having the same value are in increasing order. Sorted
+// indexes are used to find the rows for which 'x.n lt v' or 'v lt x.n'
+// holds.
+struct Sorted_index {
+  Sorted_index(Table*, int);
+
+  std::size_t lower_bound(const Integer&) const;
+  std::size_t upper_bound(const Integer&) const;
+
+  const Column* col;
+  Row_list rows;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Index sets
+
+// The indexes built on the columns of a defined table. There is at most
+// one index of each kind for each column.
+struct Index_set {
+  Index_set(Table*);
+  ~Index_set();
+
+  Table* table;
+  std::vector<Hash_index*> hash;
+  std::vector<Sorted_index*> sorted;
+};
+
+Index_set* get_indexes(Def*);
+Hash_index* get_hash_index(Index_set*, int);
+Sorted_index* get_sorted_index(Index_set*, int);
+
+#endif
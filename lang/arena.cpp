@@ -0,0 +1,108 @@
+
+#include "arena.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// The largest block allocated by an arena, unless a single object
+// requires more.
+constexpr std::size_t max_block_ = 16 * 1024 * 1024;
+
+// The current arena of this thread.
+thread_local Arena* current_arena_ = nullptr;
+
+} // namespace
+
+// Construct an empty arena whose first block has n bytes. Each new
+// block is twice the size of the previous one, up to a limit.
+Arena::Arena(std::size_t n)
+  : cur_(0), ptr_(nullptr), last_(nullptr), size_(n) { }
+
+Arena::~Arena() {
+  reset();
+  for (Block& b : blocks_)
+    std::free(b.first);
+}
+
+// Allocate n bytes aligned to a in the next block that can hold them,
+// adding a new block if necessary. Blocks after the current one are
+// left from a previous release.
+void*
+Arena::grow(std::size_t n, std::size_t a) {
+  std::size_t next = blocks_.empty() ? 0 : cur_ + 1;
+  while (next < blocks_.size()) {
+    Block& b = blocks_[next];
+    if (static_cast<std::size_t>(b.last - b.first) >= n + a)
+      break;
+    ++next;
+  }
+  if (next == blocks_.size()) {
+    if (not blocks_.empty() and size_ < max_block_)
+      size_ *= 2;
+    std::size_t m = n + a > size_ ? n + a : size_;
+    char* p = static_cast<char*>(std::malloc(m));
+    if (not p)
+      throw std::bad_alloc();
+    blocks_.push_back({p, p + m});
+  }
+  cur_ = next;
+  ptr_ = blocks_[cur_].first;
+  last_ = blocks_[cur_].last;
+  return allocate(n, a);
+}
+
+// Destroy the objects constructed after the mark m, in the reverse
+// order of their construction, and reuse their memory.
+void
+Arena::release(const Mark& m) {
+  while (dtors_.size() > m.dtors) {
+    Dtor d = dtors_.back();
+    dtors_.pop_back();
+    d.fn(d.obj);
+  }
+  if (blocks_.empty())
+    return;
+  // A mark taken before the first block was added has no pointer.
+  cur_ = m.block;
+  ptr_ = m.ptr ? m.ptr : blocks_[cur_].first;
+  last_ = blocks_[cur_].last;
+}
+
+// Returns true when p points into memory allocated by the arena and
+// not since released.
+bool
+Arena::owns(const void* p) const {
+  const char* c = static_cast<const char*>(p);
+  if (blocks_.empty())
+    return false;
+  if (blocks_[cur_].first <= c and c < ptr_)
+    return true;
+  for (std::size_t i = 0; i < cur_; ++i)
+    if (blocks_[i].first <= c and c < blocks_[i].last)
+      return true;
+  return false;
+}
+
+// Returns the number of bytes in the blocks of the arena that are in
+// use, including the unused end of each block before the current one.
+std::size_t
+Arena::used() const {
+  if (blocks_.empty())
+    return 0;
+  std::size_t n = ptr_ - blocks_[cur_].first;
+  for (std::size_t i = 0; i < cur_; ++i)
+    n += blocks_[i].last - blocks_[i].first;
+  return n;
+}
+
+// Returns the current arena of this thread, or nullptr if nodes are
+// allocated by new.
+Arena*
+get_arena() { return current_arena_; }
+
+Arena_scope::Arena_scope(Arena* a)
+  : prev(current_arena_) { current_arena_ = a; }
+
+Arena_scope::~Arena_scope() { current_arena_ = prev; }
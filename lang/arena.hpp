@@ -0,0 +1,101 @@
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// -------------------------------------------------------------------------- //
+// Arenas
+
+// An arena allocates objects by advancing a pointer through large
+// blocks of memory. Objects are not freed individually. Instead, the
+// arena is released as a whole, or back to a previous mark, which
+// destroys each object constructed since in the reverse order of
+// construction. Released blocks are kept for later allocations.
+//
+// An arena is used by a single thread.
+class Arena {
+public:
+  // A position in the arena. Releasing the arena to a mark destroys
+  // the objects allocated after the mark was taken.
+  struct Mark {
+    std::size_t block;
+    char* ptr;
+    std::size_t dtors;
+  };
+
+  explicit Arena(std::size_t = 64 * 1024);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Allocation
+  void* allocate(std::size_t, std::size_t);
+
+  template<typename T, typename... Args>
+    T* make(Args&&...);
+
+  // Release
+  Mark mark() const;
+  void release(const Mark&);
+  void reset();
+
+  // Observers
+  bool owns(const void*) const;
+  std::size_t used() const;
+
+private:
+  struct Block {
+    char* first;
+    char* last;
+  };
+
+  // A destructor to be run on release.
+  struct Dtor {
+    void* obj;
+    void (*fn)(void*);
+  };
+
+  template<typename T>
+    static void destroy(void*);
+
+  void* grow(std::size_t, std::size_t);
+
+private:
+  std::vector<Block> blocks_;
+  std::vector<Dtor> dtors_;
+  std::size_t cur_;
+  char* ptr_;
+  char* last_;
+  std::size_t size_;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Current arena
+//
+// Each thread has a current arena, in which nodes are allocated (see
+// make in nodes.hpp). When there is no current arena, nodes are
+// allocated by new.
+
+Arena* get_arena();
+
+// Sets the current arena of this thread for the lifetime of the
+// object, restoring the previous arena on exit. A null arena selects
+// allocation by new.
+struct Arena_scope {
+  explicit Arena_scope(Arena*);
+  ~Arena_scope();
+
+  Arena_scope(const Arena_scope&) = delete;
+  Arena_scope& operator=(const Arena_scope&) = delete;
+
+  Arena* prev;
+};
+
+#include "arena.ipp"
+
+#endif
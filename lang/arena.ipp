@@ -0,0 +1,40 @@
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// Returns a pointer to n bytes of memory aligned to a, which must be
+// a power of two.
+inline void*
+Arena::allocate(std::size_t n, std::size_t a) {
+  std::size_t pad = -reinterpret_cast<std::uintptr_t>(ptr_) & (a - 1);
+  if (static_cast<std::size_t>(last_ - ptr_) < n + pad)
+    return grow(n, a);
+  char* p = ptr_ + pad;
+  ptr_ = p + n;
+  return p;
+}
+
+// Returns a new object of type T constructed from args. The object is
+// destroyed when the arena is released past it.
+template<typename T, typename... Args>
+  inline T*
+  Arena::make(Args&&... args) {
+    void* p = allocate(sizeof(T), alignof(T));
+    T* t = new (p) T(std::forward<Args>(args)...);
+    if (not std::is_trivially_destructible<T>::value)
+      dtors_.push_back({t, &destroy<T>});
+    return t;
+  }
+
+template<typename T>
+  void
+  Arena::destroy(void* p) { static_cast<T*>(p)->~T(); }
+
+// Returns the current position in the arena.
+inline Arena::Mark
+Arena::mark() const { return {cur_, ptr_, dtors_.size()}; }
+
+// Release every object in the arena.
+inline void
+Arena::reset() { release({0, nullptr, 0}); }
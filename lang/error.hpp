@@ -3,6 +3,7 @@
 #define ERROR_HPP
 
 #include <iosfwd>
+#include <vector>
 
 #include "string.hpp"
 #include "integer.hpp"
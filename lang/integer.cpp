@@ -1,14 +1,125 @@
-
 #include <stdexcept>
 
 #include "integer.hpp"
 #include "debug.hpp"
 
+namespace {
+
+// A read-only GMP view of an integer. A small integer is copied into
+// a temporary GMP integer, which is released with the view.
+struct Mpz_view {
+  Mpz_view(const Integer& z) {
+    if (z.is_small()) {
+      mpz_init_set_si(tmp, z.small());
+      p = tmp;
+    } else {
+      p = z.data();
+    }
+  }
+  ~Mpz_view() {
+    if (p == tmp)
+      mpz_clear(tmp);
+  }
+
+  Mpz_view(const Mpz_view&) = delete;
+  Mpz_view& operator=(const Mpz_view&) = delete;
+
+  mpz_t tmp;
+  mpz_srcptr p;
+};
+
+} // namespace
+
 // Consruct an integer with the value in s in base b. Behavior is undefined
 // if s does not represent an integer in base b.
-Integer::Integer(String s, int b) 
-  : base_(b)
+Integer::Integer(String s, int b)
+  : small_(0), base_(b), is_small_(true)
 {
-  if (mpz_init_set_str(value_, s.data(), base_) == -1)
+  mpz_t z;
+  if (mpz_init_set_str(z, s.data(), base_) == -1) {
+    mpz_clear(z);
     lang_unreachable("invalid integer representation");
+  }
+  assign(z);
+}
+
+// Set this value to the GMP integer z, taking ownership of z. The value
+// is stored inline when it fits.
+void
+Integer::assign(mpz_t z) {
+  clear();
+  if (mpz_fits_slong_p(z)) {
+    small_ = mpz_get_si(z);
+    mpz_clear(z);
+  } else {
+    big_[0] = z[0];
+    is_small_ = false;
+  }
+}
+
+// Set this value to the result of the GMP operation f on this value
+// and x. This is used when either operand is large, or when the result
+// of a small operation overflows.
+Integer&
+Integer::apply(Binary_fn f, const Integer& x) {
+  mpz_t r;
+  mpz_init(r);
+  {
+    Mpz_view a(*this);
+    Mpz_view b(x);
+    f(r, a.p, b.p);
+  }
+  assign(r);
+  return *this;
+}
+
+// Set this value to the result of the GMP operation f on this value.
+Integer&
+Integer::apply(Unary_fn f) {
+  mpz_t r;
+  mpz_init(r);
+  {
+    Mpz_view a(*this);
+    f(r, a.p);
+  }
+  assign(r);
+  return *this;
+}
+
+// Returns the representation of z in its base. Negative values are
+// written with a leading '-', as GMP does.
+std::string
+to_string(const Integer& z) {
+  int base = z.base();
+  if (z.is_small()) {
+    long n = z.small();
+    unsigned long m = n < 0 ? -static_cast<unsigned long>(n) : n;
+    char buf[72];
+    char* p = buf + sizeof(buf);
+    do {
+      *--p = "0123456789abcdef"[m % base];
+      m /= base;
+    } while (m);
+    if (n < 0)
+      *--p = '-';
+    return std::string(p, buf + sizeof(buf));
+  }
+
+  std::size_t n = mpz_sizeinbase(z.data(), base) + 2;
+  std::unique_ptr<char[]> buf(new char[n]);
+  switch (base) {
+    case 8:
+      gmp_snprintf(buf.get(), n, "%Zo", z.data());
+      break;
+    case 10:
+      gmp_snprintf(buf.get(), n, "%Zd", z.data());
+      break;
+    case 16:
+      gmp_snprintf(buf.get(), n, "%Zx", z.data());
+      break;
+    default:
+      mpz_get_str(buf.get(), base, z.data());
+      break;
+  }
+  return buf.get();
 }
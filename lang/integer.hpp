@@ -2,6 +2,7 @@
 #ifndef INTEGER_HPP
 #define INTEGER_HPP
 
+#include <climits>
 #include <memory>
 
 #include <gmp.h>
@@ -9,15 +10,25 @@
 #include "string.hpp"
 
 // The Integer class represents arbitrary integer values.
+//
+// Values that fit in a long are stored inline, and arithmetic on them
+// does not allocate. A value is promoted to a GMP integer only when it
+// does not fit, and an arithmetic result that fits is demoted again.
+// The representation of each value is therefore unique: an integer is
+// small exactly when its value fits in a long.
 class Integer {
 public:
   // Default constructor
-  Integer(int = 10);
+  Integer();
 
   // Copy semantics
   Integer(const Integer&);
   Integer& operator=(const Integer&);
 
+  // Move semantics
+  Integer(Integer&&);
+  Integer& operator=(Integer&&);
+
   // Value initialization
   Integer(long, int = 10);
   Integer(String, int = 10);
@@ -38,11 +49,25 @@ public:
   // Observers
   int bits() const;
   int base() const;
+  bool is_small() const;
+  long small() const;
   const mpz_t& data() const;
-  
+
 private:
-  mpz_t value_;
+  using Binary_fn = void (*)(mpz_ptr, mpz_srcptr, mpz_srcptr);
+  using Unary_fn = void (*)(mpz_ptr, mpz_srcptr);
+
+  Integer& apply(Binary_fn, const Integer&);
+  Integer& apply(Unary_fn);
+  void assign(mpz_t);
+  void clear();
+
+  union {
+    long  small_;
+    mpz_t big_;
+  };
   int   base_;
+  bool  is_small_;
 };
 
 // Equality
@@ -65,6 +90,9 @@ Integer operator-(const Integer&);
 Integer operator+(const Integer&);
 
 // Comparison
+int compare(const Integer&, const Integer&);
+int compare(const Integer&, long);
+
 bool operator==(const Integer&, const Integer&);
 bool operator!=(const Integer&, const Integer&);
 bool operator<(const Integer&, const Integer&);
@@ -73,9 +101,21 @@ bool operator<=(const Integer&, const Integer&);
 bool operator>=(const Integer&, const Integer&);
 
 // Streaming
+std::string to_string(const Integer&);
+
 template<typename C, typename T>
   std::basic_ostream<C, T>& operator<<(std::basic_ostream<C, T>&, const Integer&);
 
+// Hash support for Integers.
+namespace std {
+
+template<>
+  struct hash<Integer> {
+    std::size_t operator()(const Integer&) const;
+  };
+
+} // namespace std
+
 #include "integer.ipp"
 
 #endif
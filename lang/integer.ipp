@@ -1,21 +1,111 @@
-// Default initialize the integer value.
-//
-// Note that GMP does not optimize for default-intialized values. 
+// Helper functions for small integer arithmetic. Each computes the
+// result of an operation on two longs, returning false if the result
+// overflows.
+namespace integer_impl {
+
+inline bool
+add(long a, long b, long& r) {
+#if defined(__GNUC__)
+  return not __builtin_add_overflow(a, b, &r);
+#else
+  if ((b > 0 and a > LONG_MAX - b) or (b < 0 and a < LONG_MIN - b))
+    return false;
+  r = a + b;
+  return true;
+#endif
+}
+
+inline bool
+sub(long a, long b, long& r) {
+#if defined(__GNUC__)
+  return not __builtin_sub_overflow(a, b, &r);
+#else
+  if ((b < 0 and a > LONG_MAX + b) or (b > 0 and a < LONG_MIN + b))
+    return false;
+  r = a - b;
+  return true;
+#endif
+}
+
+inline bool
+mul(long a, long b, long& r) {
+#if defined(__GNUC__)
+  return not __builtin_mul_overflow(a, b, &r);
+#else
+  if (a != 0 and b != 0) {
+    if (a > 0 ? (b > 0 ? a > LONG_MAX / b : b < LONG_MIN / a)
+              : (b > 0 ? a < LONG_MIN / b : b < LONG_MAX / a))
+      return false;
+  }
+  r = a * b;
+  return true;
+#endif
+}
+
+} // namespace integer_impl
+
+// Default initialize the integer value to 0.
 inline
-Integer::Integer(int b) : base_(b) { mpz_init(value_); }
+Integer::Integer()
+  : small_(0), base_(10), is_small_(true) { }
 
 // Copy initialize this object with x.
 inline
-Integer::Integer(const Integer& x) 
-  : base_(x.base_) 
-{ mpz_init_set(value_, x.value_); }
+Integer::Integer(const Integer& x)
+  : base_(x.base_), is_small_(x.is_small_)
+{
+  if (is_small_)
+    small_ = x.small_;
+  else
+    mpz_init_set(big_, x.big_);
+}
 
 // Copy assign this object to the value of x.
 inline Integer&
 Integer::operator=(const Integer& x) {
   if (this != &x) {
-    mpz_clear(value_);
-    mpz_set(value_, x.value_);
+    if (x.is_small_) {
+      clear();
+      small_ = x.small_;
+      is_small_ = true;
+    } else if (is_small_) {
+      mpz_init_set(big_, x.big_);
+      is_small_ = false;
+    } else {
+      mpz_set(big_, x.big_);
+    }
+    base_ = x.base_;
+  }
+  return *this;
+}
+
+// Move initialize this object with x, leaving x equal to 0.
+inline
+Integer::Integer(Integer&& x)
+  : base_(x.base_), is_small_(x.is_small_)
+{
+  if (is_small_) {
+    small_ = x.small_;
+  } else {
+    big_[0] = x.big_[0];
+    x.small_ = 0;
+    x.is_small_ = true;
+  }
+}
+
+// Move assign this object to the value of x, leaving x equal to 0.
+inline Integer&
+Integer::operator=(Integer&& x) {
+  if (this != &x) {
+    clear();
+    if (x.is_small_) {
+      small_ = x.small_;
+    } else {
+      big_[0] = x.big_[0];
+      is_small_ = false;
+      x.small_ = 0;
+      x.is_small_ = true;
+    }
     base_ = x.base_;
   }
   return *this;
@@ -24,83 +114,177 @@ Integer::operator=(const Integer& x) {
 // Construct an integer with the value n.
 inline
 Integer::Integer(long n, int b)
-  : base_(b)
-{ mpz_init_set_si(value_, n); }
+  : small_(n), base_(b), is_small_(true) { }
 
 // Destroy the ionteger, releasing resources.
 inline
-Integer::~Integer() { mpz_clear(value_); }
+Integer::~Integer() { clear(); }
 
-inline Integer& 
+// Release the GMP integer, if any. The value is then undefined until
+// it is assigned.
+inline void
+Integer::clear() {
+  if (not is_small_) {
+    mpz_clear(big_);
+    is_small_ = true;
+  }
+}
+
+inline Integer&
 Integer::operator+=(const Integer& x) {
-  mpz_add(value_, value_, x.value_);
-  return *this;
+  long r;
+  if (is_small_ and x.is_small_ and integer_impl::add(small_, x.small_, r)) {
+    small_ = r;
+    return *this;
+  }
+  return apply(mpz_add, x);
 }
 
-inline Integer& 
+inline Integer&
 Integer::operator-=(const Integer& x) {
-  mpz_sub(value_, value_, x.value_);
-  return *this;
+  long r;
+  if (is_small_ and x.is_small_ and integer_impl::sub(small_, x.small_, r)) {
+    small_ = r;
+    return *this;
+  }
+  return apply(mpz_sub, x);
 }
 
-inline Integer& 
+inline Integer&
 Integer::operator*=(const Integer& x) {
-  mpz_mul(value_, value_, x.value_);
-  return *this;
+  long r;
+  if (is_small_ and x.is_small_ and integer_impl::mul(small_, x.small_, r)) {
+    small_ = r;
+    return *this;
+  }
+  return apply(mpz_mul, x);
 }
 
 // Divide this integer value by x. Integer division is implemented as
 // floor division. A discussion of alternatives can be found in the paper,
 // "The Euclidean definition of the functions div and mod" by Raymond T.
 // Boute (http://dl.acm.org/citation.cfm?id=128862).
-inline Integer& 
+inline Integer&
 Integer::operator/=(const Integer& x) {
-  mpz_fdiv_q(value_, value_, x.value_);
-  return *this;
+  if (is_small_ and x.is_small_ and x.small_ != 0) {
+    long a = small_;
+    long b = x.small_;
+    if (b != -1) {
+      small_ = a / b;
+      if (a % b != 0 and (a < 0) != (b < 0))
+        --small_;
+      return *this;
+    }
+    if (a != LONG_MIN) {
+      small_ = -a;
+      return *this;
+    }
+  }
+  return apply(mpz_fdiv_q, x);
 }
 
 // Compute the remainder of the division of this value_ by x. Integer division
 // is implemented as floor division. See the notes on operator/= for more
 // discussion.
-inline Integer& 
+inline Integer&
 Integer::operator%=(const Integer& x) {
-  mpz_fdiv_r(value_, value_, x.value_);
-  return *this;
+  if (is_small_ and x.is_small_ and x.small_ != 0) {
+    long b = x.small_;
+    if (b == -1) {
+      small_ = 0;
+      return *this;
+    }
+    small_ %= b;
+    if (small_ != 0 and (small_ < 0) != (b < 0))
+      small_ += b;
+    return *this;
+  }
+  return apply(mpz_fdiv_r, x);
 }
 
 // Negate this value.
 inline Integer&
 Integer::neg() {
-  mpz_neg(value_, value_);
-  return *this;
+  if (is_small_ and small_ != LONG_MIN) {
+    small_ = -small_;
+    return *this;
+  }
+  return apply(mpz_neg);
 }
 
 // Set this value to its absolute value.
 inline Integer&
 Integer::abs() {
-  mpz_abs(value_, value_);
-  return *this;
+  if (is_small_ and small_ != LONG_MIN) {
+    if (small_ < 0)
+      small_ = -small_;
+    return *this;
+  }
+  return apply(mpz_abs);
 }
 
 // Returns the number of bits in the integer representation.
 inline int
-Integer::bits() const { return mpz_sizeinbase(value_, 2); }
+Integer::bits() const {
+  if (not is_small_)
+    return mpz_sizeinbase(big_, 2);
+  unsigned long m = small_ < 0 ? -static_cast<unsigned long>(small_) : small_;
+  int n = 1;
+  while (m >>= 1)
+    ++n;
+  return n;
+}
 
 // Returns the base of in which the inteer should be formatted.
 inline int
 Integer::base() const { return base_; }
 
-inline const mpz_t& 
-Integer::data() const { return value_; }
+// Returns true when the value is stored inline. This is exactly when
+// the value fits in a long.
+inline bool
+Integer::is_small() const { return is_small_; }
+
+// Returns the value of a small integer.
+inline long
+Integer::small() const { return small_; }
+
+// Returns the GMP representation of an integer that is not small.
+inline const mpz_t&
+Integer::data() const { return big_; }
+
+// Returns the result of comparing a and b: negative if a is less than
+// b, zero if they are equal, and positive if a is greater than b.
+inline int
+compare(const Integer& a, const Integer& b) {
+  if (a.is_small() and b.is_small())
+    return (a.small() > b.small()) - (a.small() < b.small());
+  if (a.is_small())
+    return -mpz_cmp_si(b.data(), a.small());
+  if (b.is_small())
+    return mpz_cmp_si(a.data(), b.small());
+  return mpz_cmp(a.data(), b.data());
+}
+
+// Returns the result of comparing a with the value n.
+inline int
+compare(const Integer& a, long n) {
+  if (a.is_small())
+    return (a.small() > n) - (a.small() < n);
+  return mpz_cmp_si(a.data(), n);
+}
 
 // Equality comparison
-// Returns true when the two integers have the same value.
+// Returns true when the two integers have the same value. Since the
+// representation of each value is unique, integers of different
+// representations are never equal.
 inline bool
 operator==(const Integer& a, const Integer& b) {
-  return mpz_cmp(a.data(), b.data()) == 0;
+  if (a.is_small() and b.is_small())
+    return a.small() == b.small();
+  return compare(a, b) == 0;
 }
 
-inline bool 
+inline bool
 operator!=(const Integer& a, const Integer& b) {
   return not(a == b);
 }
@@ -109,7 +293,9 @@ operator!=(const Integer& a, const Integer& b) {
 // Returns true when a is less than b.
 inline bool
 operator<(const Integer& a, const Integer& b) {
-  return mpz_cmp(a.data(), b.data()) < 0;
+  if (a.is_small() and b.is_small())
+    return a.small() < b.small();
+  return compare(a, b) < 0;
 }
 
 inline bool
@@ -167,20 +353,29 @@ operator+(const Integer& x) {
 template<typename C, typename T>
   inline std::basic_ostream<C, T>&
   operator<<(std::basic_ostream<C, T>& os, const Integer& z) {
-    int  base = z.base();
-    std::size_t n = mpz_sizeinbase(z.data(), base) + 1;
-    std::unique_ptr<char[]> buf(new char[n]);
-    switch (base) {
-      case 8:
-        gmp_snprintf(buf.get(), n, "%Zo", z.data());
-        break;
-      case 10:
-        gmp_snprintf(buf.get(), n, "%Zd", z.data());
-        break;
-      case 16:
-        gmp_snprintf(buf.get(), n, "%Zx", z.data());
-        break;
-    }
-    return os << buf.get(); 
+    return os << to_string(z);
   }
 
+namespace std {
+
+// Hash the integer's value. The sign and each limb of the magnitude
+// contribute to the hash, so equal values have equal hashes regardless
+// of their formatting base. A small value has a single limb.
+inline std::size_t
+hash<Integer>::operator()(const Integer& z) const {
+  if (z.is_small()) {
+    static_assert(GMP_LIMB_BITS == 64, "unsupported limb size");
+    long n = z.small();
+    std::size_t h = (n > 0) - (n < 0) + 1;
+    if (n != 0)
+      h = h * 31 + (n < 0 ? -static_cast<unsigned long>(n) : n);
+    return h;
+  }
+  std::size_t h = mpz_sgn(z.data()) + 1;
+  std::size_t n = mpz_size(z.data());
+  for (std::size_t i = 0; i < n; ++i)
+    h = h * 31 + mpz_getlimbn(z.data(), i);
+  return h;
+}
+
+} // namespace std
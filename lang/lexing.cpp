@@ -1,2 +1,293 @@
 
 #include "lexing.hpp"
+
+// Scanning uses SSE2, and AVX2 when the processor supports it. The
+// AVX2 kernels are compiled for AVX2 regardless of the target flags
+// and selected at run time. Other processors scan one character at a
+// time.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define WAFFLE_SSE2 1
+#  define AVX2_TARGET __attribute__((target("avx2")))
+#  include <immintrin.h>
+#endif
+
+namespace lex {
+
+namespace {
+
+// -------------------------------------------------------------------------- //
+// Character classes
+//
+// Each class tests a single character, or 16 or 32 characters at once,
+// giving a mask whose bytes are all ones for the characters in the
+// class. Characters outside of ASCII are in no class.
+
+#if WAFFLE_SSE2
+// Returns a mask of the characters of v that are equal to c.
+inline __m128i
+eq16(__m128i v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+
+// Returns a mask of the characters of v in [lo, hi]. Bytes are signed,
+// so characters outside of ASCII are less than lo.
+inline __m128i
+range16(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+// Returns a mask of the letters in v.
+inline __m128i
+alpha16(__m128i v) { return range16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'); }
+
+AVX2_TARGET inline __m256i
+eq32(__m256i v, char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); }
+
+AVX2_TARGET inline __m256i
+range32(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+AVX2_TARGET inline __m256i
+alpha32(__m256i v) { return range32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'); }
+#endif
+
+// Matches [ \t].
+struct Space_chars {
+  static bool test(char c) { return c == ' ' or c == '\t'; }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return _mm_or_si128(eq16(v, ' '), eq16(v, '\t')); }
+  AVX2_TARGET static __m256i match(__m256i v) { return _mm256_or_si256(eq32(v, ' '), eq32(v, '\t')); }
+#endif
+};
+
+// Matches [ \t\n].
+struct Blank_chars {
+  static bool test(char c) { return Space_chars::test(c) or c == '\n'; }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return _mm_or_si128(Space_chars::match(v), eq16(v, '\n')); }
+  AVX2_TARGET static __m256i match(__m256i v) { return _mm256_or_si256(Space_chars::match(v), eq32(v, '\n')); }
+#endif
+};
+
+// Matches [\n].
+struct Newline_chars {
+  static bool test(char c) { return c == '\n'; }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return eq16(v, '\n'); }
+  AVX2_TARGET static __m256i match(__m256i v) { return eq32(v, '\n'); }
+#endif
+};
+
+// Matches [0-9].
+struct Digit_chars {
+  static bool test(char c) { return is_digit(c); }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return range16(v, '0', '9'); }
+  AVX2_TARGET static __m256i match(__m256i v) { return range32(v, '0', '9'); }
+#endif
+};
+
+// Matches [a-zA-Z0-9].
+struct Alnum_chars {
+  static bool test(char c) { return is_alpha(c) or is_digit(c); }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return _mm_or_si128(alpha16(v), range16(v, '0', '9')); }
+  AVX2_TARGET static __m256i match(__m256i v) { return _mm256_or_si256(alpha32(v), range32(v, '0', '9')); }
+#endif
+};
+
+// Matches [a-zA-Z0-9_].
+struct Id_chars {
+  static bool test(char c) { return is_id_rest(c); }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return _mm_or_si128(Alnum_chars::match(v), eq16(v, '_')); }
+  AVX2_TARGET static __m256i match(__m256i v) { return _mm256_or_si256(Alnum_chars::match(v), eq32(v, '_')); }
+#endif
+};
+
+// Matches ["\\].
+struct Quote_chars {
+  static bool test(char c) { return c == '"' or c == '\\'; }
+#if WAFFLE_SSE2
+  static __m128i match(__m128i v) { return _mm_or_si128(eq16(v, '"'), eq16(v, '\\')); }
+  AVX2_TARGET static __m256i match(__m256i v) { return _mm256_or_si256(eq32(v, '"'), eq32(v, '\\')); }
+#endif
+};
+
+
+// -------------------------------------------------------------------------- //
+// Scanning kernels
+//
+// A kernel scans whole vectors of characters, returning the first
+// character at which it stops, or the first character that it did not
+// scan. The caller scans the remaining characters one at a time, so
+// that no vector is read past the end of the text.
+
+#if WAFFLE_SSE2
+// Returns true if the processor supports AVX2.
+inline bool
+has_avx2() {
+  static bool b = __builtin_cpu_supports("avx2");
+  return b;
+}
+
+// Returns the bits of the mask m, one per character. When in is false,
+// the bits are set for the characters not in the class.
+inline unsigned
+bits(__m128i m, bool in) {
+  unsigned b = _mm_movemask_epi8(m);
+  return in ? b : ~b & 0xffff;
+}
+
+AVX2_TARGET inline unsigned
+bits(__m256i m, bool in) {
+  unsigned b = _mm256_movemask_epi8(m);
+  return in ? b : ~b;
+}
+
+// Returns the first character in [p, last) that is in the class C when
+// in is true, or not in C otherwise.
+template<typename C>
+  const char*
+  scan16(const char* p, const char* last, bool in) {
+    for (; last - p >= 16; p += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      if (unsigned b = bits(C::match(v), in))
+        return p + __builtin_ctz(b);
+    }
+    return p;
+  }
+
+template<typename C>
+  AVX2_TARGET const char*
+  scan32(const char* p, const char* last, bool in) {
+    for (; last - p >= 32; p += 32) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      if (unsigned b = bits(C::match(v), in))
+        return p + __builtin_ctz(b);
+    }
+    return p;
+  }
+
+// Update the location for the n blank characters of a vector, where
+// nl has a bit set for each newline among them.
+inline void
+count_lines(Location& loc, unsigned nl, int n) {
+  if (nl) {
+    loc.line += __builtin_popcount(nl);
+    loc.col = n - (31 - __builtin_clz(nl));
+  } else {
+    loc.col += n;
+  }
+}
+
+// Returns the first character in [p, last) that is not blank,
+// counting the lines and columns skipped.
+const char*
+skip_blank16(const char* p, const char* last, Location& loc) {
+  for (; last - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned stop = bits(Blank_chars::match(v), false);
+    unsigned nl = bits(Newline_chars::match(v), true);
+    int n = stop ? __builtin_ctz(stop) : 16;
+    count_lines(loc, nl & ((1u << n) - 1), n);
+    if (stop)
+      return p + n;
+  }
+  return p;
+}
+
+AVX2_TARGET const char*
+skip_blank32(const char* p, const char* last, Location& loc) {
+  for (; last - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned stop = bits(Blank_chars::match(v), false);
+    unsigned nl = bits(Newline_chars::match(v), true);
+    int n = stop ? __builtin_ctz(stop) : 32;
+    count_lines(loc, n < 32 ? nl & ((1u << n) - 1) : nl, n);
+    if (stop)
+      return p + n;
+  }
+  return p;
+}
+#endif
+
+// Returns the first character in [p, last) that is in the class C when
+// in is true, or not in C otherwise.
+template<typename C>
+  inline const char*
+  scan(const char* p, const char* last, bool in) {
+#if WAFFLE_SSE2
+    if (has_avx2())
+      p = scan32<C>(p, last, in);
+    else
+      p = scan16<C>(p, last, in);
+#endif
+    while (p != last and C::test(*p) != in)
+      ++p;
+    return p;
+  }
+
+} // namespace
+
+
+// -------------------------------------------------------------------------- //
+// Scanning
+
+// Returns the first character in [first, last) that is not a space,
+// tab, or newline. The location is advanced past the skipped
+// characters.
+const char*
+skip_blank(const char* first, const char* last, Location& loc) {
+#if WAFFLE_SSE2
+  if (has_avx2())
+    first = skip_blank32(first, last, loc);
+  else
+    first = skip_blank16(first, last, loc);
+#endif
+  for (; first != last and Blank_chars::test(*first); ++first) {
+    if (*first == '\n') {
+      ++loc.line;
+      loc.col = 1;
+    } else {
+      ++loc.col;
+    }
+  }
+  return first;
+}
+
+// Returns the first character in [first, last) that is not a letter
+// or digit.
+const char*
+skip_alnum(const char* first, const char* last) {
+  return scan<Alnum_chars>(first, last, false);
+}
+
+// Returns the first character in [first, last) that cannot continue
+// an identifier.
+const char*
+skip_id_rest(const char* first, const char* last) {
+  return scan<Id_chars>(first, last, false);
+}
+
+// Returns the first character in [first, last) that is not a digit.
+const char*
+skip_digits(const char* first, const char* last) {
+  return scan<Digit_chars>(first, last, false);
+}
+
+// Returns the first newline in [first, last), or last if there is none.
+const char*
+find_newline(const char* first, const char* last) {
+  return scan<Newline_chars>(first, last, true);
+}
+
+// Returns the first quote or backslash in [first, last), or last if
+// there is none.
+const char*
+find_quote(const char* first, const char* last) {
+  return scan<Quote_chars>(first, last, true);
+}
+
+} // namespace lex
@@ -12,6 +12,7 @@ namespace lex {
 // Characters
 template<typename L>
 	bool is_module(L& lex); //module extension
+bool is_alpha(char c);
 bool is_id_head(char c);
 bool is_id_rest(char c);
 bool is_file_rest(char c); //module extension
@@ -19,12 +20,30 @@ bool is_digit(char c);
 bool is_bin_digit(char c);
 bool is_hex_digit(char c);
 
+// -------------------------------------------------------------------------- //
+// Scanning
+//
+// These functions scan a run of characters many at a time. Each
+// returns the first character in a range at which the run stops.
+const char* skip_blank(const char*, const char*, Location&);
+const char* skip_alnum(const char*, const char*);
+const char* skip_id_rest(const char*, const char*);
+const char* skip_digits(const char*, const char*);
+const char* find_newline(const char*, const char*);
+const char* find_quote(const char*, const char*);
+
 // -------------------------------------------------------------------------- //
 // Lexer control
 
 template<typename L>
   void advance(L&, int = 1);
 
+template<typename L>
+  const char* first_ptr(L&);
+
+template<typename L>
+  const char* last_ptr(L&);
+
 template<typename L>
   void save(L& lex, Token_kind k, String str);
 
@@ -13,6 +13,17 @@ template<typename L>
     lex.loc.col += n;
   }
 
+// Returns a pointer to the current character. The characters of the
+// text are contiguous, and the lexer must not be at the end.
+template<typename L>
+  inline const char*
+  first_ptr(L& lex) { return &*lex.first; }
+
+// Returns a pointer past the last character of the text.
+template<typename L>
+  inline const char*
+  last_ptr(L& lex) { return first_ptr(lex) + (lex.last - lex.first); }
+
 // Save a token having the given location, symbol, and text.
 template<typename L>
   inline void
@@ -25,37 +36,41 @@ template<typename L>
 // Characters
 
 //Returns true if consists of [a-zA-Z0-9_] and includes a dot '.'
+//
+// The name of the module is a run of letters and digits that is
+// followed by a dot.
 template<typename L>
 inline bool
 is_module(L& lex) {
   if(is_id_head(*lex.first)) //File will start with valid id char (i.e., not a digit, parenthesis, etc...)
   {
-    auto iter = lex.first + 1;
-    while (iter != lex.last && is_file_rest(*iter)){
-      if(*iter == '.') //File must contain at least one dot to define directory
-        return true;
-      ++iter;
-    }
-    return false;
+    const char* last = last_ptr(lex);
+    const char* p = skip_alnum(first_ptr(lex) + 1, last);
+    return p != last and *p == '.'; //File must contain at least one dot to define directory
   }
   else 
     return false;
 }
+
+// Returns true if c is in [a-zA-Z].
+inline bool
+is_alpha(char c) { return unsigned((c | 0x20) - 'a') < 26; }
+
 // Returns true if c is in [a-zA-Z_].
 inline bool
-is_id_head(char c) { return std::isalpha(c) || c == '_'; }
+is_id_head(char c) { return is_alpha(c) || c == '_'; }
 
 // Returns true if c is in [a-zA-Z0-9_.]
 inline bool
-is_file_rest(char c) { return std::isalpha(c) || std::isdigit(c) || c == '.'; } 
+is_file_rest(char c) { return is_alpha(c) || is_digit(c) || c == '.'; } 
 
 // Returns true if c is in [a-zA-Z0-9_].
 inline bool
-is_id_rest(char c) {return std::isalpha(c) || std::isdigit(c) || c == '_'; }
+is_id_rest(char c) {return is_alpha(c) || is_digit(c) || c == '_'; }
 
 // Returns true if c is in [0-9].
 inline bool
-is_digit(char c) { return std::isdigit(c); }
+is_digit(char c) { return unsigned(c - '0') < 10; }
 
 // Returns true if c is in [0-1].
 inline bool
@@ -82,10 +97,14 @@ template<typename L>
       return false;
   }
 
-// Consume horizontal whitespace starting at the current character.
+// Consume the whitespace starting at the current character, including
+// newlines.
 template<typename L>
   inline void
-  space(L& lex) { advance(lex); }
+  space(L& lex) {
+    const char* p = first_ptr(lex);
+    lex.first += skip_blank(p, last_ptr(lex), lex.loc) - p;
+  }
 
 // Consume a newline starting at the current character.
 //
@@ -104,9 +123,8 @@ template<typename L>
 template<typename L>
   inline void
   comment(L& lex) {
-    lex.first += 2;
-    while (lex.first != lex.last and *lex.first != '\n')
-      ++lex.first;
+    const char* p = first_ptr(lex);
+    lex.first += find_newline(p + 2, last_ptr(lex)) - p;
   }
 
 // Consume an n-character lexeme, creating a token.
@@ -141,17 +159,16 @@ template<typename L>
 template<typename L>
   inline void
   id(L& lex) {
-    auto iter = lex.first + 1;
-    while (iter != lex.last and is_id_rest(*iter))
-      ++iter;
+    const char* p = first_ptr(lex);
+    const char* q = skip_id_rest(p + 1, last_ptr(lex));
 
-    // Build the token.
-    String str(lex.first, iter);
-    if (Token_kind k = keyword(str))
-      save(lex, k, str);
+    // Build the token. Keywords are matched against the text, so only
+    // identifiers are interned.
+    if (Token_kind k = keyword(p, q - p))
+      save(lex, k, token_name(k));
     else
-      save(lex, identifier_tok, str);
-    advance(lex, iter - lex.first);
+      save(lex, identifier_tok, String(p, q));
+    advance(lex, q - p);
   }
 
   template<typename L>
@@ -222,9 +239,8 @@ template<typename L>
 template<typename L>
   inline void
   integer(L& lex) {
-    auto iter = lex.first + 1;
-    while (iter != lex.last and is_digit(*iter))
-      ++iter;
+    const char* p = first_ptr(lex);
+    auto iter = lex.first + (skip_digits(p + 1, last_ptr(lex)) - p);
     String str(lex.first, iter);
     save(lex, decimal_literal_tok, str);
     advance(lex, iter - lex.first);
@@ -238,13 +254,16 @@ template<typename L>
 template<typename L>
   inline void
   string(L& lex) {
-    auto iter = lex.first + 1;
-    while (iter != lex.last && *iter != '"') {
-      if (*iter == '\\')
-        ++iter;
-      ++iter;
+    const char* p = first_ptr(lex);
+    const char* last = last_ptr(lex);
+    const char* q = find_quote(p + 1, last);
+    while (q != last && *q == '\\') {
+      q += last - q > 2 ? 2 : last - q;
+      q = find_quote(q, last);
     }
-    ++iter; // Keep the enclosing quote.
+    if (q != last)
+      ++q; // Keep the enclosing quote.
+    auto iter = lex.first + (q - p);
     String str(lex.first, iter);
     save(lex, string_literal_tok, str);
     advance(lex, iter - lex.first);
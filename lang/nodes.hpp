@@ -4,8 +4,11 @@
 
 #include "string.hpp"
 #include "location.hpp"
+#include "arena.hpp"
 
 #include <cstdint>
+#include <type_traits>
+#include <vector>
 
 // -------------------------------------------------------------------------- //
 // Node classification
@@ -141,9 +144,43 @@ template<typename T>
   };
 
 
+// -------------------------------------------------------------------------- //
+// Allocation
+
+// Returns a new node of type T constructed from args. The node is
+// allocated in the current arena, or by new when there is none.
+template<typename T, typename... Args> T* make(Args&&...);
+
+
 // -------------------------------------------------------------------------- //
 // Conversion and testing
 
+// The node information of a node class U describes the kinds of the
+// nodes whose dynamic type is U (or derived from U), so that as<U> and
+// is<U> can test the kind of a node instead of its dynamic type. A
+// node class specializes this template, deriving from one of the
+// definitions below. Nodes of other classes are converted by
+// dynamic_cast.
+template<typename U>
+  struct node_info { static constexpr bool tagged = false; };
+
+// The node information of a class whose nodes all have the kind K.
+template<Node_kind K>
+  struct kind_info {
+    static constexpr bool tagged = true;
+    static constexpr bool test(Node_kind k) { return k == K; }
+  };
+
+// The node information of a class whose nodes have any kind in the
+// node classes C1 through C2.
+template<Node_class C1, Node_class C2 = C1>
+  struct class_info {
+    static constexpr bool tagged = true;
+    static constexpr bool test(Node_kind k) { 
+      return C1 <= get_node_class(k) and get_node_class(k) <= C2; 
+    }
+  };
+
 template<typename U, typename T> U* as(T* t);
 template<typename U, typename T> const U* as(const T* t);
 template<typename U, typename T> bool is(const T* t);
@@ -1,16 +1,43 @@
 
+template<typename T, typename... Args>
+  inline T*
+  make(Args&&... args) {
+    static_assert(std::is_base_of<Node, T>::value, "not a node type");
+    if (Arena* a = get_arena())
+      return a->make<T>(std::forward<Args>(args)...);
+    return new T(std::forward<Args>(args)...);
+  }
+
+namespace node_impl {
+
+// Convert a tagged node by comparing its kind.
+template<typename U, typename T>
+  inline U*
+  cast(T* t, std::true_type) {
+    return t and node_info<U>::test(t->kind) ? static_cast<U*>(t) : nullptr;
+  }
+
+// Convert an untagged node by its dynamic type.
+template<typename U, typename T>
+  inline U*
+  cast(T* t, std::false_type) { return dynamic_cast<U*>(t); }
+
+} // namespace node_impl
+
 // Returns the node t dynamically converted to the node type U. If t does
 // not have the dynamic type U, the resulting term is null.
 template<typename U, typename T>
   inline U*
-  as(T* t) { return dynamic_cast<U*>(t); }
+  as(T* t) {
+    using Tagged = std::integral_constant<bool, node_info<U>::tagged>;
+    return node_impl::cast<U>(t, Tagged());
+  }
 
 template<typename U, typename T>
   inline const U*
-  as(const T* t) { return dynamic_cast<const U*>(t); }
+  as(const T* t) { return as<U>(const_cast<T*>(t)); }
 
 // Returns true if node t has dynamic type U.
 template<typename U, typename T>
   inline bool 
   is(const T* t) { return as<U>(t); }
-
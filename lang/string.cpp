@@ -1,20 +1,191 @@
 
 #include <cctype>
 #include <algorithm>
-#include <unordered_set>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
 
 #include "string.hpp"
+#include "arena.hpp"
 
 namespace {
 
-// The string table.
-static std::unordered_set<std::string> strings_;
+// Returns a 64-bit mix of the bits of h.
+inline std::uint64_t
+mix(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+// Returns the hash value of the n characters at p. The characters are
+// read a word at a time.
+std::size_t
+hash_bytes(const char* p, std::size_t n) {
+  std::uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+  for (; n >= 8; p += 8, n -= 8) {
+    std::uint64_t w;
+    std::memcpy(&w, p, 8);
+    h = (h ^ mix(w)) * 0x100000001b3ull;
+  }
+  if (n) {
+    std::uint64_t w = 0;
+    std::memcpy(&w, p, n);
+    h = (h ^ mix(w)) * 0x100000001b3ull;
+  }
+  return mix(h);
+}
+
+// The string table maps spellings to interned strings. It is divided
+// into shards, chosen by the hash of a spelling. Each shard allocates
+// its strings in its own arena, as a header followed by characters.
+//
+// A shard is an open-addressed hash table of pointers to interned
+// strings, with linear probing. A spelling is looked up by its
+// characters, so no string needs to be built to find it.
+//
+// Lookup is lock-free. Slots are only ever filled, and a string is
+// published to a slot only after it has been written, so a lookup
+// that finds a string may return it. A lookup that reaches an empty
+// slot locks the shard and looks again before inserting the string,
+// so each spelling is interned exactly once.
+//
+// When a shard grows, its strings are copied into a larger array of
+// slots, which then replaces the old one. Old arrays are kept until
+// exit, since other threads may still be searching them.
+template<typename Rep>
+  struct String_shard {
+    // An array of slots, whose size is a power of two.
+    struct Slots {
+      explicit Slots(std::size_t);
+
+      std::size_t size() const { return mask + 1; }
+
+      std::size_t mask;
+      std::unique_ptr<std::atomic<const Rep*>[]> ptrs;
+    };
+
+    String_shard();
+
+    const Rep* get(std::size_t, const char*, std::size_t);
+    const Rep* find(const Slots*, std::size_t, const char*, std::size_t, std::size_t&) const;
+    void grow();
+
+    std::mutex mutex;
+    Arena arena;
+    std::atomic<Slots*> slots;
+    std::vector<std::unique_ptr<Slots>> arrays;
+    std::size_t count;
+  };
+
+template<typename Rep>
+  String_shard<Rep>::Slots::Slots(std::size_t n)
+    : mask(n - 1), ptrs(new std::atomic<const Rep*>[n])
+  {
+    for (std::size_t i = 0; i < n; ++i)
+      ptrs[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+template<typename Rep>
+  String_shard<Rep>::String_shard()
+    : arena(4 * 1024), count(0)
+  {
+    arrays.emplace_back(new Slots(64));
+    slots.store(arrays.back().get(), std::memory_order_release);
+  }
+
+// The number of shards is a power of two. The low bits of a hash select
+// the shard, and the remaining bits the first slot to probe.
+constexpr int shard_bits = 6;
+constexpr std::size_t shard_count = std::size_t(1) << shard_bits;
+
+// Returns the string in s whose spelling is the n characters at p,
+// and whose hash is h. When there is none, returns nullptr and sets
+// i to the empty slot at which the string belongs.
+template<typename Rep>
+  const Rep*
+  String_shard<Rep>::find(const Slots* s, std::size_t h, const char* p, std::size_t n, std::size_t& i) const {
+    i = (h >> shard_bits) & s->mask;
+    while (const Rep* r = s->ptrs[i].load(std::memory_order_acquire)) {
+      if (r->hash == h and r->size == n and std::memcmp(r->data(), p, n) == 0)
+        return r;
+      i = (i + 1) & s->mask;
+    }
+    return nullptr;
+  }
+
+// Returns the interned string whose spelling is the n characters at
+// p, and whose hash is h, inserting one if there is none.
+template<typename Rep>
+  const Rep*
+  String_shard<Rep>::get(std::size_t h, const char* p, std::size_t n) {
+    std::size_t i;
+    if (const Rep* r = find(slots.load(std::memory_order_acquire), h, p, n, i))
+      return r;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Slots* s = slots.load(std::memory_order_relaxed);
+    if (const Rep* r = find(s, h, p, n, i))
+      return r;
+    void* mem = arena.allocate(sizeof(Rep) + n + 1, alignof(Rep));
+    Rep* r = new (mem) Rep {h, n};
+    char* d = reinterpret_cast<char*>(r + 1);
+    std::memcpy(d, p, n);
+    d[n] = 0;
+    s->ptrs[i].store(r, std::memory_order_release);
+    if (++count * 2 > s->size())
+      grow();
+    return r;
+  }
+
+// Replaces the slots of the shard with an array twice the size. The
+// shard must be locked.
+template<typename Rep>
+  void
+  String_shard<Rep>::grow() {
+    Slots* old = slots.load(std::memory_order_relaxed);
+    arrays.emplace_back(new Slots(old->size() * 2));
+    Slots* s = arrays.back().get();
+    for (std::size_t j = 0; j < old->size(); ++j) {
+      const Rep* r = old->ptrs[j].load(std::memory_order_relaxed);
+      if (not r)
+        continue;
+      std::size_t i = (r->hash >> shard_bits) & s->mask;
+      while (s->ptrs[i].load(std::memory_order_relaxed))
+        i = (i + 1) & s->mask;
+      s->ptrs[i].store(r, std::memory_order_relaxed);
+    }
+    slots.store(s, std::memory_order_release);
+  }
+
+// The shards of the string table.
+template<typename Rep>
+  struct String_table {
+    const Rep* get(const char* p, std::size_t n) {
+      std::size_t h = hash_bytes(p, n);
+      return shards[h & (shard_count - 1)].get(h, p, n);
+    }
+
+    String_shard<Rep> shards[shard_count];
+  };
 
 } // namesapce
 
-// Returns a pointer to a unique string with the same spelling as str.
-const std::string* 
-String::intern(const std::string& str) { return &*strings_.insert(str).first; }
+// Returns a pointer to a unique string with the same spelling as the
+// n characters at p. Strings may be interned by several threads at
+// once, and the same spelling yields the same string in each.
+const String::Rep*
+String::intern(const char* p, std::size_t n) {
+  static String_table<Rep> strings_;
+  return strings_.get(p, n);
+}
 
 // Convert a string to lowercase.
 String
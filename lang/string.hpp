@@ -11,17 +11,23 @@
 // that each unique occurrence of a string in the text of a program appears
 // only once in the memory of the program.
 //
+// Interned strings are kept in arenas, never freed. The length and hash
+// of each string are stored with its characters, which are followed by a
+// null character. Strings may be created by several threads at once.
+//
 // The String class is a regular, but reference semantic type.
 class String {
 public:
-  using iterator       = std::string::const_iterator;
-  using const_iterator = std::string::const_iterator;
+  using iterator       = const char*;
+  using const_iterator = const char*;
 
   // Constructors
   String();
   String(const std::string& s);
   String(const char* s);
   String(const char* s, std::size_t n);
+  String(const char* first, const char* last);
+  String(std::string::const_iterator first, std::string::const_iterator last);
 
   template<typename I> String(I first, I last);
 
@@ -30,8 +36,9 @@ public:
 
   // Observers
   std::size_t size() const;
-  const std::string* ptr() const;
-  const std::string& str() const;
+  std::size_t hash() const;
+  const void* ptr() const;
+  std::string str() const;
   const char* data() const;
 
   // Iterators
@@ -42,10 +49,18 @@ public:
   const_iterator end() const;
 
 private:
-  static const std::string* intern(const std::string&);
+  // The header of an interned string, which precedes its characters.
+  struct Rep {
+    std::size_t hash;
+    std::size_t size;
+
+    const char* data() const;
+  };
+
+  static const Rep* intern(const char*, std::size_t);
 
 private:
-  const std::string* str_;
+  const Rep* rep_;
 };
 
 // Equality comparison
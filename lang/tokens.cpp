@@ -11,10 +11,6 @@ namespace {
 // of values expected tokens.
 std::unordered_map<Token_kind, String> tokens_;
 
-// A mapping from keyword strings to tokens. This is used by the
-// lexer to find token kinds based on the spelling of strings
-std::unordered_map<String, Token_kind> keywords_;
-
 inline String
 get_name(Token_kind k) {
   char buf[4];
@@ -33,21 +29,16 @@ save_token(Token_kind k, const char* s) {
   tokens_.insert({k, s});
 }
 
-// Insert the token as a keyword.
-void
-save_keyword(Token_kind k, const char* s) { 
-  lang_assert(keywords_.count(s) == 0, 
-              format("keyword '{0}' already registered", s));
-  keywords_.insert({s, k}); 
-}
-
 } // namespace
 
+// Register the spelling of the token. A keyword must also be in the
+// language's keyword table (see keyword).
 void
 init_token(Token_kind k, const char* s) {
   save_token(k, s);
   if (token::is_keyword(k))
-    save_keyword(k, s);
+    lang_assert(keyword(s, std::strlen(s)) == k,
+                format("keyword '{0}' is not in the keyword table", s));
 }
 
 // Given a token kind, return the spelling associated with that 
@@ -68,16 +59,6 @@ token_name(Token_kind k) {
     return "<unknown token>";
 }
 
-// Returns the token kind associated with the given keyword spelling
-// or error_tok if no such keyword is availble.
-Token_kind
-keyword(String s) {
-  auto iter = keywords_.find(s);
-  if (iter != keywords_.end())
-    return iter->second;
-  return error_tok;
-}
-
 String
 as_string(const Token& k) {
   lang_assert(token::get_type(k.kind) == token_str_type,
@@ -6,6 +6,9 @@
 #include "integer.hpp"
 #include "location.hpp"
 
+#include <cstdint>
+#include <vector>
+
 
 // -------------------------------------------------------------------------- //
 // Token kind
@@ -142,6 +145,117 @@ constexpr Token_kind file_tok                = make_token(token_file_type, 6);
 constexpr Token_kind directory_tok           = make_token(token_directory_type, 7);
 constexpr Token_kind string_literal_tok      = make_token(token_str_type, 10);
 
+// -------------------------------------------------------------------------- //
+// Keywords
+//
+// Keywords are recognized by a perfect hash of their spellings, which
+// is computed at compile time. The hash of a spelling combines its
+// length and its first, second, and last characters with a seed. The
+// seed is the least for which no two keywords have the same hash, so
+// a spelling is a keyword only if it is the keyword in its slot.
+
+// A keyword is the spelling of a keyword token.
+struct Keyword {
+  constexpr Keyword()
+    : str(""), len(0), kind(error_tok) { }
+
+  template<std::size_t N>
+    constexpr Keyword(const char (&s)[N], Token_kind k)
+      : str(s), len(N - 1), kind(k) { }
+
+  const char* str;
+  std::size_t len;
+  Token_kind kind;
+};
+
+namespace token {
+
+// A keyword table has 2^keyword_bits slots.
+constexpr int keyword_bits = 8;
+constexpr std::size_t keyword_slots = std::size_t(1) << keyword_bits;
+
+// Seeds are tried up to this limit.
+constexpr std::uint32_t max_keyword_seed = 256;
+
+// Returns the slot of the spelling of n characters at p for the given
+// seed. Behavior is undefined when n is 0.
+constexpr std::size_t
+hash_keyword(std::uint32_t seed, const char* p, std::size_t n) {
+  return ((((((seed ^ std::uint8_t(p[0])) * 0x01000193u)
+               ^ std::uint8_t(p[n > 1 ? 1 : 0])) * 0x01000193u
+               ^ std::uint8_t(p[n - 1])) * 0x01000193u
+               ^ std::uint32_t(n)) * 0x9e3779b1u) >> (32 - keyword_bits);
+}
+
+// Returns the slot of the keyword k for the given seed.
+constexpr std::size_t
+hash_keyword(std::uint32_t seed, const Keyword& k) {
+  return hash_keyword(seed, k.str, k.len);
+}
+
+// Returns true if none of the n keywords at k is in the slot h.
+constexpr bool
+is_free_slot(const Keyword* k, std::size_t n, std::uint32_t seed, std::size_t h) {
+  return n == 0 or (hash_keyword(seed, *k) != h and is_free_slot(k + 1, n - 1, seed, h));
+}
+
+// Returns true if the n keywords at k are in distinct slots.
+constexpr bool
+is_perfect_hash(const Keyword* k, std::size_t n, std::uint32_t seed) {
+  return n == 0 or (is_free_slot(k + 1, n - 1, seed, hash_keyword(seed, *k))
+                    and is_perfect_hash(k + 1, n - 1, seed));
+}
+
+// Returns the least seed, starting from the given one, for which the
+// n keywords at k are in distinct slots, or max_keyword_seed if there
+// is none.
+constexpr std::uint32_t
+find_keyword_seed(const Keyword* k, std::size_t n, std::uint32_t seed = 0) {
+  return seed == max_keyword_seed or is_perfect_hash(k, n, seed)
+    ? seed
+    : find_keyword_seed(k, n, seed + 1);
+}
+
+// Returns the keyword among the n keywords at k in the slot i, or an
+// empty keyword if there is none.
+constexpr Keyword
+get_keyword_slot(const Keyword* k, std::size_t n, std::uint32_t seed, std::size_t i) {
+  return n == 0 ? Keyword()
+       : hash_keyword(seed, *k) == i ? *k
+       : get_keyword_slot(k + 1, n - 1, seed, i);
+}
+
+// A list of indexes 0, 1, ..., N - 1, used to initialize the slots of
+// a keyword table.
+template<std::size_t... I>
+  struct Index_list { };
+
+template<std::size_t N, std::size_t... I>
+  struct Make_index_list : Make_index_list<N - 1, N - 1, I...> { };
+
+template<std::size_t... I>
+  struct Make_index_list<0, I...> { using type = Index_list<I...>; };
+
+} // namespace token
+
+// A keyword table for the N keywords at K. The slots of the table are
+// computed at compile time.
+template<const Keyword* K, std::size_t N,
+         typename = typename token::Make_index_list<token::keyword_slots>::type>
+  struct Keyword_table;
+
+template<const Keyword* K, std::size_t N, std::size_t... I>
+  struct Keyword_table<K, N, token::Index_list<I...>> {
+    static constexpr std::uint32_t seed = token::find_keyword_seed(K, N);
+    static_assert(seed != token::max_keyword_seed,
+                  "no perfect hash for the keywords");
+
+    static constexpr Keyword slots[] = { token::get_keyword_slot(K, N, seed, I)... };
+
+    static Token_kind find(const char*, std::size_t);
+  };
+
+
 // -------------------------------------------------------------------------- //
 // Token structure
 
@@ -180,7 +294,11 @@ template<typename C, typename T>
 
 void init_token(Token_kind, const char*);
 String token_name(Token_kind);
-Token_kind keyword(String);
+
+// Returns the keyword token spelled by n characters, or error_tok if
+// they do not spell a keyword. This is defined by the language, whose
+// keywords are known at compile time.
+Token_kind keyword(const char*, std::size_t);
 
 // -------------------------------------------------------------------------- //
 // Token elaboration
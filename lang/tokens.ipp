@@ -8,6 +8,27 @@ Token::Token(Location l, Token_kind k, String t)
   : loc(l), kind(k), text(t) { }
 
 
+// -------------------------------------------------------------------------- //
+// Keywords
+
+template<const Keyword* K, std::size_t N, std::size_t... I>
+  constexpr std::uint32_t Keyword_table<K, N, token::Index_list<I...>>::seed;
+
+template<const Keyword* K, std::size_t N, std::size_t... I>
+  constexpr Keyword Keyword_table<K, N, token::Index_list<I...>>::slots[];
+
+// Returns the kind of the keyword spelled by the n characters at p, or
+// error_tok if there is none. Behavior is undefined when n is 0.
+template<const Keyword* K, std::size_t N, std::size_t... I>
+  inline Token_kind
+  Keyword_table<K, N, token::Index_list<I...>>::find(const char* p, std::size_t n) {
+    const Keyword& k = slots[token::hash_keyword(seed, p, n)];
+    if (k.len == n and std::memcmp(k.str, p, n) == 0)
+      return k.kind;
+    return error_tok;
+  }
+
+
 // -------------------------------------------------------------------------- //
 // Operations
 
@@ -8,15 +8,21 @@
 
 namespace {
 
+// Returns true when the previous token is 'import'. Only the name of
+// an imported module is lexed as a module, so that a name followed by
+// a dot elsewhere, as in 'x.a', is a projection.
+inline bool
+follows_import(const Lexer& lex) {
+  return not lex.toks.empty() and lex.toks.back().kind == import_tok;
+}
+
 void 
 lex_tokens(Lexer& lex) {
   switch (*lex.first) {
-  // Horizontal whitespace
+  // Whitespace
   case ' ':
-  case '\t': lex::space(lex); break;
-
-  // Vertical whitespace
-  case '\n': lex::newline(lex); break;
+  case '\t':
+  case '\n': lex::space(lex); break;
 
   case '/':
     if (lex::next_char_is(lex, '/'))
@@ -61,7 +67,7 @@ lex_tokens(Lexer& lex) {
   default:
     // Maybe this is an identifier, keyowrd, or number.
     // Maybe a module - module extension
-   if (lex::is_module(lex))
+   if (follows_import(lex) and lex::is_module(lex))
       lex::module(lex);
     else if (lex::is_id_head(*lex.first))
       lex::id(lex);
@@ -0,0 +1,634 @@
+
+#include "load.hpp"
+#include "type.hpp"
+
+#include "lang/debug.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// -------------------------------------------------------------------------- //
+// Mapped files
+
+// Map the file named by path into memory. An empty file has no data.
+Mapped_file::Mapped_file(const std::string& path)
+  : data(nullptr), size(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw Load_error(format("cannot open '{}': {}", path, std::strerror(errno)));
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    throw Load_error(format("cannot read '{}': {}", path, std::strerror(errno)));
+  }
+  size = st.st_size;
+  if (size) {
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      throw Load_error(format("cannot map '{}': {}", path, std::strerror(errno)));
+    }
+    ::madvise(p, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+  }
+  ::close(fd);
+}
+
+Mapped_file::~Mapped_file() {
+  if (data)
+    ::munmap(const_cast<char*>(data), size);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Delimited text
+
+namespace {
+
+// A field of a row of a delimited file. The text of a quoted field
+// excludes its enclosing quotes, but not the doubled quotes within it.
+struct Field {
+  const char* first;
+  const char* last;
+  bool quoted;
+};
+
+using Field_seq = std::vector<Field>;
+
+// Reads the rows of a delimited file, one at a time. Fields are
+// separated by the delimiter and rows by newlines. When the delimiter
+// is a comma, a field may be enclosed in double quotes, in which case
+// it may contain delimiters, newlines, and doubled quotes.
+struct Csv_reader {
+  Csv_reader(const std::string& path, const Mapped_file& f, char d)
+    : path(path), first(f.begin()), last(f.end()), delim(d), line(0) { }
+
+  bool read_row(Field_seq&);
+  const char* read_quoted(Field&);
+
+  [[noreturn]] void fail(const std::string&);
+
+  const std::string& path;
+  const char* first;
+  const char* last;
+  char delim;
+  std::size_t line;
+};
+
+// Throw an error about the current line of the file.
+void
+Csv_reader::fail(const std::string& msg) {
+  throw Load_error(format("{}:{}: {}", path, line, msg));
+}
+
+// Read the rest of a quoted field, starting after its opening quote.
+// Returns the position after the closing quote.
+const char*
+Csv_reader::read_quoted(Field& f) {
+  const char* p = first;
+  while (true) {
+    p = static_cast<const char*>(std::memchr(p, '"', last - p));
+    if (not p)
+      fail("unterminated quoted field");
+    if (p + 1 != last and p[1] == '"') {
+      p += 2;
+      continue;
+    }
+    f = {first, p, true};
+    return p + 1;
+  }
+}
+
+// Read the fields of the next row into fs. Returns false at the end
+// of the file. A delimiter at the end of the file ends an empty field.
+bool
+Csv_reader::read_row(Field_seq& fs) {
+  fs.clear();
+  if (first == last)
+    return false;
+  ++line;
+  while (true) {
+    Field f;
+    const char* p;
+    if (delim == ',' and first != last and *first == '"') {
+      ++first;
+      p = read_quoted(f);
+    } else {
+      p = first;
+      while (p != last and *p != delim and *p != '\n')
+        ++p;
+      f = {first, p, false};
+      if (p != first and p[-1] == '\r' and (p == last or *p == '\n'))
+        --f.last;
+    }
+    fs.push_back(f);
+
+    if (p == last) {
+      first = p;
+      return true;
+    }
+    if (*p == delim) {
+      first = p + 1;
+      continue;
+    }
+    if (*p == '\r' and p + 1 != last and p[1] == '\n')
+      ++p;
+    if (*p != '\n')
+      fail("expected a delimiter after a quoted field");
+    first = p + 1;
+    return true;
+  }
+}
+
+// Returns the text of the field f, with doubled quotes replaced.
+std::string
+get_text(const Field& f) {
+  std::string s(f.first, f.last);
+  if (f.quoted) {
+    std::size_t i = 0;
+    while ((i = s.find("\"\"", i)) != std::string::npos)
+      s.erase(i++, 1);
+  }
+  return s;
+}
+
+// Returns the name in the header field f.
+inline String
+get_name(const Field& f) {
+  if (f.quoted and std::memchr(f.first, '"', f.last - f.first))
+    return String(get_text(f));
+  return String(f.first, f.last - f.first);
+}
+
+// Returns the string value of the field f. String values are stored
+// as they are written in programs: enclosed in quotes, with quotes
+// and backslashes escaped.
+String
+get_string(const Field& f) {
+  std::string s;
+  s.reserve(f.last - f.first + 2);
+  s += '"';
+  for (const char* p = f.first; p != f.last; ++p) {
+    if (*p == '"' or *p == '\\')
+      s += '\\';
+    s += *p;
+    if (*p == '"' and f.quoted)
+      ++p;
+  }
+  s += '"';
+  return String(s);
+}
+
+// Append the value of the field f to the column c, which stores values
+// of the member v.
+void
+append_field(Csv_reader& r, Column& c, Var* v, const Field& f) {
+  switch (c.kind) {
+  case bool_column: {
+    std::size_t n = f.last - f.first;
+    if (n == 4 and std::memcmp(f.first, "true", 4) == 0)
+      c.bools.push_back(true);
+    else if (n == 5 and std::memcmp(f.first, "false", 5) == 0)
+      c.bools.push_back(false);
+    else
+      r.fail(format("'{}' is not a value of {}", get_text(f), pretty(v)));
+    return;
+  }
+
+  case nat_column:
+  case int_column: {
+    if (f.first == f.last)
+      r.fail(format("missing value of {}", pretty(v)));
+    std::int64_t n = 0;
+    bool fits = true;
+    for (const char* p = f.first; p != f.last; ++p) {
+      if (*p < '0' or *p > '9')
+        r.fail(format("'{}' is not a value of {}", get_text(f), pretty(v)));
+      fits = fits and not __builtin_mul_overflow(n, 10, &n)
+                  and not __builtin_add_overflow(n, *p - '0', &n);
+    }
+    if (fits and c.kind == nat_column) {
+      c.nats.push_back(n);
+      return;
+    }
+    if (c.kind == nat_column)
+      c.promote();
+    c.ints.push_back(fits ? Integer(n) : Integer(String(get_text(f))));
+    return;
+  }
+
+  case str_column:
+    c.strs.push_back(get_string(f));
+    return;
+
+  case term_column:
+    break;
+  }
+  lang_unreachable(format("cannot load values of {}", pretty(v)));
+}
+
+// Returns the name of the member v.
+inline String
+get_name(Var* v) {
+  return as<Id>(v->name())->t1;
+}
+
+} // namespace
+
+// Returns the text of the string value s, without its enclosing quotes
+// and with its escapes replaced.
+std::string
+unquote(String s) {
+  std::string r;
+  r.reserve(s.size());
+  for (std::size_t i = 1; i + 1 < s.size(); ++i) {
+    if (s.data()[i] == '\\')
+      ++i;
+    r += s.data()[i];
+  }
+  return r;
+}
+
+// Load the table of type t from the delimited file named by path. The
+// fields of a file ending in '.tsv' are separated by tabs; otherwise,
+// they are separated by commas. The first row of the file names its
+// columns. Each member of the row type of t is loaded from the column
+// having its name; other columns are ignored.
+Table*
+load_csv(const std::string& path, Type* t) {
+  Mapped_file file(path);
+  bool tsv = path.size() >= 4 and path.compare(path.size() - 4, 4, ".tsv") == 0;
+  Csv_reader r(path, file, tsv ? '\t' : ',');
+
+  Field_seq fs;
+  if (not r.read_row(fs))
+    r.fail("missing header");
+
+  // Find the field of each member.
+  Table* table = make_table(t);
+  Term_seq* vars = table->schema()->members();
+  std::vector<std::size_t> fields(vars->size());
+  for (std::size_t j = 0; j < vars->size(); ++j) {
+    String n = get_name(as<Var>((*vars)[j]));
+    std::size_t k = 0;
+    while (k < fs.size() and get_name(fs[k]) != n)
+      ++k;
+    if (k == fs.size())
+      r.fail(format("missing column '{}'", n));
+    fields[j] = k;
+  }
+
+  std::size_t width = fs.size();
+  while (r.read_row(fs)) {
+    // Skip blank lines.
+    if (fs.size() == 1 and fs[0].first == fs[0].last and not fs[0].quoted)
+      continue;
+    if (fs.size() != width)
+      r.fail(format("expected {} fields but found {}", width, fs.size()));
+    for (std::size_t j = 0; j < fields.size(); ++j)
+      append_field(r, table->t1[j], as<Var>((*vars)[j]), fs[fields[j]]);
+  }
+  return table;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Binary tables
+//
+// A binary table file stores the columns of a table one after the
+// other, so that each can be read with a single copy. The file has
+// the following layout, where each number is a 64-bit word in the
+// byte order of the machine, and each section is padded to a multiple
+// of 8 bytes:
+//
+//    header:  magic, rows, columns
+//    schema:  for each column, its kind, name length, and name
+//    data:    for each column, its values
+//
+// Bool values are packed into words, 64 per word. Nat values that fit
+// in 64 bits are stored as words. Str values and larger Nat values are
+// stored as rows + 1 offsets into the text that follows them; the
+// text of a Nat value is its decimal spelling.
+
+namespace {
+
+// The first word of a binary table file, "WTBL" followed by the
+// version of the format.
+constexpr std::uint64_t table_magic = 0x000000014c425457ull;
+
+// Returns n rounded up to a multiple of 8.
+inline std::size_t
+align_word(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+// Writes words and text to a binary table file.
+struct Table_writer {
+  Table_writer(const std::string& path)
+    : path(path), os(path, std::ios::binary) {
+    if (not os)
+      throw Load_error(format("cannot create '{}': {}", path, std::strerror(errno)));
+  }
+
+  void write_word(std::uint64_t n) {
+    os.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  }
+
+  void write_words(const std::uint64_t* p, std::size_t n) {
+    os.write(reinterpret_cast<const char*>(p), n * sizeof(*p));
+  }
+
+  void write_text(const char* p, std::size_t n) {
+    static const char zeros[8] = { };
+    os.write(p, n);
+    os.write(zeros, align_word(n) - n);
+  }
+
+  void write_strings(const std::vector<std::string>&);
+
+  const std::string& path;
+  std::ofstream os;
+};
+
+// Write the offsets of the strings ss followed by their text.
+void
+Table_writer::write_strings(const std::vector<std::string>& ss) {
+  std::vector<std::uint64_t> offs;
+  offs.reserve(ss.size() + 1);
+  std::uint64_t n = 0;
+  offs.push_back(n);
+  for (const std::string& s : ss)
+    offs.push_back(n += s.size());
+  write_words(offs.data(), offs.size());
+  std::string text;
+  text.reserve(n);
+  for (const std::string& s : ss)
+    text += s;
+  write_text(text.data(), text.size());
+}
+
+// Write the values of the column c.
+void
+write_column(Table_writer& w, const Column& c) {
+  switch (c.kind) {
+  case bool_column: {
+    std::vector<std::uint64_t> words((c.size() + 63) / 64);
+    for (std::size_t i = 0; i < c.size(); ++i)
+      if (c.bools[i])
+        words[i / 64] |= std::uint64_t(1) << (i % 64);
+    w.write_words(words.data(), words.size());
+    return;
+  }
+
+  case nat_column:
+    w.write_words(reinterpret_cast<const std::uint64_t*>(c.nats.data()), c.size());
+    return;
+
+  case int_column: {
+    std::vector<std::string> ss;
+    ss.reserve(c.size());
+    for (const Integer& n : c.ints) {
+      std::stringstream os;
+      os << n;
+      ss.push_back(os.str());
+    }
+    w.write_strings(ss);
+    return;
+  }
+
+  case str_column: {
+    std::vector<std::string> ss;
+    ss.reserve(c.size());
+    for (String s : c.strs)
+      ss.emplace_back(s.data(), s.size());
+    w.write_strings(ss);
+    return;
+  }
+
+  case term_column:
+    break;
+  }
+  lang_unreachable("cannot save values of a term column");
+}
+
+// Reads words and text from a mapped binary table file. Each read
+// is checked against the size of the file.
+struct Table_reader {
+  Table_reader(const std::string& path, const Mapped_file& f)
+    : path(path), first(f.begin()), last(f.end()) { }
+
+  const std::uint64_t* read_words(std::size_t n) {
+    if (n > std::size_t(last - first) / sizeof(std::uint64_t))
+      fail("unexpected end of file");
+    return reinterpret_cast<const std::uint64_t*>(read_bytes(n * sizeof(std::uint64_t)));
+  }
+
+  std::uint64_t read_word() { return *read_words(1); }
+
+  const char* read_text(std::size_t n) {
+    if (n > std::size_t(last - first))
+      fail("unexpected end of file");
+    return read_bytes(align_word(n));
+  }
+
+  const char* read_bytes(std::size_t);
+  const std::uint64_t* read_strings(std::size_t, const char*&);
+
+  [[noreturn]] void fail(const std::string&);
+
+  const std::string& path;
+  const char* first;
+  const char* last;
+};
+
+// Throw an error about the file being read.
+void
+Table_reader::fail(const std::string& msg) {
+  throw Load_error(format("{}: {}", path, msg));
+}
+
+// Returns the next n bytes of the file.
+const char*
+Table_reader::read_bytes(std::size_t n) {
+  if (std::size_t(last - first) < n)
+    fail("unexpected end of file");
+  const char* p = first;
+  first += n;
+  return p;
+}
+
+// Read the offsets of n strings and the text that follows them.
+// Returns the offsets and sets text to the start of the text.
+const std::uint64_t*
+Table_reader::read_strings(std::size_t n, const char*& text) {
+  const std::uint64_t* offs = read_words(n + 1);
+  for (std::size_t i = 0; i < n; ++i)
+    if (offs[i] > offs[i + 1])
+      fail("invalid string offsets");
+  text = read_text(offs[n]);
+  return offs;
+}
+
+// Read n values into the column c, which stores values of the member
+// v. The values are stored in the file with the given kind, which must
+// agree with the type of the column.
+void
+read_column(Table_reader& r, Column& c, Var* v, Column_kind k, std::size_t n) {
+  switch (k) {
+  case bool_column: {
+    if (c.kind != bool_column)
+      break;
+    const std::uint64_t* words = r.read_words((n + 63) / 64);
+    c.bools.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+      c.bools[i] = (words[i / 64] >> (i % 64)) & 1;
+    return;
+  }
+
+  case nat_column: {
+    if (c.kind != nat_column)
+      break;
+    const std::uint64_t* words = r.read_words(n);
+    const std::int64_t* p = reinterpret_cast<const std::int64_t*>(words);
+    c.nats.assign(p, p + n);
+    return;
+  }
+
+  case int_column: {
+    if (c.kind != nat_column)
+      break;
+    const char* text;
+    const std::uint64_t* offs = r.read_strings(n, text);
+    c.promote();
+    c.ints.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      const char* first = text + offs[i];
+      const char* last = text + offs[i + 1];
+      if (first == last)
+        r.fail("invalid Nat value");
+      for (const char* p = first; p != last; ++p)
+        if (*p < '0' or *p > '9')
+          r.fail("invalid Nat value");
+      c.ints.push_back(Integer(String(first, last - first)));
+    }
+    return;
+  }
+
+  case str_column: {
+    if (c.kind != str_column)
+      break;
+    const char* text;
+    const std::uint64_t* offs = r.read_strings(n, text);
+    c.strs.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      c.strs.push_back(String(text + offs[i], offs[i + 1] - offs[i]));
+    return;
+  }
+
+  case term_column:
+    break;
+  }
+  r.fail(format("column '{}' does not hold values of {}", get_name(v), pretty(v)));
+}
+
+// Skip the n values of a column of kind k.
+void
+skip_column(Table_reader& r, Column_kind k, std::size_t n) {
+  const char* text;
+  switch (k) {
+  case bool_column: r.read_words((n + 63) / 64); return;
+  case nat_column: r.read_words(n); return;
+  case int_column: r.read_strings(n, text); return;
+  case str_column: r.read_strings(n, text); return;
+  case term_column: break;
+  }
+  lang_unreachable("invalid column kind");
+}
+
+} // namespace
+
+// Returns true when the file named by path is a binary table file,
+// which is to say that its name ends in '.wtbl'.
+bool
+is_table_file(const std::string& path) {
+  return path.size() >= 5 and path.compare(path.size() - 5, 5, ".wtbl") == 0;
+}
+
+// Save the table t to a binary table file named by path. The table
+// must not have term columns.
+void
+save_table(const std::string& path, Table* t) {
+  Table_writer w(path);
+  w.write_word(table_magic);
+  w.write_word(t->size());
+  w.write_word(t->t1.size());
+
+  Term_seq* vars = t->schema()->members();
+  for (std::size_t j = 0; j < vars->size(); ++j) {
+    String n = get_name(as<Var>((*vars)[j]));
+    w.write_word(t->t1[j].kind);
+    w.write_word(n.size());
+    w.write_text(n.data(), n.size());
+  }
+  for (const Column& c : t->t1)
+    write_column(w, c);
+
+  w.os.close();
+  if (not w.os)
+    throw Load_error(format("cannot write '{}'", path));
+}
+
+// Load the table of type t from the binary table file named by path.
+// Each member of the row type of t is loaded from the column having
+// its name; other columns are skipped.
+Table*
+load_table(const std::string& path, Type* t) {
+  Mapped_file file(path);
+  Table_reader r(path, file);
+  if (r.read_word() != table_magic)
+    r.fail("not a table file");
+  std::size_t rows = r.read_word();
+  std::size_t cols = r.read_word();
+
+  // Read the schema of the file.
+  std::vector<Column_kind> kinds;
+  std::vector<String> names;
+  for (std::size_t k = 0; k < cols; ++k) {
+    std::uint64_t kind = r.read_word();
+    if (kind > str_column)
+      r.fail("invalid column kind");
+    std::size_t n = r.read_word();
+    kinds.push_back(Column_kind(kind));
+    names.push_back(String(r.read_text(n), n));
+  }
+
+  // Find the column of each member.
+  Table* table = make_table(t);
+  Term_seq* vars = table->schema()->members();
+  std::vector<int> members(cols, -1);
+  for (std::size_t j = 0; j < vars->size(); ++j) {
+    String n = get_name(as<Var>((*vars)[j]));
+    std::size_t k = 0;
+    while (k < cols and names[k] != n)
+      ++k;
+    if (k == cols)
+      r.fail(format("missing column '{}'", n));
+    members[k] = j;
+  }
+
+  // Read each column, or skip it when it is not needed.
+  for (std::size_t k = 0; k < cols; ++k) {
+    int j = members[k];
+    if (j < 0)
+      skip_column(r, kinds[k], rows);
+    else
+      read_column(r, table->t1[j], as<Var>((*vars)[j]), kinds[k], rows);
+  }
+  return table;
+}
@@ -0,0 +1,55 @@
+
+#ifndef LOAD_HPP
+#define LOAD_HPP
+
+#include "table.hpp"
+
+#include <stdexcept>
+#include <string>
+
+// This module defines the loading and saving of tables. Files are
+// mapped into memory and parsed directly into the columns of a table,
+// without passing through the lexer, parser, or elaborator.
+
+// Thrown when a file cannot be read or written, or does not match the
+// type of the table being loaded.
+struct Load_error : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Mapped files
+
+// A read-only view of the contents of a file. The file is mapped into
+// memory for the lifetime of the object.
+struct Mapped_file {
+  Mapped_file(const std::string&);
+  ~Mapped_file();
+
+  Mapped_file(const Mapped_file&) = delete;
+  Mapped_file& operator=(const Mapped_file&) = delete;
+
+  const char* begin() const { return data; }
+  const char* end() const { return data + size; }
+
+  const char* data;
+  std::size_t size;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Delimited text
+
+std::string unquote(String);
+Table* load_csv(const std::string&, Type*);
+
+
+// -------------------------------------------------------------------------- //
+// Binary tables
+
+bool is_table_file(const std::string&);
+void save_table(const std::string&, Table*);
+Table* load_table(const std::string&, Type*);
+
+#endif
@@ -8,12 +8,15 @@
 #include "elab.hpp"
 #include "ast.hpp"
 #include "eval.hpp"
+#include "vm.hpp"
+#include "load.hpp"
+
+#include <cstdlib>
 
 //remove after testing
 #include "type.hpp"
 
 int main() {
-  bool showDebug = true;
   Language lang;
 
   // ------------------------------------------------------------------------ //
@@ -36,7 +39,9 @@ int main() {
   // --------------------------------------------------------------//
   // Added for debugging lexed tokens
   //
-  if(showDebug){
+  // The tokens are printed when the environment variable WAFFLE_DEBUG
+  // is set.
+  if (std::getenv("WAFFLE_DEBUG")) {
     std::cout << "== debug ==\n";
     for(int i=0; i<toks.size(); i++)
     {
@@ -47,9 +52,15 @@ int main() {
   // ------------------------------------------------------------------------ //
   // Syntactic analysis
   //
-  // Parse the result.
+  // Parse the result. The parse tree is allocated in its own arena,
+  // which is released once the tree has been elaborated.
+  Arena trees;
   Parser parse;
-  Tree* tree = parse(toks);
+  Tree* tree = nullptr;
+  {
+    Arena_scope scope(&trees);
+    tree = parse(toks);
+  }
   if (not parse.diags.empty()) {
     std::cerr << parse.diags;
     return -1;
@@ -60,9 +71,16 @@ int main() {
   // Elaboration
   //
   // Elaborate the parse tree, producing a fully typed abstract
-  // syntax tree.
+  // syntax tree. The abstract syntax tree is allocated in an arena
+  // that lives for the rest of the program.
+  Arena terms;
   Elaborator elab;
-  Expr* prog = elab(tree);
+  Expr* prog = nullptr;
+  {
+    Arena_scope scope(&terms);
+    prog = elab(tree);
+  }
+  trees.reset();
   if (not elab.diags.empty()) {
     std::cerr << elab.diags;
     return -1;
@@ -73,12 +91,20 @@ int main() {
   // Evaluation
   //
   // Evaluate the syntax tree, producing a partially evalutaed
-  // abstract syntax tree.
+  // abstract syntax tree. When the environment variable WAFFLE_VM
+  // is set, the program is compiled and run by the virtual machine.
   if (Term* term = as<Term>(prog)) {
     Evaluator eval;
+    Machine vm;
+    bool use_vm = std::getenv("WAFFLE_VM");
     std::cout << "== output ==\n";
-    Expr* result = eval(term);
-    std::cout << "== result ==\n" << pretty(result) << '\n';
+    try {
+      Expr* result = use_vm ? vm(term) : eval(term);
+      std::cout << "== result ==\n" << pretty(result) << '\n';
+    } catch (Load_error& err) {
+      std::cerr << "error: " << err.what() << '\n';
+      return -1;
+    }
   } else {
     std::cout << "== no evaluation ==\n";
   }
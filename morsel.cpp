@@ -0,0 +1,176 @@
+
+#include "morsel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// True in a thread that is processing morsels. Work started from
+// within a morsel is done by that thread alone.
+thread_local bool in_morsel = false;
+
+// Sets in_morsel for the lifetime of the guard.
+struct Morsel_guard {
+  Morsel_guard()
+    : prev(in_morsel) { in_morsel = true; }
+  ~Morsel_guard() { in_morsel = prev; }
+
+  bool prev;
+};
+
+// A pool of threads that process the morsels of one job at a time.
+// The thread that starts a job also processes its morsels, and waits
+// until the others have finished.
+//
+// When processing a morsel throws, no further morsels are started.
+// The first exception is kept and rethrown by the starting thread once
+// every thread has finished with the job.
+//
+// The pool is never destroyed; its threads wait for work until the
+// program exits.
+struct Thread_pool {
+  Thread_pool(std::size_t);
+
+  void run(std::size_t, std::size_t, const Morsel_fn&);
+  void work();
+  void process();
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  std::size_t generation;
+  std::size_t active;
+
+  // The current job.
+  const Morsel_fn* fn;
+  std::size_t rows;
+  std::size_t size;
+  std::atomic<std::size_t> next;
+  std::exception_ptr error;
+};
+
+Thread_pool::Thread_pool(std::size_t n)
+  : generation(0), active(0), fn(nullptr), rows(0), size(0), next(0)
+{
+  for (std::size_t i = 0; i < n; ++i)
+    std::thread(&Thread_pool::work, this).detach();
+}
+
+// Process morsels of the current job until none remain.
+void
+Thread_pool::process() {
+  Morsel_guard guard;
+  std::size_t count = (rows + size - 1) / size;
+  while (true) {
+    std::size_t i = next.fetch_add(1);
+    if (i >= count)
+      break;
+    std::size_t first = i * size;
+    try {
+      (*fn)(first, std::min(first + size, rows));
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (not error)
+        error = std::current_exception();
+      next = count;
+    }
+  }
+}
+
+// The main loop of each thread of the pool.
+void
+Thread_pool::work() {
+  std::size_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start.wait(lock, [&] { return generation != seen; });
+      seen = generation;
+    }
+    process();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--active == 0)
+      done.notify_one();
+  }
+}
+
+// Process the n rows in morsels of the given size, returning when
+// each morsel has been processed. If processing a morsel threw, the
+// exception is rethrown once every thread has finished.
+void
+Thread_pool::run(std::size_t n, std::size_t s, const Morsel_fn& f) {
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&] { return active == 0; });
+  fn = &f;
+  rows = n;
+  size = s;
+  next = 0;
+  active = get_thread_count() - 1;
+  ++generation;
+  start.notify_all();
+  lock.unlock();
+
+  process();
+
+  lock.lock();
+  done.wait(lock, [&] { return active == 0; });
+  std::exception_ptr e = error;
+  error = nullptr;
+  lock.unlock();
+  if (e)
+    std::rethrow_exception(e);
+}
+
+// Returns the pool, creating it on first use.
+Thread_pool&
+get_pool() {
+  static Thread_pool* pool = new Thread_pool(get_thread_count() - 1);
+  return *pool;
+}
+
+} // namespace
+
+// Returns the number of threads that process morsels, including the
+// thread that starts the work.
+std::size_t
+get_thread_count() {
+  static std::size_t n = [] {
+    if (const char* s = std::getenv("WAFFLE_THREADS"))
+      return std::max(std::atoi(s), 1);
+    return std::max<int>(std::thread::hardware_concurrency(), 1);
+  }();
+  return n;
+}
+
+// Returns the number of rows in a morsel. This is a multiple of 64 so
+// that morsels never share a word of a selection.
+std::size_t
+get_morsel_size() {
+  static std::size_t n = [] {
+    std::size_t n = 16384;
+    if (const char* s = std::getenv("WAFFLE_MORSEL_SIZE"))
+      n = std::max(std::atoi(s), 1);
+    return (n + 63) / 64 * 64;
+  }();
+  return n;
+}
+
+// Call f for each morsel of n rows, where each morsel has the given
+// number of rows except possibly the last. The calls are made in
+// parallel when there are several morsels and more than one thread.
+void
+for_each_morsel(std::size_t n, std::size_t size, const Morsel_fn& f) {
+  if (n <= size or get_thread_count() == 1 or in_morsel) {
+    for (std::size_t first = 0; first < n; first += size)
+      f(first, std::min(first + size, n));
+    return;
+  }
+  get_pool().run(n, size, f);
+}
@@ -0,0 +1,26 @@
+
+#ifndef MORSEL_HPP
+#define MORSEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+// This module defines the parallel execution of work over the rows of
+// a table. The rows are split into morsels, contiguous ranges of rows
+// that are processed independently by the threads of a shared pool.
+// Each morsel writes only to its own part of the result, so the
+// result does not depend on the order in which morsels are processed.
+//
+// The number of threads is the number of processors, unless the
+// environment variable WAFFLE_THREADS is set. Morsels have 16384 rows,
+// unless the environment variable WAFFLE_MORSEL_SIZE is set.
+
+// A function processing the rows from first up to, but not including,
+// last.
+using Morsel_fn = std::function<void(std::size_t, std::size_t)>;
+
+std::size_t get_thread_count();
+std::size_t get_morsel_size();
+void for_each_morsel(std::size_t, std::size_t, const Morsel_fn&);
+
+#endif
@@ -32,7 +32,7 @@ Tree* parse_expr(Parser&);
 Tree*
 parse_name(Parser& p) {
   if (const Token* k = parse::accept(p, identifier_tok))
-    return new Id_tree(k);
+    return make<Id_tree>(k);
   return nullptr;
 }
 
@@ -42,7 +42,7 @@ parse_name(Parser& p) {
 Tree*
 parse_unit_lit(Parser& p) {
   if (const Token* k = parse::accept(p, unit_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   return nullptr;
 }
 
@@ -52,9 +52,9 @@ parse_unit_lit(Parser& p) {
 Tree*
 parse_boolean_lit(Parser& p) {
   if (const Token* k = parse::accept(p, true_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   if (const Token* k = parse::accept(p, false_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   return nullptr;
 }
 
@@ -66,7 +66,7 @@ parse_boolean_lit(Parser& p) {
 Tree*
 parse_integer_lit(Parser& p) {
   if (const Token* k = parse::accept(p, decimal_literal_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   return nullptr;
 }
 
@@ -76,21 +76,23 @@ parse_integer_lit(Parser& p) {
 Tree*
 parse_string_lit(Parser& p) {
   if (const Token* k = parse::accept(p, string_literal_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   return nullptr;
 }
 
 // Parse a type literal.
 //
-//    type-literal ::= 'Unit' | 'Bool' | 'Nat'
+//    type-literal ::= 'Unit' | 'Bool' | 'Nat' | 'Str'
 Tree*
 parse_type_lit(Parser& p) {
   if (const Token* k = parse::accept(p, unit_type_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   if (const Token* k = parse::accept(p, bool_type_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
   if (const Token* k = parse::accept(p, nat_type_tok))
-    return new Lit_tree(k);
+    return make<Lit_tree>(k);
+  if (const Token* k = parse::accept(p, str_type_tok))
+    return make<Lit_tree>(k);
   return nullptr;
 }
 
@@ -130,7 +132,7 @@ parse_init_expr(Parser& p) {
   if (Tree* n = parse_name(p))
     if (parse::expect(p, equal_tok)) {
       if (Tree* t = parse_expr(p))
-        return new Init_tree(n, t);
+        return make<Init_tree>(n, t);
       else
         parse::parse_error(p) << "expected 'expr' after '='";
     }
@@ -145,7 +147,7 @@ parse_parm_decl(Parser& p) {
   if (Tree* n = parse_name(p))
     if (parse::expect(p, colon_tok)) {
       if (Tree* t = parse_expr(p))
-        return new Var_tree(n, t);
+        return make<Var_tree>(n, t);
       else
         parse::parse_error(p) << "expected 'expr' after ':'";
     }
@@ -157,7 +159,7 @@ parse_parm_decl(Parser& p) {
 //    parm-list ::= parm | parm-list ',' parm
 Tree_seq* 
 parse_parm_list (Parser& p) {
-  Tree_seq* ts = new Tree_seq();
+  Tree_seq* ts = make<Tree_seq>();
   while (1) {
     // Parse the next paramter.
     if (Tree* t = parse_parm_decl(p)) {
@@ -201,14 +203,14 @@ parse_lambda_expr(Parser& p) {
     if(Tree* v = parse_parm_decl(p)) {
       if (parse::expect(p, map_tok)) {
         if (Tree* t = parse_expr(p))
-          return new Abs_tree(k, v, t);
+          return make<Abs_tree>(k, v, t);
         else
           parse::parse_error(p) << "expected 'expr' after '.'";
       }
     } else if (Tree_seq* ps = parse_parm_clause(p)) {
       if (parse::expect(p, map_tok)) {
         if (Tree* t = parse_expr(p))
-          return new Fn_tree(k, ps, t);
+          return make<Fn_tree>(k, ps, t);
         else
           parse::parse_error(p) << "expected 'expr' after '.'";
       }
@@ -241,7 +243,7 @@ parse_elem(Parser& p) {
 //    elem-list ::= elem | elem-list ',' elem
 Tree_seq*
 parse_elem_list(Parser& p, Token_kind close_tok) {
-  Tree_seq* ts = new Tree_seq();
+  Tree_seq* ts = make<Tree_seq>();
   while (true) {
     // Try parsing the next element.
     if (Tree* t = parse_elem(p))
@@ -273,11 +275,11 @@ template<typename T>
     if (const Token* k = parse::accept(p, open_tok)) {
 
       if (parse::accept (p, close_tok))
-        return new T(k, new Tree_seq());
+        return make<T>(k, make<Tree_seq>());
 
       if (Tree_seq* ts = parse_elem_list(p, close_tok)) {
         if (parse::expect(p, close_tok))
-          return new T(k, ts);
+          return make<T>(k, ts);
       } else {
         // TODO: expected after the open_token
         parse::parse_error(p) << "expected 'elem-list'";
@@ -313,7 +315,7 @@ parse_list_expr(Parser& p) {
 //    tuple-expr ::= '<' t1, ..., tn '>'
 Tree*
 parse_variant_expr(Parser& p) {
-  parse_enclosed_seq<Variant_tree>(p, langle_tok, rangle_tok);
+  return parse_enclosed_seq<Variant_tree>(p, langle_tok, rangle_tok);
 }
 
 // Parse a grouped expression.
@@ -329,7 +331,7 @@ parse_grouped_expr(Parser& p) {
   if (const Token* k = parse::accept(p, lparen_tok)) {
     // This is a comma expression.
     if (parse::accept(p, rparen_tok))
-      return new Comma_tree(k, new Tree_seq());
+      return make<Comma_tree>(k, make<Tree_seq>());
 
     if (Tree* t = parse_expr(p)) {
       // This is a grouped subexpression.
@@ -338,7 +340,7 @@ parse_grouped_expr(Parser& p) {
       }
 
       // This is a grouped sub-expression.
-      Tree_seq* ts = new Tree_seq {t};
+      Tree_seq* ts = make<Tree_seq>(1, t);
       while (parse::accept(p, comma_tok)) {
         if (Tree* t = parse_expr(p))
           ts->push_back(t);
@@ -348,7 +350,7 @@ parse_grouped_expr(Parser& p) {
 
       // Make sure we have a closing rparen.
       if (parse::expect(p, rparen_tok)) {
-        return new Comma_tree(k, ts);
+        return make<Comma_tree>(k, ts);
       }
     } else {
       parse::parse_error(p) << "expected 'expr' after '('";
@@ -359,7 +361,7 @@ parse_grouped_expr(Parser& p) {
 
 // Parse selection.
 //
-//    stmt ::= select col from table where bool
+//    stmt ::= select col from table where bool [group by cols]
 Tree*
 parse_select_expr(Parser& p) {
     if(const Token* s = parse::accept(p, select_tok)) {
@@ -368,7 +370,14 @@ parse_select_expr(Parser& p) {
           if (Tree* t2 = parse_expr(p)) {
             if(parse::expect(p, where_tok)) {
               if (Tree* t3 = parse_expr(p)) { 
-                return new Select_tree(s,t1,t2,t3);
+                if (not parse::accept(p, group_tok))
+                  return make<Select_tree>(s,t1,t2,t3,nullptr);
+                if (parse::expect(p, by_tok)) {
+                  if (Tree* t4 = parse_expr(p))
+                    return make<Select_tree>(s,t1,t2,t3,t4);
+                  else
+                    parse::parse_error(p) << "expected 'expr' after 'group by'";
+                }
               }
             }
           }
@@ -378,6 +387,30 @@ parse_select_expr(Parser& p) {
     return nullptr;
 }
 
+// Parse an aggregate of a column.
+//
+//    aggregate-expr ::= 'count' prefix-expr
+//                     | 'sum' prefix-expr
+//                     | 'min' prefix-expr
+//                     | 'max' prefix-expr
+Tree*
+parse_aggregate_expr(Parser& p) {
+  const Token* k = parse::accept(p, count_tok);
+  if (not k)
+    k = parse::accept(p, sum_tok);
+  if (not k)
+    k = parse::accept(p, min_tok);
+  if (not k)
+    k = parse::accept(p, max_tok);
+  if (k) {
+    if (Tree* t = parse_prefix_expr(p))
+      return make<Aggregate_tree>(k, t);
+    else
+      parse::parse_error(p) << "expected 'prefix-expr' after '" << k->text << "'";
+  }
+  return nullptr;
+}
+
 // Parse a primary expression.
 //
 //    primary-term ::= primary-lambda-term | grouped-term
@@ -406,7 +439,7 @@ parse_primary_expr(Parser& p) {
 Tree*
 parse_application_expr(Parser& p, Tree* t1) {
   if (Tree* t2 = parse_primary_expr(p))
-    return new App_tree(t1, t2);
+    return make<App_tree>(t1, t2);
   return nullptr;
 }
 
@@ -417,7 +450,7 @@ Tree*
 parse_dot_expr(Parser& p, Tree* t1) {
   if (parse::accept(p, dot_tok))
     if (Tree* t2 = parse_primary_expr(p))
-      return new Dot_tree(t1, t2);
+      return make<Dot_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'primary-expr' after '.'";
   return nullptr;
@@ -430,7 +463,7 @@ Tree*
 parse_and_expr(Parser& p, Tree* t1) {
   if(parse::accept(p, and_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new And_tree(t1, t2);
+      return make<And_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'expr' after 'and'";
   }
@@ -444,7 +477,7 @@ Tree*
 parse_or_expr(Parser& p, Tree* t1) {
   if(parse::accept(p, or_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new Or_tree(t1, t2);
+      return make<Or_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'expr' after 'or'";
   }
@@ -458,7 +491,7 @@ Tree*
 parse_eq_comp_expr(Parser& p, Tree* t1) {
   if(const Token* t = parse::accept(p, eq_comp_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new Eq_comp_tree(t1, t2);
+      return make<Eq_comp_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'expr' after '=='";
   }
@@ -472,7 +505,7 @@ Tree*
 parse_less_expr(Parser& p, Tree* t1) {
   if(const Token* t = parse::accept(p, less_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new Less_tree(t1, t2);
+      return make<Less_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'expr' after '<'";
   }
@@ -486,7 +519,7 @@ Tree*
 parse_union(Parser& p, Tree* t1) {
   if(parse::accept(p, union_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new Union_tree(t1, t2);
+      return make<Union_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'expr' after 'union'";
   }
@@ -500,10 +533,11 @@ Tree*
 parse_intersect(Parser& p, Tree* t1) {
   if(parse::accept(p, intersect_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new Intersect_tree(t1, t2);
+      return make<Intersect_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'expr' after 'intersect'";
   }
+  return nullptr;
 }
 
 // Parse an except expression
@@ -513,10 +547,11 @@ Tree*
 parse_except(Parser& p, Tree* t1) {
   if(parse::accept(p, except_tok)) {
     if(Tree* t2 = parse_expr(p))
-      return new Except_tree(t1, t2);
+      return make<Except_tree>(t1, t2);
     else
       parse::parse_error(p) << "expected 'table_expr' after 'Join'";
   }
+  return nullptr;
 }
 
 // Parse Join.
@@ -527,7 +562,7 @@ parse_join(Parser& p, Tree* t1) {
       if(Tree* t2 = parse_expr(p))
         if(parse::expect(p, on_tok)) 
           if(Tree* t3 = parse_expr(p))
-            return new Join_on_tree(s,t1,t2,t3);
+            return make<Join_on_tree>(s,t1,t2,t3);
           else
             parse::parse_error(p) << "expected 'expr' after 'on'";
         else
@@ -584,7 +619,7 @@ parse_if_expr(Parser& p) {
         if (Tree* t2 = parse_expr(p)) {
           if (parse::expect(p, else_tok)) {
             if (Tree* t3 = parse_expr(p))
-              return new If_tree(k, t1, t2, t3);
+              return make<If_tree>(k, t1, t2, t3);
             else
               parse::parse_error(p) << "expected 'expr' after 'else'";
           }
@@ -604,7 +639,7 @@ Tree*
 parse_succ_expr(Parser& p) {
   if (const Token* k = parse::accept(p, succ_tok)) {
     if (Tree* t = parse_prefix_expr(p))
-      return new Succ_tree(k, t);
+      return make<Succ_tree>(k, t);
     else
       parse::parse_error(p) << "expected 'prefix-expr' after 'succ'";
   }
@@ -618,7 +653,7 @@ Tree*
 parse_pred_expr(Parser& p) {
   if (const Token* k = parse::accept(p, pred_tok)) {
     if (Tree* t = parse_prefix_expr(p))
-      return new Pred_tree(k, t);
+      return make<Pred_tree>(k, t);
     else
       parse::parse_error(p) << "expected 'prefix-expr' after 'pred'";
   }
@@ -632,7 +667,7 @@ Tree*
 parse_iszero_expr(Parser& p) {
   if (const Token* k = parse::accept(p, iszero_tok)) {
     if (Tree* t = parse_prefix_expr(p))
-      return new Iszero_tree(k, t);
+      return make<Iszero_tree>(k, t);
     else
       parse::parse_error(p) << "expected 'prefix-expr' after 'iszero'";
   }
@@ -646,13 +681,49 @@ Tree*
 parse_print_expr(Parser& p) {
   if (const Token* k = parse::accept(p, print_tok)) {
     if (Tree* t = parse_expr(p))
-      return new Print_tree(k, t);
+      return make<Print_tree>(k, t);
     else
       parse::parse_error(p) << "expected 'expr' after 'print'";
   }
   return nullptr;
 }
 
+// Parse a load expression.
+//
+//    load-expr ::= 'load' string-literal 'as' prefix-expr
+Tree*
+parse_load_expr(Parser& p) {
+  if (const Token* k = parse::accept(p, load_tok)) {
+    if (const Token* f = parse::expect(p, string_literal_tok)) {
+      if (parse::expect(p, as_tok)) {
+        if (Tree* t = parse_prefix_expr(p))
+          return make<Load_tree>(k, make<Lit_tree>(f), t);
+        else
+          parse::parse_error(p) << "expected 'prefix-expr' after 'as'";
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Parse a save expression.
+//
+//    save-expr ::= 'save' expr 'to' string-literal
+Tree*
+parse_save_expr(Parser& p) {
+  if (const Token* k = parse::accept(p, save_tok)) {
+    if (Tree* t = parse_expr(p)) {
+      if (parse::expect(p, to_tok)) {
+        if (const Token* f = parse::expect(p, string_literal_tok))
+          return make<Save_tree>(k, t, make<Lit_tree>(f));
+      }
+    } else {
+      parse::parse_error(p) << "expected 'expr' after 'save'";
+    }
+  }
+  return nullptr;
+}
+
 // Parse a typeof expression.
 //
 //    typeof-expr ::= 'typeof' expr
@@ -660,7 +731,7 @@ Tree*
 parse_typeof_expr(Parser& p) {
   if (const Token* k = parse::accept(p, typeof_tok)) {
     if (Tree* t = parse_expr(p))
-      return new Typeof_tree(k, t);
+      return make<Typeof_tree>(k, t);
     else
       parse::parse_error(p) << "expected 'expr' after 'typeof'";
   }
@@ -674,7 +745,7 @@ Tree*
 parse_not_expr(Parser& p) {
   if (const Token* k = parse::accept(p, not_tok)) {
     if (Tree* t = parse_expr(p))
-      return new Not_tree(k, t);
+      return make<Not_tree>(k, t);
     else
       parse::parse_error(p) << "expected 'expr' after 'not'";
   }
@@ -710,6 +781,8 @@ parse_prefix_expr(Parser& p) {
     return t;
   if (Tree* t = parse_select_expr(p))
     return t;
+  if (Tree* t = parse_aggregate_expr(p))
+    return t;
   if (Tree* t = parse_succ_expr(p))
     return t;
   if (Tree* t = parse_pred_expr(p))
@@ -718,6 +791,10 @@ parse_prefix_expr(Parser& p) {
     return t;
   if (Tree* t = parse_print_expr(p))
     return t;
+  if (Tree* t = parse_load_expr(p))
+    return t;
+  if (Tree* t = parse_save_expr(p))
+    return t;
   if (Tree* t = parse_typeof_expr(p))
     return t;
   if (Tree* t = parse_not_expr(p))
@@ -734,7 +811,7 @@ parse_arrow_expr(Parser& p) {
   if (Tree* l = parse_prefix_expr(p)) {
     if (parse::accept(p, arrow_tok))
       if (Tree* r = parse_arrow_expr(p))
-        return new Arrow_tree(l, r);
+        return make<Arrow_tree>(l, r);
     return l;
   }
   return nullptr;
@@ -781,7 +858,7 @@ parse_fn_decl(Parser& p, Tree* n) {
   if (Tree_seq* ps = parse_parm_clause(p))    
   //parsing parameter list as Lambda abstraction \(pi:Ti).e
   if (Tree* t = parse_return_type(p))
-     return new Func_tree(n, ps, t);
+     return make<Func_tree>(n, ps, t);
   return nullptr;
 }
 
@@ -792,7 +869,7 @@ Tree*
 parse_const_decl(Parser& p,Tree *n,const Token *k) {
   if (parse::accept(p, equal_tok)) {
    if (Tree* e = parse_expr(p))
-      return new Def_tree(k, n, e);
+      return make<Def_tree>(k, n, e);
    else
       parse::parse_error(p) << "expected 'expr' after '='";
   }
@@ -819,15 +896,15 @@ parse_def_decl(Parser& p) {
       }
       // Parse the initializer.
       if (Tree* e = parse_required_initializer_clause(p))
-        return new Def_tree(k, d1, e);
+        return make<Def_tree>(k, d1, e);
       else 
         return d1;
   }
   else 
    return nullptr;
+  return nullptr;
 }
 
-<<<<<<< HEAD
 // Parse an imported module
 Tree*
 parse_import(Parser& p) {
@@ -871,7 +948,7 @@ parse_import(Parser& p) {
       if (Tree* n = parse_name(p)) {
       if (parse::expect(p, equal_tok)) {
       if (Tree* e = parse_expr(p))
-      return new Def_tree(k, n, e);
+      return make<Def_tree>(k, n, e);
       else
       parse::parse_error(p) << "expected 'expr' after '='";
       }
@@ -882,21 +959,15 @@ parse_import(Parser& p) {
   }
   return nullptr;
 }
-=======
->>>>>>> upstream/master
 
 // Parse a statement.
 //
 //    stmt ::= def-stmt | expr-stmt
 Tree*
 parse_stmt(Parser& p) {
-<<<<<<< HEAD
   if (Tree* t = parse_import(p))
     return t;
-  if (Tree* t = parse_def(p))
-=======
   if (Tree* t = parse_def_decl(p))
->>>>>>> upstream/master
     return t;
   if (Tree* t = parse_expr(p))
     return t;
@@ -910,7 +981,7 @@ parse_stmt(Parser& p) {
 //
 Tree*
 parse_program(Parser& p) {
-  Tree_seq* stmts = new Tree_seq();
+  Tree_seq* stmts = make<Tree_seq>();
   while (not parse::end_of_stream(p)) {
     if (Tree* s = parse_stmt(p))
       stmts->push_back(s);
@@ -921,7 +992,7 @@ parse_program(Parser& p) {
     if (not parse::expect(p, semicolon_tok))
       return nullptr;
   }
-  return new Prog_tree(stmts);
+  return make<Prog_tree>(stmts);
 }
 
 
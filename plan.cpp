@@ -0,0 +1,608 @@
+
+#include "plan.hpp"
+#include "type.hpp"
+#include "eval.hpp"
+
+#include "lang/debug.hpp"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------- //
+// Plan operators
+
+Scan_plan::Scan_plan(Table* t, Def* d)
+  : Plan(scan_plan), table(t), def(d)
+{
+  attrs = get_attrs(t, d);
+}
+
+Filter_plan::Filter_plan(Plan* p, Term_seq* cs)
+  : Plan(filter_plan), input(p), conds(cs)
+{
+  attrs = p->attrs;
+}
+
+Project_plan::Project_plan(Plan* p, const std::vector<int>& cs)
+  : Plan(project_plan), input(p), cols(cs)
+{
+  attrs.reserve(cs.size());
+  for (int i : cs)
+    attrs.push_back(p->attrs[i]);
+}
+
+Join_plan::Join_plan(Plan* l, Plan* r, Term_seq* cs)
+  : Plan(join_plan), left(l), right(r), conds(cs)
+{
+  attrs = l->attrs;
+  attrs.insert(attrs.end(), r->attrs.begin(), r->attrs.end());
+}
+
+Set_plan::Set_plan(Plan_kind k, Plan* l, Plan* r)
+  : Plan(k), left(l), right(r)
+{
+  attrs = l->attrs;
+}
+
+Aggregate_plan::Aggregate_plan(Plan* p, const std::vector<int>& ks, const Aggregate_seq& as)
+  : Plan(aggregate_plan), input(p), keys(ks), aggs(as)
+{
+  attrs.reserve(ks.size() + as.size());
+  for (int i : ks)
+    attrs.push_back(p->attrs[i]);
+  for (const Aggregate_col& a : as)
+    attrs.push_back(a.attr);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Lowering
+
+namespace {
+
+// Split the condition t into its 'and' conjuncts, appending them
+// to cs.
+void
+get_conjuncts(Term* t, Term_seq* cs) {
+  if (And* a = as<And>(t)) {
+    get_conjuncts(a->t1, cs);
+    get_conjuncts(a->t2, cs);
+  } else {
+    cs->push_back(t);
+  }
+}
+
+// Returns the conjuncts of the condition t.
+Term_seq*
+get_conjuncts(Term* t) {
+  Term_seq* cs = make<Term_seq>();
+  get_conjuncts(t, cs);
+  return cs;
+}
+
+// Returns the position of the column of p named by the member access
+// t. When the table of t is not a source of p, the column is found by
+// its name alone.
+int
+get_named_column(Term* t, Plan* p) {
+  int i = get_column_index(t, p->attrs);
+  if (i >= 0)
+    return i;
+  Mem* m = as<Mem>(t);
+  Ref* ref = m ? as<Ref>(m->member()) : nullptr;
+  Var* v = ref ? as<Var>(ref->decl()) : nullptr;
+  if (v) {
+    for (std::size_t k = 0; k < p->attrs.size(); ++k) {
+      if (is_same(p->attrs[k].var->name(), v->name()))
+        return k;
+    }
+  }
+  lang_unreachable("projection of an unknown column");
+}
+
+// Returns the elements of the projection or group list t.
+Term_seq
+get_select_elems(Term* t) {
+  Term_seq ts;
+  if (Comma* c = as<Comma>(t)) {
+    for (Expr* e : *c->elems())
+      ts.push_back(as<Term>(e));
+  } else {
+    ts.push_back(t);
+  }
+  return ts;
+}
+
+// Returns the aggregate a of a column of p. The column of the result
+// is named by the function and the aggregated column, as in 'sum_n'.
+Aggregate_col
+make_aggregate(Aggregate* a, Plan* p) {
+  static const char* names[] = {"count_", "sum_", "min_", "max_"};
+  int i = get_named_column(a->arg(), p);
+  Var* v = p->attrs[i].var;
+  String n = names[a->op] + as<Id>(v->name())->t1.str();
+  Type* t = a->op == count_agg or a->op == sum_agg ? get_nat_type() : v->type();
+  return {a->op, i, {nullptr, make<Var>(make<Id>(n), t)}};
+}
+
+// Lower the grouped select 'select t1 from t2 where t3 group by t4'
+// into the projection of t1 over the aggregation of the rows of t2
+// satisfying each conjunct of t3. Each element of t1 is either an
+// aggregate or one of the grouped columns t4.
+Plan*
+make_group_plan(Arena& plans, Select_from_where* t, Plan* p) {
+  std::vector<int> keys;
+  if (t->group_list()) {
+    for (Term* g : get_select_elems(t->group_list()))
+      keys.push_back(get_named_column(g, p));
+  }
+
+  Aggregate_seq aggs;
+  std::vector<int> cols;
+  for (Term* e : get_select_elems(t->projection_list())) {
+    if (Aggregate* a = as<Aggregate>(e)) {
+      cols.push_back(keys.size() + aggs.size());
+      aggs.push_back(make_aggregate(a, p));
+      continue;
+    }
+    auto iter = std::find(keys.begin(), keys.end(), get_named_column(e, p));
+    lang_assert(iter != keys.end(), "projection of a column that is not grouped");
+    cols.push_back(iter - keys.begin());
+  }
+  return plans.make<Project_plan>(plans.make<Aggregate_plan>(p, keys, aggs), cols);
+}
+
+// Returns true if the select t groups its rows.
+bool
+is_grouped(Select_from_where* t) {
+  if (t->group_list())
+    return true;
+  for (Term* e : get_select_elems(t->projection_list())) {
+    if (is<Aggregate>(e))
+      return true;
+  }
+  return false;
+}
+
+// Lower 'select t1 from t2 where t3' into the projection of t1 over the
+// rows of t2 satisfying each conjunct of t3.
+Plan*
+make_select_plan(Arena& plans, Select_from_where* t) {
+  Plan* p = make_plan(plans, t->table());
+  p = plans.make<Filter_plan>(p, get_conjuncts(t->cond()));
+  if (is_grouped(t))
+    return make_group_plan(plans, t, p);
+  std::vector<int> cols;
+  for (Term* e : get_select_elems(t->projection_list()))
+    cols.push_back(get_named_column(e, p));
+  return plans.make<Project_plan>(p, cols);
+}
+
+// Lower 't1 join t2 on t3'.
+Plan*
+make_join_plan(Arena& plans, Join* t) {
+  Plan* a = make_plan(plans, t->table_a());
+  Plan* b = make_plan(plans, t->table_b());
+  return plans.make<Join_plan>(a, b, get_conjuncts(t->join_cond()));
+}
+
+// Lower the column projection 't.n' of a table t.
+Plan*
+make_column_plan(Arena& plans, Mem* t) {
+  Plan* p = make_plan(plans, t->record());
+  return plans.make<Project_plan>(p, std::vector<int>{get_named_column(t, p)});
+}
+
+// Lower a table value. The term is evaluated to obtain the table.
+Plan*
+make_scan_plan(Arena& plans, Term* t) {
+  Table* table = as<Table>(to_table(eval(t)));
+  lang_assert(table, "relational term is not a table");
+  return plans.make<Scan_plan>(table, get_table_def(t));
+}
+
+} // namespace
+
+// Returns true if t is a relational term: a term that computes a table
+// and can be lowered into a plan.
+bool
+is_relational(Term* t) {
+  switch (t->kind) {
+  case select_term:
+  case join_on_term:
+    return true;
+  case union_term:
+    return is_relational(as<Union>(t)->t1);
+  case intersect_term:
+    return is_relational(as<Intersect>(t)->t1);
+  case except_term:
+    return is_relational(as<Except>(t)->t1);
+  case ref_term:
+    if (Def* d = get_table_def(t))
+      return is<Table>(d->value());
+    break;
+  default:
+    break;
+  }
+  return is_table_type(get_type(t));
+}
+
+// Returns the logical plan for the relational term t, in the order
+// written. The plan is allocated in plans.
+Plan*
+make_plan(Arena& plans, Term* t) {
+  switch (t->kind) {
+  case select_term:
+    return make_select_plan(plans, as<Select_from_where>(t));
+  case join_on_term:
+    return make_join_plan(plans, as<Join>(t));
+  case mem_term:
+    return make_column_plan(plans, as<Mem>(t));
+  case union_term: {
+    Union* u = as<Union>(t);
+    Plan* l = make_plan(plans, u->t1);
+    return plans.make<Set_plan>(union_plan, l, make_plan(plans, u->t2));
+  }
+  case intersect_term: {
+    Intersect* i = as<Intersect>(t);
+    Plan* l = make_plan(plans, i->t1);
+    return plans.make<Set_plan>(intersect_plan, l, make_plan(plans, i->t2));
+  }
+  case except_term: {
+    Except* e = as<Except>(t);
+    Plan* l = make_plan(plans, e->t1);
+    return plans.make<Set_plan>(except_plan, l, make_plan(plans, e->t2));
+  }
+  default:
+    return make_scan_plan(plans, t);
+  }
+}
+
+
+// -------------------------------------------------------------------------- //
+// Column references
+
+namespace {
+
+bool get_column_refs(Term*, Attr_seq&);
+
+template<typename T>
+  inline bool
+  refs_unary(T* t, Attr_seq& refs) {
+    return get_column_refs(t->t1, refs);
+  }
+
+template<typename T>
+  inline bool
+  refs_binary(T* t, Attr_seq& refs) {
+    return get_column_refs(t->t1, refs) and get_column_refs(t->t2, refs);
+  }
+
+template<typename T>
+  inline bool
+  refs_ternary(T* t, Attr_seq& refs) {
+    return refs_binary(t, refs) and get_column_refs(t->t3, refs);
+  }
+
+// Appends the attributes of the columns referred to by the condition
+// t to refs. Returns false when t may depend on the rows of a table in
+// some other way, in which case the condition cannot be moved.
+bool
+get_column_refs(Term* t, Attr_seq& refs) {
+  switch (t->kind) {
+  case unit_term:
+  case true_term:
+  case false_term:
+  case int_term:
+  case str_term:
+    return true;
+  case mem_term: {
+    Mem* m = as<Mem>(t);
+    Def* d = get_table_def(m->record());
+    Ref* ref = as<Ref>(m->member());
+    Var* v = ref ? as<Var>(ref->decl()) : nullptr;
+    if (d and v and is<Table>(d->value())) {
+      refs.push_back({d, v});
+      return true;
+    }
+    return get_column_refs(m->record(), refs);
+  }
+  case ref_term: {
+    // Tables may only be referred to through their columns.
+    Def* d = get_table_def(t);
+    return not d or not is<Table>(d->value());
+  }
+  case succ_term: return refs_unary(as<Succ>(t), refs);
+  case pred_term: return refs_unary(as<Pred>(t), refs);
+  case iszero_term: return refs_unary(as<Iszero>(t), refs);
+  case not_term: return refs_unary(as<Not>(t), refs);
+  case and_term: return refs_binary(as<And>(t), refs);
+  case or_term: return refs_binary(as<Or>(t), refs);
+  case equals_term: return refs_binary(as<Equals>(t), refs);
+  case less_term: return refs_binary(as<Less>(t), refs);
+  case if_term: return refs_ternary(as<If>(t), refs);
+  default:
+    return false;
+  }
+}
+
+// Returns true if the attribute a is one of attrs.
+bool
+has_attr(const Attr_seq& attrs, const Attr& a) {
+  for (const Attr& b : attrs) {
+    if (is_same_attr(a, b))
+      return true;
+  }
+  return false;
+}
+
+// Returns the position of the first attribute of attrs that is a.
+int
+find_attr(const Attr_seq& attrs, const Attr& a) {
+  for (std::size_t i = 0; i < attrs.size(); ++i) {
+    if (is_same_attr(a, attrs[i]))
+      return i;
+  }
+  lang_unreachable("unknown attribute");
+}
+
+// Returns true if each of the attributes refs is one of attrs.
+bool
+has_all_attrs(const Attr_seq& attrs, const Attr_seq& refs) {
+  for (const Attr& a : refs) {
+    if (not has_attr(attrs, a))
+      return false;
+  }
+  return true;
+}
+
+// Returns true if none of the attributes refs is one of attrs.
+bool
+has_no_attrs(const Attr_seq& attrs, const Attr_seq& refs) {
+  for (const Attr& a : refs) {
+    if (has_attr(attrs, a))
+      return false;
+  }
+  return true;
+}
+
+// Returns true if a and b have the same attributes in the same order.
+bool
+is_same_attrs(const Attr_seq& a, const Attr_seq& b) {
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (not is_same_attr(a[i], b[i]))
+      return false;
+  }
+  return true;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Predicate pushdown
+
+// Returns the plan p filtered by the conditions cs, with each
+// condition moved as close to the tables it refers to as possible.
+//
+// A condition on a join is moved into the input whose columns it
+// refers to, or becomes a condition of the join when it refers to
+// both. A condition on an intersection or difference is moved into
+// its left input, which determines the rows of the result. A
+// condition on a union is moved into both inputs when they have the
+// same attributes.
+Plan*
+push_filters(Arena& plans, Plan* p, Term_seq* cs) {
+  switch (p->kind) {
+  case scan_plan:
+    return cs->empty() ? p : plans.make<Filter_plan>(p, cs);
+
+  case filter_plan: {
+    Filter_plan* f = as<Filter_plan>(p);
+    Term_seq* all = make<Term_seq>(*cs);
+    all->insert(all->end(), f->conds->begin(), f->conds->end());
+    return push_filters(plans, f->input, all);
+  }
+
+  case project_plan: {
+    Project_plan* pr = as<Project_plan>(p);
+    return plans.make<Project_plan>(push_filters(plans, pr->input, cs), pr->cols);
+  }
+
+  case join_plan: {
+    Join_plan* j = as<Join_plan>(p);
+    Term_seq* all = make<Term_seq>(*cs);
+    all->insert(all->end(), j->conds->begin(), j->conds->end());
+
+    Term_seq* left = make<Term_seq>();
+    Term_seq* right = make<Term_seq>();
+    Term_seq* conds = make<Term_seq>();
+    for (Term* c : *all) {
+      Attr_seq refs;
+      if (get_column_refs(c, refs)) {
+        // A column of both inputs refers to the left one.
+        if (has_all_attrs(j->left->attrs, refs)) {
+          left->push_back(c);
+          continue;
+        }
+        if (has_all_attrs(j->right->attrs, refs) and
+            has_no_attrs(j->left->attrs, refs)) {
+          right->push_back(c);
+          continue;
+        }
+      }
+      conds->push_back(c);
+    }
+    Plan* l = push_filters(plans, j->left, left);
+    Plan* r = push_filters(plans, j->right, right);
+    return plans.make<Join_plan>(l, r, conds);
+  }
+
+  case union_plan: {
+    Set_plan* s = as<Set_plan>(p);
+    Term_seq* none = make<Term_seq>();
+    if (is_same_attrs(s->left->attrs, s->right->attrs)) {
+      Plan* l = push_filters(plans, s->left, cs);
+      Plan* r = push_filters(plans, s->right, cs);
+      return plans.make<Set_plan>(p->kind, l, r);
+    }
+    Plan* l = push_filters(plans, s->left, none);
+    Plan* r = push_filters(plans, s->right, none);
+    Plan* u = plans.make<Set_plan>(p->kind, l, r);
+    return cs->empty() ? u : plans.make<Filter_plan>(u, cs);
+  }
+
+  case intersect_plan:
+  case except_plan: {
+    Set_plan* s = as<Set_plan>(p);
+    Plan* l = push_filters(plans, s->left, cs);
+    Plan* r = push_filters(plans, s->right, make<Term_seq>());
+    return plans.make<Set_plan>(p->kind, l, r);
+  }
+
+  case aggregate_plan: {
+    // Conditions on the groups are not moved into the input.
+    Aggregate_plan* a = as<Aggregate_plan>(p);
+    Plan* in = push_filters(plans, a->input, make<Term_seq>());
+    Plan* g = plans.make<Aggregate_plan>(in, a->keys, a->aggs);
+    return cs->empty() ? g : plans.make<Filter_plan>(g, cs);
+  }
+  }
+  lang_unreachable("unknown plan");
+}
+
+
+// -------------------------------------------------------------------------- //
+// Column pruning
+
+// Returns the projection of p onto the columns whose attributes are
+// in need, in the order of p. Returns p when all columns are needed.
+// At least one column is kept so that the rows are not lost.
+Plan*
+keep_columns(Arena& plans, Plan* p, const Attr_seq& need) {
+  std::vector<int> cols;
+  for (std::size_t i = 0; i < p->attrs.size(); ++i) {
+    if (has_attr(need, p->attrs[i]))
+      cols.push_back(i);
+  }
+  if (cols.size() == p->attrs.size())
+    return p;
+  if (cols.empty())
+    cols.push_back(0);
+  return plans.make<Project_plan>(p, cols);
+}
+
+// Returns the projection of p onto the given attributes, in that order.
+// Nested projections are combined, and the identity projection is
+// removed.
+Plan*
+make_project(Arena& plans, Plan* p, const Attr_seq& attrs) {
+  std::vector<int> cols;
+  cols.reserve(attrs.size());
+  for (const Attr& a : attrs)
+    cols.push_back(find_attr(p->attrs, a));
+
+  if (Project_plan* pr = as<Project_plan>(p)) {
+    for (int& i : cols)
+      i = pr->cols[i];
+    p = pr->input;
+  }
+  bool same = cols.size() == p->attrs.size();
+  for (std::size_t i = 0; same and i < cols.size(); ++i)
+    same = cols[i] == (int)i;
+  return same ? p : plans.make<Project_plan>(p, cols);
+}
+
+// Adds the attributes of the columns referred to by the conditions cs
+// to need. If a condition may refer to any column, all the attributes
+// of p are added.
+void
+add_needed_columns(Plan* p, Term_seq* cs, Attr_seq& need) {
+  for (Term* c : *cs) {
+    if (not get_column_refs(c, need)) {
+      need.insert(need.end(), p->attrs.begin(), p->attrs.end());
+      return;
+    }
+  }
+}
+
+// Returns a plan computing the columns of p whose attributes are in
+// need, removing the other columns as early as possible. The result
+// may have more columns than needed.
+//
+// The columns of the inputs of set operations are never removed since
+// they determine which rows are the same. Filters on a table are kept
+// directly on that table so that its indexes can be used.
+Plan*
+prune_columns(Arena& plans, Plan* p, const Attr_seq& need) {
+  switch (p->kind) {
+  case scan_plan:
+    return keep_columns(plans, p, need);
+
+  case filter_plan: {
+    Filter_plan* f = as<Filter_plan>(p);
+    if (f->input->kind == scan_plan)
+      return keep_columns(plans, p, need);
+    Attr_seq n2 = need;
+    add_needed_columns(f->input, f->conds, n2);
+    return plans.make<Filter_plan>(prune_columns(plans, f->input, n2), f->conds);
+  }
+
+  case project_plan: {
+    Project_plan* pr = as<Project_plan>(p);
+    return make_project(plans, prune_columns(plans, pr->input, pr->attrs), pr->attrs);
+  }
+
+  case join_plan: {
+    Join_plan* j = as<Join_plan>(p);
+    Attr_seq n2 = need;
+    add_needed_columns(j, j->conds, n2);
+    Plan* l = prune_columns(plans, j->left, n2);
+    Plan* r = prune_columns(plans, j->right, n2);
+    return plans.make<Join_plan>(l, r, j->conds);
+  }
+
+  case union_plan:
+  case intersect_plan:
+  case except_plan: {
+    Set_plan* s = as<Set_plan>(p);
+    Plan* l = prune_columns(plans, s->left, s->left->attrs);
+    Plan* r = prune_columns(plans, s->right, s->right->attrs);
+    return plans.make<Set_plan>(p->kind, l, r);
+  }
+
+  case aggregate_plan: {
+    // Only the grouped and aggregated columns of the input are needed.
+    // Their positions are found again in the pruned input.
+    Aggregate_plan* a = as<Aggregate_plan>(p);
+    Attr_seq n2;
+    for (int i : a->keys)
+      n2.push_back(a->input->attrs[i]);
+    for (const Aggregate_col& c : a->aggs)
+      n2.push_back(a->input->attrs[c.col]);
+    Plan* in = prune_columns(plans, a->input, n2);
+    std::vector<int> keys;
+    for (int i : a->keys)
+      keys.push_back(find_attr(in->attrs, a->input->attrs[i]));
+    Aggregate_seq aggs = a->aggs;
+    for (Aggregate_col& c : aggs)
+      c.col = find_attr(in->attrs, a->input->attrs[c.col]);
+    return plans.make<Aggregate_plan>(in, keys, aggs);
+  }
+  }
+  lang_unreachable("unknown plan");
+}
+
+} // namespace
+
+// Rewrite the plan p into an equivalent plan that is cheaper to
+// execute. The conditions of filters and joins are split into their
+// conjuncts and moved toward the tables they refer to, and columns
+// that are not used by the result are removed early.
+//
+// The rewritten plan shares operators with p. Both are allocated in
+// plans, and are released with it.
+Plan*
+optimize(Arena& plans, Plan* p) {
+  p = push_filters(plans, p, make<Term_seq>());
+  return prune_columns(plans, p, p->attrs);
+}
@@ -0,0 +1,110 @@
+
+#ifndef PLAN_HPP
+#define PLAN_HPP
+
+#include "table.hpp"
+
+// This module defines logical query plans. A relational term (select,
+// join, the set operations, and column projections of tables) is
+// lowered into a tree of plan operators. The plan is rewritten by the
+// optimizer before it is executed by the evaluator.
+//
+// Each plan computes a table. The attributes of a plan describe the
+// columns of that table, so that conditions can be moved between
+// operators without changing the columns they refer to.
+//
+// The operators of a plan are allocated in an arena that is released
+// once the plan has been executed. Rewriting a plan shares operators
+// between the old and new plans, so they are never freed one by one.
+
+enum Plan_kind {
+  scan_plan,      // A table value
+  filter_plan,    // The rows of a plan satisfying conditions
+  project_plan,   // Some columns of a plan
+  join_plan,      // The pairs of rows of two plans satisfying conditions
+  union_plan,     // The rows of either plan
+  intersect_plan, // The rows of both plans
+  except_plan,    // The rows of one plan but not the other
+  aggregate_plan  // The aggregates of the groups of rows of a plan
+};
+
+struct Plan {
+  Plan(Plan_kind k)
+    : kind(k) { }
+  virtual ~Plan() { }
+
+  Plan_kind kind;
+  Attr_seq attrs;
+};
+
+// A table value. When the table is the value of a definition, that
+// definition is the source of its columns.
+struct Scan_plan : Plan {
+  Scan_plan(Table*, Def*);
+
+  Table* table;
+  Def* def;
+};
+
+// The rows of the input for which each condition is true.
+struct Filter_plan : Plan {
+  Filter_plan(Plan*, Term_seq*);
+
+  Plan* input;
+  Term_seq* conds;
+};
+
+// The columns of the input at the given positions, in that order.
+struct Project_plan : Plan {
+  Project_plan(Plan*, const std::vector<int>&);
+
+  Plan* input;
+  std::vector<int> cols;
+};
+
+// The merge of each pair of rows of the left and right inputs for
+// which each condition is true.
+struct Join_plan : Plan {
+  Join_plan(Plan*, Plan*, Term_seq*);
+
+  Plan* left;
+  Plan* right;
+  Term_seq* conds;
+};
+
+// A set operation on the rows of the left and right inputs. The
+// columns of the result are those of the left input.
+struct Set_plan : Plan {
+  Set_plan(Plan_kind, Plan*, Plan*);
+
+  Plan* left;
+  Plan* right;
+};
+
+// An aggregate function of a column of the input of an aggregation.
+// The attribute names the column of the result.
+struct Aggregate_col {
+  Aggregate_op op;
+  int col;
+  Attr attr;
+};
+
+using Aggregate_seq = std::vector<Aggregate_col>;
+
+// The rows of the input grouped by the columns keys. There is one row
+// for each group, in the order the groups first appear in the input.
+// The columns of the result are the keys, followed by the aggregates.
+struct Aggregate_plan : Plan {
+  Aggregate_plan(Plan*, const std::vector<int>&, const Aggregate_seq&);
+
+  Plan* input;
+  std::vector<int> keys;
+  Aggregate_seq aggs;
+};
+
+bool is_relational(Term*);
+
+Plan* make_plan(Arena&, Term*);
+Plan* optimize(Arena&, Plan*);
+
+#endif
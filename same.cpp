@@ -1,5 +1,6 @@
 
 #include "ast.hpp"
+#include "table.hpp"
 
 #include "lang/debug.hpp"
 
@@ -30,25 +31,15 @@ template<typename T>
 template<typename T>
   inline bool
   same_binary(T* a, T* b) {
-    if(is_same(a->t1, b->t1))
-      return true;
-    if (is_same(b->t1, a->t1))
-      return false;
-    return is_same(a->t2, b->t2);
+    return is_same(a->t1, b->t1) and is_same(a->t2, b->t2);
   }
 
 template<typename T>
   inline bool
   same_ternary(T* a, T* b) {
-    if(is_same(a->t1, b->t1))
-      return true;
-    if (is_same(b->t1, a->t1))
-      return false;
-    if(is_same(a->t2, b->t2))
-      return true;
-    if (is_same(b->t2, a->t2))
-      return false;
-    return is_same(a->t3, b->t3);
+    return is_same(a->t1, b->t1) 
+       and is_same(a->t2, b->t2) 
+       and is_same(a->t3, b->t3);
   }
 
 // Two refs are the same when they refer to the same declaration.
@@ -91,6 +82,41 @@ same_record_type(Record_type* a, Record_type* b) {
     return false;
 }
 
+// Two sequences are the same if they have the same length and
+// each respective element is the same.
+template<typename T>
+  inline bool
+  same_seq(Seq<T>* a, Seq<T>* b) {
+    if (a->size() != b->size())
+      return false;
+    auto it_a = a->begin();
+    auto it_b = b->begin();
+    for (; it_a != a->end(); ++it_a, ++it_b) {
+      if (!is_same(*it_a, *it_b))
+        return false;
+    }
+    return true;
+  }
+
+// Two function types are the same if they have the same parameter
+// types and the same result type.
+inline bool
+same_fn_type(Fn_type* a, Fn_type* b) {
+  return same_seq(a->parms(), b->parms()) and is_same(a->result(), b->result());
+}
+
+// Two tables are the same if they have the same number of rows
+// and each respective row is the same.
+inline bool
+same_table(Table* a, Table* b) {
+  if (a->size() != b->size())
+    return false;
+  for (std::size_t i = 0; i < a->size(); ++i)
+    if (!same_row(a, i, b, i))
+      return false;
+  return true;
+}
+
 // Two records are the same if every subterm of type Init is the same
 inline bool
 same_record(Record* a, Record* b) {
@@ -118,28 +144,41 @@ bool
 is_same(Expr* a, Expr* b) {
   if (a->kind != b->kind)
     return false;
+  // Hash-consed expressions are the same when they have the same
+  // canonical node.
+  if (a->canon and b->canon)
+    return a->canon == b->canon;
   switch (a->kind) {
   case id_expr: return same_unary(as<Id>(a), as<Id>(b));
   case unit_term: return true;
   case true_term: return true;
   case false_term: return true;
   case int_term: return as<Int>(a)->value() == as<Int>(b)->value();
+  case str_term: return is_same(as<Str>(a)->value(), as<Str>(b)->value());
   case if_term: return same_ternary(as<If>(a), as<If>(b));
   case succ_term: return same_unary(as<Succ>(a), as<Succ>(b));
   case pred_term: return same_unary(as<Pred>(a), as<Pred>(b));
   case iszero_term: return same_unary(as<Iszero>(a), as<Iszero>(b));
   case var_term: return same_var(as<Var>(a), as<Var>(b));
-  case abs_term: return same_binary(as<Var>(a), as<Var>(b));
-  case app_term: return same_binary(as<Var>(a), as<Var>(b));
+  case abs_term: return same_binary(as<Abs>(a), as<Abs>(b));
+  case app_term: return same_binary(as<App>(a), as<App>(b));
   case ref_term: return same_ref(as<Ref>(a), as<Ref>(b));
   case init_term: return same_init(as<Init>(a), as<Init>(b));
+  case tuple_term: return same_seq(as<Tuple>(a)->elems(), as<Tuple>(b)->elems());
+  case list_term: return same_seq(as<List>(a)->elems(), as<List>(b)->elems());
   case record_term: return same_record(as<Record>(a), as<Record>(b));
+  case table_term: return same_table(as<Table>(a), as<Table>(b));
   case kind_type: return true;
   case unit_type: return true;
   case bool_type: return true;
   case nat_type: return true;
+  case str_type: return true;
   case arrow_type: return same_binary(as<Arrow_type>(a), as<Arrow_type>(b));
+  case fn_type: return same_fn_type(as<Fn_type>(a), as<Fn_type>(b));
+  case tuple_type: return same_seq(as<Tuple_type>(a)->types(), as<Tuple_type>(b)->types());
   case record_type: return same_record_type(as<Record_type>(a), as<Record_type>(b));
   case list_type: return is_same(as<List_type>(a)->type(), as<List_type>(b)->type());
+  default: break;
   }
+  return false;
 }
@@ -4,6 +4,7 @@
 #include "lang/error.hpp"
 #include "lang/debug.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 namespace {
@@ -56,6 +57,8 @@ declare(Name* n, Expr* e) {
     return nullptr;
   }
   s->insert({n, e});
+  if (s->kind == lambda_scope and is<Var>(e))
+    s->parms.push_back(e);
   return e;
 }
 
@@ -83,10 +86,36 @@ lookup(Name* n) {
   return nullptr;
 }
 
+// Return the declaration associated with the name n, or nullptr if
+// no such name exists. When the declaration is a parameter of an
+// enclosing function, depth is the number of functions between the
+// current scope and that function, and slot is the position of the
+// parameter. Otherwise, depth is -1.
+Expr*
+lookup(Name* n, int& depth, int& slot) {
+  depth = -1;
+  slot = 0;
+  int d = 0;
+  for (Scope* s = current_scope(); s; s = s->parent) {
+    auto iter = s->find(n);
+    if (iter != s->end()) {
+      auto p = std::find(s->parms.begin(), s->parms.end(), iter->second);
+      if (p != s->parms.end()) {
+        depth = d;
+        slot = p - s->parms.begin();
+      }
+      return iter->second;
+    }
+    if (s->kind == lambda_scope)
+      ++d;
+  }
+  return nullptr;
+}
+
 // Create a fresh name for this scope.
 Name*
 fresh_name() {
   std::stringstream ss;
   ss << 'a' << ++current_scope()->counter;
-  return new Id(ss.str());
+  return make<Id>(ss.str());
 }
@@ -38,7 +38,7 @@ template<typename T>
   inline Expr*
   subst_unary_term(T* t, const Subst& sub) {
     Term* t1 = subst_term(t->t1, sub);
-    return new T(t->loc, get_type(t), t1);
+    return make<T>(t->loc, get_type(t), t1);
   }
 
 // Substitute into a unary term of the form 'op t1 t2'
@@ -50,7 +50,7 @@ template<typename T>
   subst_binary_term(T* t, const Subst& sub) {
     Term* t1 = subst_term(t->t1, sub);
     Term* t2 = subst_term(t->t2, sub);
-    return new T(t->loc, get_type(t), t1, t2);
+    return make<T>(t->loc, get_type(t), t1, t2);
   }
 
 // Substitute into a ternary term of the form 'op t1 t2 t3'
@@ -63,7 +63,7 @@ template<typename T>
     Term* t1 = subst_term(t->t1, sub);
     Term* t2 = subst_term(t->t2, sub);
     Term* t3 = subst_term(t->t3, sub);
-    return new T(t->loc, get_type(t), t1, t2, t3);
+    return make<T>(t->loc, get_type(t), t1, t2, t3);
   }
 
 // Substitute into the variable declaration of an abstraction.
@@ -95,11 +95,34 @@ subst_ref(Ref* t, const Subst& sub) {
     return t;
 }
 
+// Substitute into the body of a function. As with abstractions, the
+// parameters are not affected.
+//
+//    [x->s]\(p1, ..., pn).t = \(p1, ..., pn).[x->s]t
+inline Expr*
+subst_fn(Fn* t, const Subst& sub) {
+  Term* t2 = subst_term(t->term(), sub);
+  return make<Fn>(t->loc, get_type(t), t->parms(), t2);
+}
+
+// Substitute into the function and arguments of a call.
+//
+//    [x->s]f(t1, ..., tn) = [x->s]f([x->s]t1, ..., [x->s]tn)
+inline Expr*
+subst_call(Call* t, const Subst& sub) {
+  Term* t1 = subst_term(t->fn(), sub);
+  Term_seq* ts = make<Term_seq>();
+  ts->reserve(t->args()->size());
+  for (Term* a : *t->args())
+    ts->push_back(subst_term(a, sub));
+  return make<Call>(t->loc, get_type(t), t1, ts);
+}
+
 inline Expr*
 subst_mem(Mem* t, const Subst& sub) {
   Term* t1 = subst_term(t->t1, sub);
   Term* t2 = subst_term(t->t2, sub);
-  return new Mem(t->loc, get_unit_type(), t1, t2);
+  return make<Mem>(t->loc, get_unit_type(), t1, t2);
 }
 
 } // namespace
@@ -113,6 +136,10 @@ subst(Expr* e, const Subst& sub) {
   case false_term: return e;
   case if_term: return subst_ternary_term(as<If>(e), sub);
   case int_term: return e;
+  case str_term: return e;
+  case table_term: return e;
+  case load_term: return e;
+  case save_term: return subst_binary_term(as<Save>(e), sub);
   case and_term: return subst_binary_term(as<And>(e), sub);
   case or_term: return subst_binary_term(as<Or>(e), sub);
   case equals_term: return subst_binary_term(as<Equals>(e), sub);
@@ -124,6 +151,8 @@ subst(Expr* e, const Subst& sub) {
   case var_term: return subst_var(as<Var>(e), sub);
   case abs_term: return subst_binary_term(as<Abs>(e), sub);
   case app_term: return subst_binary_term(as<App>(e), sub);
+  case fn_term: return subst_fn(as<Fn>(e), sub);
+  case call_term: return subst_call(as<Call>(e), sub);
   case ref_term: return subst_ref(as<Ref>(e), sub);
   case mem_term: return subst_mem(as<Mem>(e), sub);
   case kind_type: return e;
@@ -137,13 +166,13 @@ subst(Expr* e, const Subst& sub) {
 }
 
 // Return the substituion of sub throught the given term.
-inline Term*
+Term*
 subst_term(Term* t, const Subst& sub) {
   return as<Term>(subst(t, sub));
 }
 
 // Return the substituion of sub throught the given type.
-inline Type*
+Type*
 subst_type(Type* t, const Subst& sub) {
   return as<Type>(subst(t, sub));
 }
@@ -22,6 +22,8 @@ init_trees() {
   init_node(arrow_tree, "arrow-tree");
   init_node(print_tree, "print-tree");
   init_node(typeof_tree, "typeof-tree");
+  init_node(load_tree, "load-tree");
+  init_node(save_tree, "save-tree");
   init_node(tuple_tree, "tuple-tree");
   init_node(list_tree, "list-tree");
   init_node(variant_tree, "variant-tree");
@@ -32,6 +34,7 @@ init_trees() {
   init_node(union_tree, "union-tree");
   init_node(intersect_tree, "intersect-tree");
   init_node(except_tree, "except-tree");
+  init_node(aggregate_tree, "aggregate-tree");
   init_node(and_tree, "and-tree");
   init_node(or_tree, "or-tree");
   init_node(not_tree, "not-tree");
@@ -152,6 +155,23 @@ pp_select(std::ostream& os, Select_tree* t) {
   os << "select " << pretty(t->t1) 
      << " from " << pretty(t->t2) 
      << " where " << pretty(t->t3);
+  if (t->t4)
+    os << " group by " << pretty(t->t4);
+}
+
+void
+pp_load(std::ostream& os, Load_tree* t) {
+  os << "load " << pretty(t->file()) << " as " << pretty(t->type());
+}
+
+void
+pp_save(std::ostream& os, Save_tree* t) {
+  os << "save " << pretty(t->table()) << " to " << pretty(t->file());
+}
+
+void
+pp_aggregate(std::ostream& os, Aggregate_tree* t) {
+  os << t->op()->text << ' ' << group(pretty(t->arg()));
 }
 
 void
@@ -240,6 +260,9 @@ print(std::ostream& os, Tree* t) {
   case dot_tree: return pp_dot(os, as<Dot_tree>(t));
   case select_tree: return pp_select(os, as<Select_tree>(t));
   case join_on_tree: return pp_join(os, as<Join_on_tree>(t));
+  case aggregate_tree: return pp_aggregate(os, as<Aggregate_tree>(t));
+  case load_tree: return pp_load(os, as<Load_tree>(t));
+  case save_tree: return pp_save(os, as<Save_tree>(t));
   case union_tree: return pp_union(os, as<Union_tree>(t));
   case intersect_tree: return pp_intersect(os, as<Intersect_tree>(t));
   case except_tree: return pp_except(os, as<Except_tree>(t));
@@ -26,13 +26,16 @@ constexpr Node_kind list_tree    = make_tree_node(151); // [t1, ..., tn]
 constexpr Node_kind variant_tree = make_tree_node(152); // <t1, ..., tn>
 constexpr Node_kind comma_tree   = make_tree_node(153); // t1, ..., tn
 constexpr Node_kind dot_tree     = make_tree_node(154); // t1.t2
-constexpr Node_kind select_tree  = make_tree_node(161); // select t1 from t2 where t3
+constexpr Node_kind select_tree  = make_tree_node(161); // select t1 from t2 where t3 group by t4
 constexpr Node_kind join_on_tree = make_tree_node(162); // t1 join t2 on t3
 constexpr Node_kind union_tree   = make_tree_node(163); // t1 union t2
 constexpr Node_kind intersect_tree = make_tree_node(164); // t1 intersect t2
 constexpr Node_kind except_tree  = make_tree_node(165); // t1 except t2
+constexpr Node_kind aggregate_tree = make_tree_node(166); // count t, sum t, ...
 constexpr Node_kind print_tree   = make_tree_node(200); // print t
 constexpr Node_kind typeof_tree  = make_tree_node(201); // typeof t
+constexpr Node_kind load_tree    = make_tree_node(202); // load "f" as t
+constexpr Node_kind save_tree    = make_tree_node(203); // save t to "f"
 constexpr Node_kind and_tree     = make_tree_node(300); // t1 and t2
 constexpr Node_kind or_tree      = make_tree_node(301); // t1 or t2
 constexpr Node_kind not_tree     = make_tree_node(302); // t1 not t2
@@ -41,6 +44,7 @@ constexpr Node_kind less_tree    = make_tree_node(304); // t1 < t2
 constexpr Node_kind prog_tree    = make_tree_node(500); // stmts
 
 struct Tree : Node { using Node::Node; };
+template<> struct node_info<Tree> : class_info<tree_class> { };
 
 using Tree_seq = Seq<Tree>;
 
@@ -52,6 +56,7 @@ struct Id_tree : Tree {
   
   const Token* t1;
 };
+template<> struct node_info<Id_tree> : kind_info<id_tree> { };
 
 struct Lit_tree : Tree {
   Lit_tree(const Token* k)
@@ -61,6 +66,7 @@ struct Lit_tree : Tree {
   
   const Token* t1;
 };
+template<> struct node_info<Lit_tree> : kind_info<lit_tree> { };
 
 // A labeled initializer of the form 'x=t'.
 struct Init_tree : Tree {
@@ -73,6 +79,7 @@ struct Init_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Init_tree> : kind_info<init_tree> { };
 
 struct Var_tree : Tree {
   Var_tree(Tree* t1, Tree* t2)
@@ -84,6 +91,7 @@ struct Var_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Var_tree> : kind_info<var_tree> { };
 
 struct Abs_tree : Tree {
   Abs_tree(const Token* k, Tree* t1, Tree* t2)
@@ -95,6 +103,7 @@ struct Abs_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Abs_tree> : kind_info<abs_tree> { };
 
 struct Fn_tree : Tree {
   Fn_tree(const Token* k, Tree_seq* t1, Tree* t2)
@@ -105,6 +114,7 @@ struct Fn_tree : Tree {
   Tree_seq* t1;
   Tree* t2;
 };
+template<> struct node_info<Fn_tree> : kind_info<fn_tree> { };
 
 struct Func_tree : Tree {
   Func_tree(Tree* n, Tree_seq* t2, Tree* t3)
@@ -118,6 +128,7 @@ struct Func_tree : Tree {
   Tree* t1;
   Tree* t3;
 };
+template<> struct node_info<Func_tree> : kind_info<func_tree> { };
 
 
 struct App_tree : Tree {
@@ -130,6 +141,7 @@ struct App_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<App_tree> : kind_info<app_tree> { };
 
 struct If_tree : Tree {
   If_tree(const Token* k, Tree* t1, Tree* t2, Tree* t3)
@@ -143,6 +155,7 @@ struct If_tree : Tree {
   Tree* t2;
   Tree* t3;
 };
+template<> struct node_info<If_tree> : kind_info<if_tree> { };
 
 struct Succ_tree : Tree {
   Succ_tree(const Token* k, Tree* t)
@@ -152,6 +165,7 @@ struct Succ_tree : Tree {
 
   Tree* t1;
 };
+template<> struct node_info<Succ_tree> : kind_info<succ_tree> { };
 
 struct Pred_tree : Tree {
   Pred_tree(const Token* k, Tree* t)
@@ -161,6 +175,7 @@ struct Pred_tree : Tree {
 
   Tree* t1;
 };
+template<> struct node_info<Pred_tree> : kind_info<pred_tree> { };
 
 struct Iszero_tree : Tree {
   Iszero_tree(const Token* k, Tree* t)
@@ -170,6 +185,7 @@ struct Iszero_tree : Tree {
 
   Tree* t1;
 };
+template<> struct node_info<Iszero_tree> : kind_info<iszero_tree> { };
 
 struct Arrow_tree : Tree {
   Arrow_tree(Tree* t1, Tree* t2)
@@ -181,6 +197,7 @@ struct Arrow_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Arrow_tree> : kind_info<arrow_tree> { };
 
 struct Def_tree : Tree {
   Def_tree(const Token* k, Tree* n, Tree* e)
@@ -192,6 +209,7 @@ struct Def_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Def_tree> : kind_info<def_tree> { };
 
 struct Print_tree : Tree {
   Print_tree(const Token* k, Tree* t)
@@ -201,6 +219,7 @@ struct Print_tree : Tree {
 
   Tree* t1;
 };
+template<> struct node_info<Print_tree> : kind_info<print_tree> { };
 
 struct Typeof_tree : Tree {
   Typeof_tree(const Token* k, Tree* t)
@@ -210,6 +229,7 @@ struct Typeof_tree : Tree {
 
   Tree* t1;
 };
+template<> struct node_info<Typeof_tree> : kind_info<typeof_tree> { };
 
 // A tuple of the form '{t1, ..., tn}' where each ti is one of
 // a term, a variable of the form 'x:T', or an initializer of 
@@ -223,6 +243,7 @@ struct Tuple_tree : Tree {
 
   Tree_seq* t1;
 };
+template<> struct node_info<Tuple_tree> : kind_info<tuple_tree> { };
 
 // A list of the form '[t1, ..., tn]' where each 'ti' is simply
 // some other term.
@@ -234,16 +255,61 @@ struct List_tree : Tree {
 
   Tree_seq* t1;
 };
+template<> struct node_info<List_tree> : kind_info<list_tree> { };
 
-// A sql statement of form select t1 from t2 where t3 
+// A sql statement of form select t1 from t2 where t3 group by t4.
+// The group by clause is optional; t4 is null when it is omitted.
 struct Select_tree : Tree {
-  Select_tree(const Token* k, Tree* t1, Tree* t2, Tree* t3) 
-    : Tree(select_tree, k->loc), t1(t1), t2(t2), t3(t3) { }
+  Select_tree(const Token* k, Tree* t1, Tree* t2, Tree* t3, Tree* t4)
+    : Tree(select_tree, k->loc), t1(t1), t2(t2), t3(t3), t4(t4) { }
 
   Tree* t1;
   Tree* t2;
   Tree* t3;
+  Tree* t4;
 };
+template<> struct node_info<Select_tree> : kind_info<select_tree> { };
+
+// A statement of form 'load "f" as t', where t is the record type of
+// the rows of the file f.
+struct Load_tree : Tree {
+  Load_tree(const Token* k, Tree* t1, Tree* t2)
+    : Tree(load_tree, k->loc), t1(t1), t2(t2) { }
+
+  Tree* file() const { return t1; }
+  Tree* type() const { return t2; }
+
+  Tree* t1;
+  Tree* t2;
+};
+template<> struct node_info<Load_tree> : kind_info<load_tree> { };
+
+// A statement of form 'save t to "f"', where t is a table.
+struct Save_tree : Tree {
+  Save_tree(const Token* k, Tree* t1, Tree* t2)
+    : Tree(save_tree, k->loc), t1(t1), t2(t2) { }
+
+  Tree* table() const { return t1; }
+  Tree* file() const { return t2; }
+
+  Tree* t1;
+  Tree* t2;
+};
+template<> struct node_info<Save_tree> : kind_info<save_tree> { };
+
+// An aggregate of a column in a select statement, of the form 'f t'
+// where f is one of count, sum, min, or max.
+struct Aggregate_tree : Tree {
+  Aggregate_tree(const Token* k, Tree* t)
+    : Tree(aggregate_tree, k->loc), t1(k), t2(t) { }
+
+  const Token* op() const { return t1; }
+  Tree* arg() const { return t2; }
+
+  const Token* t1;
+  Tree* t2;
+};
+template<> struct node_info<Aggregate_tree> : kind_info<aggregate_tree> { };
 
 // A sql statement of form t1 join t2 on t3
 struct Join_on_tree : Tree {
@@ -254,6 +320,7 @@ struct Join_on_tree : Tree {
   Tree* t2;
   Tree* t3;  
 };
+template<> struct node_info<Join_on_tree> : kind_info<join_on_tree> { };
 
 // A sql statement of form t1 union t2
 struct Union_tree : Tree {
@@ -263,6 +330,7 @@ struct Union_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Union_tree> : kind_info<union_tree> { };
 
 // A sql statement of form t1 intersect t2
 struct Intersect_tree : Tree {
@@ -272,6 +340,7 @@ struct Intersect_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Intersect_tree> : kind_info<intersect_tree> { };
 
 // A sql statement of form t2 except t2
 struct Except_tree : Tree {
@@ -281,6 +350,7 @@ struct Except_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Except_tree> : kind_info<except_tree> { };
 
 // A variant of the form '<t1, ..., tn>' where each ti is a
 // a variable of the form 'x:T' or a member of the form 'x=t'.
@@ -295,6 +365,7 @@ struct Variant_tree : Tree {
 
   Tree_seq* t1;
 };
+template<> struct node_info<Variant_tree> : kind_info<variant_tree> { };
 
 // A comma-separated sequence of terms.
 struct Comma_tree : Tree {
@@ -305,6 +376,7 @@ struct Comma_tree : Tree {
 
   Tree_seq* t1;
 };
+template<> struct node_info<Comma_tree> : kind_info<comma_tree> { };
 
 // An expression of the form 't1.t2'.
 struct Dot_tree : Tree {
@@ -317,6 +389,7 @@ struct Dot_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Dot_tree> : kind_info<dot_tree> { };
 
 // A complete program.
 struct Prog_tree : Tree {
@@ -327,6 +400,7 @@ struct Prog_tree : Tree {
 
   Tree_seq* t1;
 };
+template<> struct node_info<Prog_tree> : kind_info<prog_tree> { };
 
 // t1 and t2
 struct And_tree : Tree {
@@ -336,6 +410,7 @@ struct And_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<And_tree> : kind_info<and_tree> { };
 
 // t1 or t2
 struct Or_tree : Tree {
@@ -345,6 +420,7 @@ struct Or_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Or_tree> : kind_info<or_tree> { };
 
 // not t1
 struct Not_tree : Tree {
@@ -353,6 +429,7 @@ struct Not_tree : Tree {
 
   Tree* t1;
 };
+template<> struct node_info<Not_tree> : kind_info<not_tree> { };
 
 // t1 == t2
 struct Eq_comp_tree : Tree {
@@ -362,6 +439,7 @@ struct Eq_comp_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Eq_comp_tree> : kind_info<eq_comp_tree> { };
 
 // t1 < t2
 struct Less_tree : Tree {
@@ -371,6 +449,7 @@ struct Less_tree : Tree {
   Tree* t1;
   Tree* t2;
 };
+template<> struct node_info<Less_tree> : kind_info<less_tree> { };
 
 // -------------------------------------------------------------------------- //
 // Pretty printing
@@ -0,0 +1,486 @@
+
+#include "table.hpp"
+#include "type.hpp"
+#include "value.hpp"
+
+#include "lang/debug.hpp"
+
+#include <functional>
+
+// -------------------------------------------------------------------------- //
+// Columns
+
+namespace {
+
+// Returns the storage class for values of type t.
+Column_kind
+get_column_kind(Type* t) {
+  if (is_bool_type(t))
+    return bool_column;
+  if (is_nat_type(t))
+    return nat_column;
+  if (is_str_type(t))
+    return str_column;
+  return term_column;
+}
+
+// Returns true if the integer z can be stored in a Nat column.
+inline bool
+fits_nat_column(const Integer& z) {
+  return z.is_small();
+}
+
+// Returns the hash of n. This is the same as the hash of Integer(n),
+// which hashes the sign and the single limb of the magnitude.
+inline std::size_t
+hash_nat(std::int64_t n) {
+  static_assert(GMP_LIMB_BITS == 64, "unsupported limb size");
+  std::size_t h = (n > 0) - (n < 0) + 1;
+  if (n != 0)
+    h = h * 31 + (n < 0 ? -static_cast<std::uint64_t>(n) : n);
+  return h;
+}
+
+} // namespace
+
+Column::Column(Type* t)
+  : kind(get_column_kind(t)), type(t) { }
+
+// Returns the number of values in the column.
+std::size_t
+Column::size() const {
+  switch (kind) {
+  case bool_column: return bools.size();
+  case nat_column: return nats.size();
+  case int_column: return ints.size();
+  case str_column: return strs.size();
+  case term_column: return terms.size();
+  }
+  lang_unreachable("unknown column kind");
+}
+
+// Returns the i-th value in the column as a term.
+Term*
+Column::get(std::size_t i) const {
+  switch (kind) {
+  case bool_column: return bools[i] ? get_true() : get_false();
+  case nat_column: return get_nat(nats[i]);
+  case int_column: return make<Int>(type, ints[i]);
+  case str_column: return make<Str>(type, strs[i]);
+  case term_column: return terms[i];
+  }
+  lang_unreachable("unknown column kind");
+}
+
+// Replace the i-th value in the column with the j-th value of the
+// column c. Both columns must have the same type.
+void
+Column::set(std::size_t i, const Column& c, std::size_t j) {
+  if (kind == nat_column and c.kind == int_column)
+    promote();
+  switch (kind) {
+  case bool_column: bools[i] = c.bools[j]; return;
+  case nat_column: nats[i] = c.nats[j]; return;
+  case int_column:
+    ints[i] = c.kind == nat_column ? Integer(c.nats[j]) : c.ints[j];
+    return;
+  case str_column: strs[i] = c.strs[j]; return;
+  case term_column: terms[i] = c.terms[j]; return;
+  }
+}
+
+// Append the value t to the column. If t is an integer that does not
+// fit in a Nat column, the column is promoted to arbitrary precision.
+void
+Column::push_back(Term* t) {
+  switch (kind) {
+  case bool_column:
+    bools.push_back(is_true(t));
+    return;
+  case nat_column: {
+    const Integer& z = as<Int>(t)->value();
+    if (fits_nat_column(z)) {
+      nats.push_back(z.small());
+      return;
+    }
+    promote();
+    ints.push_back(z);
+    return;
+  }
+  case int_column:
+    ints.push_back(as<Int>(t)->value());
+    return;
+  case str_column:
+    strs.push_back(as<Str>(t)->value());
+    return;
+  case term_column:
+    terms.push_back(t);
+    return;
+  }
+}
+
+// Append the i-th value of the column c to this column. Both columns
+// must have the same type.
+void
+Column::append(const Column& c, std::size_t i) {
+  if (kind != c.kind) {
+    push_back(c.get(i));
+    return;
+  }
+  switch (kind) {
+  case bool_column: bools.push_back(c.bools[i]); return;
+  case nat_column: nats.push_back(c.nats[i]); return;
+  case int_column: ints.push_back(c.ints[i]); return;
+  case str_column: strs.push_back(c.strs[i]); return;
+  case term_column: terms.push_back(c.terms[i]); return;
+  }
+}
+
+// Append the values of the column c from position first up to, but
+// not including, position last to this column.
+void
+Column::append(const Column& c, std::size_t first, std::size_t last) {
+  if (kind != c.kind) {
+    for (std::size_t i = first; i < last; ++i)
+      push_back(c.get(i));
+    return;
+  }
+  switch (kind) {
+  case bool_column:
+    bools.insert(bools.end(), c.bools.begin() + first, c.bools.begin() + last);
+    return;
+  case nat_column:
+    nats.insert(nats.end(), c.nats.begin() + first, c.nats.begin() + last);
+    return;
+  case int_column:
+    ints.insert(ints.end(), c.ints.begin() + first, c.ints.begin() + last);
+    return;
+  case str_column:
+    strs.insert(strs.end(), c.strs.begin() + first, c.strs.begin() + last);
+    return;
+  case term_column:
+    terms.insert(terms.end(), c.terms.begin() + first, c.terms.begin() + last);
+    return;
+  }
+}
+
+// Convert a Nat column to an arbitrary precision column.
+void
+Column::promote() {
+  lang_assert(kind == nat_column, "promoting a non-Nat column");
+  ints.reserve(nats.size() + 1);
+  for (std::int64_t n : nats)
+    ints.push_back(Integer(n));
+  nats.clear();
+  nats.shrink_to_fit();
+  kind = int_column;
+}
+
+// Reserve storage for n values.
+void
+Column::reserve(std::size_t n) {
+  switch (kind) {
+  case bool_column: bools.reserve(n); return;
+  case nat_column: nats.reserve(n); return;
+  case int_column: ints.reserve(n); return;
+  case str_column: strs.reserve(n); return;
+  case term_column: terms.reserve(n); return;
+  }
+}
+
+// Returns the hash of the i-th value in the column. This is the same
+// as the structural hash of the value, so that rows can be compared
+// to values that are not stored in tables.
+std::size_t
+Column::hash(std::size_t i) const {
+  switch (kind) {
+  case bool_column: return bools[i] ? true_term : false_term;
+  case nat_column: return hash_combine(int_term, hash_nat(nats[i]));
+  case int_column: return hash_combine(int_term, std::hash<Integer>()(ints[i]));
+  case str_column: return hash_combine(str_term, std::hash<String>()(strs[i]));
+  case term_column: return hash_value(terms[i]);
+  }
+  lang_unreachable("unknown column kind");
+}
+
+// Returns true when the i-th value of this column is the same as the
+// j-th value of the column c.
+bool
+Column::is_same(std::size_t i, const Column& c, std::size_t j) const {
+  if (kind != c.kind)
+    return ::is_same(get(i), c.get(j));
+  switch (kind) {
+  case bool_column: return bools[i] == c.bools[j];
+  case nat_column: return nats[i] == c.nats[j];
+  case int_column: return ints[i] == c.ints[j];
+  case str_column: return strs[i] == c.strs[j];
+  case term_column: return ::is_same(terms[i], c.terms[j]);
+  }
+  lang_unreachable("unknown column kind");
+}
+
+// Returns true when the i-th value of this column is the value v.
+bool
+Column::is_same(std::size_t i, Term* v) const {
+  switch (kind) {
+  case bool_column: return bools[i] ? is<True>(v) : is<False>(v);
+  case nat_column: return is<Int>(v) and compare(as<Int>(v)->value(), nats[i]) == 0;
+  case int_column: return is<Int>(v) and as<Int>(v)->value() == ints[i];
+  case str_column: return is<Str>(v) and as<Str>(v)->value() == strs[i];
+  case term_column: return ::is_same(terms[i], v);
+  }
+  lang_unreachable("unknown column kind");
+}
+
+// Returns true when the i-th value of this column is less than the
+// j-th value of the column c. Values are ordered as by is_less, so
+// true is less than false.
+bool
+Column::is_less(std::size_t i, const Column& c, std::size_t j) const {
+  if (kind != c.kind)
+    return ::is_less(get(i), c.get(j));
+  switch (kind) {
+  case bool_column: return bools[i] and not c.bools[j];
+  case nat_column: return nats[i] < c.nats[j];
+  case int_column: return ints[i] < c.ints[j];
+  case str_column: return strs[i] < c.strs[j];
+  case term_column: return ::is_less(terms[i], c.terms[j]);
+  }
+  lang_unreachable("unknown column kind");
+}
+
+
+// -------------------------------------------------------------------------- //
+// Tables
+
+// Construct an empty table of type t, which must be a list of records.
+// The table has one column for each member of the record type.
+Table::Table(Type* t)
+  : Term(table_term, t)
+{
+  Record_type* r = get_row_type(t);
+  lang_assert(r, format("'{}' is not a table type", pretty(t)));
+  t1.reserve(r->members()->size());
+  for (Term* v : *r->members())
+    t1.emplace_back(get_type(v));
+}
+
+// Returns the record type of the rows in the table.
+Record_type*
+Table::schema() const { return get_row_type(tr); }
+
+// Returns the number of rows in the table.
+std::size_t
+Table::size() const { return t1.empty() ? 0 : t1.front().size(); }
+
+// Returns a new, empty table of type t.
+Table*
+make_table(Type* t) { return make<Table>(t); }
+
+// Returns a table containing the records of the list l, which must
+// be a list of records.
+Table*
+make_table(List* l) {
+  Table* t = make<Table>(get_type(l));
+  for (Column& c : t->t1)
+    c.reserve(l->elems()->size());
+  for (Term* r : *l->elems())
+    append_row(t, as<Record>(r));
+  return t;
+}
+
+// Returns the projection of the table t onto the columns at the
+// given positions, in that order.
+Table*
+make_table(Table* t, const std::vector<int>& cols) {
+  Type* r_type = project_record_type(t->schema(), cols);
+  Table* res = make<Table>(make<List_type>(get_kind_type(), r_type));
+  for (std::size_t i = 0; i < cols.size(); ++i)
+    res->t1[i] = t->t1[cols[i]];
+  return res;
+}
+
+// If t is a list of records, returns t as a table. Otherwise, returns
+// t unchanged.
+Term*
+to_table(Term* t) {
+  if (List* l = as<List>(t))
+    if (is_table_type(get_type(l)))
+      return make_table(l);
+  return t;
+}
+
+// Returns the i-th row of the table t as a record.
+Record*
+get_row(Table* t, std::size_t i) {
+  Record_type* r_type = t->schema();
+  Term_seq* vars = r_type->members();
+  Term_seq* inits = make<Term_seq>();
+  inits->reserve(vars->size());
+  for (std::size_t j = 0; j < vars->size(); ++j) {
+    Var* v = as<Var>((*vars)[j]);
+    Term* val = t->t1[j].get(i);
+    inits->push_back(make<Init>(get_type(val), v->name(), val));
+  }
+  return make<Record>(r_type, inits);
+}
+
+// Returns a table containing the rows of t from position first up
+// to, but not including, position last.
+Table*
+get_rows(Table* t, std::size_t first, std::size_t last) {
+  Table* res = make<Table>(get_type(t));
+  for (std::size_t j = 0; j < t->t1.size(); ++j)
+    res->t1[j].append(t->t1[j], first, last);
+  return res;
+}
+
+// Append the record r to the table t. The record must have the same
+// members as the rows of t.
+void
+append_row(Table* t, Record* r) {
+  Term_seq* inits = r->members();
+  for (std::size_t j = 0; j < inits->size(); ++j)
+    t->t1[j].push_back(as<Term>(as<Init>((*inits)[j])->value()));
+}
+
+// Append the i-th row of s to the table t. Both tables must have
+// the same type.
+void
+append_row(Table* t, Table* s, std::size_t i) {
+  for (std::size_t j = 0; j < t->t1.size(); ++j)
+    t->t1[j].append(s->t1[j], i);
+}
+
+// Append the columns cols of the i-th row of s to the table t. The
+// schema of t must be the projection of the schema of s onto those
+// columns.
+void
+append_row(Table* t, Table* s, std::size_t i, const std::vector<int>& cols) {
+  for (std::size_t j = 0; j < cols.size(); ++j)
+    t->t1[j].append(s->t1[cols[j]], i);
+}
+
+// Append the merge of the i-th row of a and the j-th row of b to
+// the table t. The schema of t must be the merge of the schemas of
+// a and b.
+void
+append_row(Table* t, Table* a, std::size_t i, Table* b, std::size_t j) {
+  std::size_t n = a->t1.size();
+  for (std::size_t k = 0; k < n; ++k)
+    t->t1[k].append(a->t1[k], i);
+  for (std::size_t k = 0; k < b->t1.size(); ++k)
+    t->t1[n + k].append(b->t1[k], j);
+}
+
+// Returns the hash of the i-th row of t.
+std::size_t
+hash_row(Table* t, std::size_t i) {
+  std::size_t h = record_term;
+  for (const Column& c : t->t1)
+    h = hash_combine(h, c.hash(i));
+  return h;
+}
+
+// Returns true when the i-th row of a has the same values as the
+// j-th row of b.
+bool
+same_row(Table* a, std::size_t i, Table* b, std::size_t j) {
+  if (a->t1.size() != b->t1.size())
+    return false;
+  for (std::size_t k = 0; k < a->t1.size(); ++k)
+    if (not a->t1[k].is_same(i, b->t1[k], j))
+      return false;
+  return true;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Attributes
+
+// Returns the definition of the table named by t, or nullptr if
+// t does not refer to a defined table.
+Def*
+get_table_def(Term* t) {
+  if (Ref* ref = as<Ref>(t))
+    return as<Def>(ref->decl());
+  return nullptr;
+}
+
+// Returns the attributes of the columns of the table t, which is
+// defined by d.
+Attr_seq
+get_attrs(Table* t, Def* d) {
+  Attr_seq attrs;
+  attrs.reserve(t->t1.size());
+  for (Term* v : *t->schema()->members())
+    attrs.push_back({d, as<Var>(v)});
+  return attrs;
+}
+
+// Returns the type of a table whose columns have the given attributes.
+Type*
+get_table_type(const Attr_seq& attrs) {
+  Term_seq* vars = make<Term_seq>();
+  vars->reserve(attrs.size());
+  for (const Attr& a : attrs)
+    vars->push_back(a.var);
+  Type* r_type = make<Record_type>(get_kind_type(), vars);
+  return make<List_type>(get_kind_type(), r_type);
+}
+
+// Returns true when a and b name the same member of the same table.
+bool
+is_same_attr(const Attr& a, const Attr& b) {
+  return a.def == b.def and is_same(a.var->name(), b.var->name());
+}
+
+// If t is a column reference of the form 'x.n' where 'x' refers to a
+// defined table, returns the position of the first column having that
+// attribute. Otherwise, returns -1.
+int
+get_column_index(Term* t, const Attr_seq& attrs) {
+  Mem* m = as<Mem>(t);
+  if (not m)
+    return -1;
+  Def* d = get_table_def(m->record());
+  Ref* ref = as<Ref>(m->member());
+  Var* v = ref ? as<Var>(ref->decl()) : nullptr;
+  if (not d or not v)
+    return -1;
+  for (std::size_t i = 0; i < attrs.size(); ++i) {
+    if (is_same_attr(attrs[i], {d, v}))
+      return i;
+  }
+  return -1;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Row keys
+
+std::size_t
+Row_key_hash::operator()(const Row_key& k) const {
+  if (not k.cols)
+    return hash_row(k.table, k.row);
+  std::size_t h = record_term;
+  for (int c : *k.cols)
+    h = hash_combine(h, k.table->t1[c].hash(k.row));
+  return h;
+}
+
+bool
+Row_key_eq::operator()(const Row_key& a, const Row_key& b) const {
+  if (not a.cols or not b.cols)
+    return same_row(a.table, a.row, b.table, b.row);
+  if (a.cols->size() != b.cols->size())
+    return false;
+  for (std::size_t i = 0; i < a.cols->size(); ++i) {
+    const Column& ca = a.table->t1[(*a.cols)[i]];
+    const Column& cb = b.table->t1[(*b.cols)[i]];
+    if (not ca.is_same(a.row, cb, b.row))
+      return false;
+  }
+  return true;
+}
+
@@ -0,0 +1,143 @@
+
+#ifndef TABLE_HPP
+#define TABLE_HPP
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// This module defines the columnar representation of tables. A table
+// is a list of records that share a record type. Rather than storing
+// each row as a record of initializers, a table stores one typed
+// vector of values per attribute of its record type.
+
+// -------------------------------------------------------------------------- //
+// Columns
+
+// The storage class of a column is determined by the type of its
+// attribute.
+enum Column_kind {
+  bool_column, // Bool values, bit-packed
+  nat_column,  // Nat values that fit in 64 bits
+  int_column,  // Nat values of arbitrary precision
+  str_column,  // Str values, stored as interned strings
+  term_column  // Any other values
+};
+
+// A column stores the values of one attribute for each row of a table.
+// Only the vector corresponding to the column's kind is used.
+//
+// Note that a Nat column is promoted to an arbitrary precision column
+// when a value that does not fit in 64 bits is appended.
+struct Column {
+  Column(Type*);
+
+  std::size_t size() const;
+
+  Term* get(std::size_t) const;
+  void set(std::size_t, const Column&, std::size_t);
+  void push_back(Term*);
+  void append(const Column&, std::size_t);
+  void append(const Column&, std::size_t, std::size_t);
+  void reserve(std::size_t);
+  void promote();
+
+  std::size_t hash(std::size_t) const;
+  bool is_same(std::size_t, const Column&, std::size_t) const;
+  bool is_same(std::size_t, Term*) const;
+  bool is_less(std::size_t, const Column&, std::size_t) const;
+
+  Column_kind kind;
+  Type* type;
+  std::vector<bool> bools;
+  std::vector<std::int64_t> nats;
+  std::vector<Integer> ints;
+  std::vector<String> strs;
+  std::vector<Term*> terms;
+};
+
+using Column_seq = std::vector<Column>;
+
+
+// -------------------------------------------------------------------------- //
+// Tables
+
+// A table value of the form '[{n1=v1, ..., nk=vk}, ...]' stored by
+// column. The type of a table is the list type '[R]' where R is the
+// record type of its rows. There is one column for each member of R.
+struct Table : Term {
+  Table(Type*);
+
+  Record_type* schema() const;
+  std::size_t size() const;
+
+  Column_seq t1;
+};
+template<> struct node_info<Table> : kind_info<table_term> { };
+
+Table* make_table(Type*);
+Table* make_table(List*);
+Table* make_table(Table*, const std::vector<int>&);
+Term* to_table(Term*);
+
+Record* get_row(Table*, std::size_t);
+Table* get_rows(Table*, std::size_t, std::size_t);
+void append_row(Table*, Record*);
+void append_row(Table*, Table*, std::size_t);
+void append_row(Table*, Table*, std::size_t, const std::vector<int>&);
+void append_row(Table*, Table*, std::size_t, Table*, std::size_t);
+
+std::size_t hash_row(Table*, std::size_t);
+bool same_row(Table*, std::size_t, Table*, std::size_t);
+
+
+// -------------------------------------------------------------------------- //
+// Attributes
+
+// An attribute describes where a column of a table comes from. The
+// column holds the values of the member v of the rows of the table
+// defined by d. The definition is null when the column does not come
+// from a defined table.
+//
+// A condition such as 'x.n eq 0' refers to the column whose attribute
+// is the member n of the table defined by x. When several columns
+// have that attribute, the condition refers to the first one.
+struct Attr {
+  Def* def;
+  Var* var;
+};
+
+using Attr_seq = std::vector<Attr>;
+
+Def* get_table_def(Term*);
+Attr_seq get_attrs(Table*, Def*);
+Type* get_table_type(const Attr_seq&);
+bool is_same_attr(const Attr&, const Attr&);
+int get_column_index(Term*, const Attr_seq&);
+
+
+// -------------------------------------------------------------------------- //
+// Row keys
+
+// A row key refers to the values of the given columns of a row in a
+// table. When cols is null, the key is the entire row. Row keys are
+// used to hash and compare rows without materializing them.
+struct Row_key {
+  Table* table;
+  std::size_t row;
+  const std::vector<int>* cols;
+};
+
+// A hash function on row keys, consistent with Row_key_eq.
+struct Row_key_hash {
+  std::size_t operator()(const Row_key&) const;
+};
+
+// An equivalence relation on row keys. Two keys are equal when their
+// respective columns have the same values.
+struct Row_key_eq {
+  bool operator()(const Row_key&, const Row_key&) const;
+};
+
+#endif
@@ -0,0 +1,26 @@
+# Runs the program PROGRAM with the interpreter WAFFLE on one thread,
+# and again on several threads with small morsels, so that its tables
+# are split into several morsels and batches. The outputs must be the
+# same.
+#
+#   cmake -DWAFFLE=<waffle> -DPROGRAM=<program> -P threads.cmake
+
+function(run_waffle out threads morsel)
+  set(ENV{WAFFLE_THREADS} ${threads})
+  set(ENV{WAFFLE_MORSEL_SIZE} ${morsel})
+  execute_process(COMMAND ${WAFFLE}
+                  INPUT_FILE ${PROGRAM}
+                  OUTPUT_VARIABLE output
+                  ERROR_VARIABLE output
+                  RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${PROGRAM} failed on ${threads} threads: ${result}")
+  endif()
+  set(${out} "${output}" PARENT_SCOPE)
+endfunction()
+
+run_waffle(expected 1 16384)
+run_waffle(actual 4 64)
+if(NOT expected STREQUAL actual)
+  message(FATAL_ERROR "${PROGRAM} differs on several threads")
+endif()
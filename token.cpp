@@ -3,6 +3,65 @@
 
 #include "lang/debug.hpp"
 
+namespace {
+
+// The keywords of the language. These are the keywords registered by
+// init_tokens, which checks that the two agree.
+constexpr Keyword keywords_[] = {
+  {"def", def_tok},
+  {"else", else_tok},
+  {"false", false_tok},
+  {"if", if_tok},
+  {"iszero", iszero_tok},
+  {"print", print_tok},
+  {"pred", pred_tok},
+  {"succ", succ_tok},
+  {"then", then_tok},
+  {"true", true_tok},
+  {"typeof", typeof_tok},
+  {"unit", unit_tok},
+  {"import", import_tok},
+  {"and", and_tok},
+  {"or", or_tok},
+  {"not", not_tok},
+  {"eq", eq_comp_tok},
+  {"lt", less_tok},
+  // Type names
+  {"Bool", bool_type_tok},
+  {"Nat", nat_type_tok},
+  {"Unit", unit_type_tok},
+  {"Str", str_type_tok},
+  // Relational algebra keywords
+  {"select", select_tok},
+  {"from", from_tok},
+  {"where", where_tok},
+  {"join", join_tok},
+  {"on", on_tok},
+  {"union", union_tok},
+  {"intersect", intersect_tok},
+  {"except", except_tok},
+  {"group", group_tok},
+  {"by", by_tok},
+  {"count", count_tok},
+  {"sum", sum_tok},
+  {"min", min_tok},
+  {"max", max_tok},
+  // Table storage keywords
+  {"load", load_tok},
+  {"as", as_tok},
+  {"save", save_tok},
+  {"to", to_tok},
+};
+
+using Keywords = Keyword_table<keywords_, sizeof(keywords_) / sizeof(Keyword)>;
+
+} // namespace
+
+// Returns the keyword token spelled by the n characters at p, or
+// error_tok if there is none.
+Token_kind
+keyword(const char* p, std::size_t n) { return Keywords::find(p, n); }
+
 void
 init_tokens() {
   // Keywords
@@ -18,26 +77,22 @@ init_tokens() {
   init_token(true_tok, "true");
   init_token(typeof_tok, "typeof");
   init_token(unit_tok, "unit");
-<<<<<<< HEAD
   init_token(import_tok, "import"); //module extension
-=======
   init_token(and_tok, "and");
   init_token(or_tok, "or");
   init_token(not_tok, "not");
   init_token(eq_comp_tok, "eq");
   init_token(less_tok, "lt");
->>>>>>> upstream/master
   // Type names
   init_token(bool_type_tok, "Bool");
   init_token(nat_type_tok, "Nat");
   init_token(unit_type_tok, "Unit");
+  init_token(str_type_tok, "Str");
   // Identifiers, literals, files
   init_token(identifier_tok, "identifier");
   init_token(decimal_literal_tok, "decimal");
-<<<<<<< HEAD
   init_token(file_tok, "file"); //module extension
   init_token(directory_tok, "directory"); //module extension
-=======
   // Relational algebra identifiers
   init_token(select_tok, "select");
   init_token(from_tok, "from");
@@ -47,5 +102,20 @@ init_tokens() {
   init_token(union_tok, "union");
   init_token(intersect_tok, "intersect");
   init_token(except_tok, "except");
->>>>>>> upstream/master
+  init_token(group_tok, "group");
+  init_token(by_tok, "by");
+  init_token(count_tok, "count");
+  init_token(sum_tok, "sum");
+  init_token(min_tok, "min");
+  init_token(max_tok, "max");
+  // Table storage keywords
+  init_token(load_tok, "load");
+  init_token(as_tok, "as");
+  init_token(save_tok, "save");
+  init_token(to_tok, "to");
+
+  // Each keyword in the table must have been registered above.
+  for (const Keyword& k : keywords_)
+    lang_assert(token_name(k.kind) == String(k.str),
+                format("keyword '{0}' is not registered", k.str));
 }
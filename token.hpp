@@ -40,19 +40,17 @@ constexpr Token_kind then_tok      = make_token(108);
 constexpr Token_kind true_tok      = make_token(109);
 constexpr Token_kind typeof_tok    = make_token(110);
 constexpr Token_kind unit_tok      = make_token(111);
-<<<<<<< HEAD
-constexpr Token_kind import_tok	   = make_token(112); //module extension
-=======
+constexpr Token_kind import_tok    = make_token(112); //module extension
 constexpr Token_kind and_tok       = make_token(113);
 constexpr Token_kind or_tok        = make_token(114);
 constexpr Token_kind not_tok       = make_token(115);
 constexpr Token_kind eq_comp_tok   = make_token(116); // eq
 constexpr Token_kind less_tok      = make_token(117); // lt
->>>>>>> upstream/master
 // Type names
 constexpr Token_kind bool_type_tok = make_token(200);
 constexpr Token_kind nat_type_tok  = make_token(201);
 constexpr Token_kind unit_type_tok = make_token(202);
+constexpr Token_kind str_type_tok  = make_token(203);
 
 // Relational algebra keywords
 constexpr Token_kind select_tok    = make_token(301);
@@ -63,5 +61,17 @@ constexpr Token_kind on_tok        = make_token(305);
 constexpr Token_kind union_tok     = make_token(306);
 constexpr Token_kind intersect_tok = make_token(307);
 constexpr Token_kind except_tok    = make_token(308);
+constexpr Token_kind group_tok     = make_token(309);
+constexpr Token_kind by_tok        = make_token(310);
+constexpr Token_kind count_tok     = make_token(311);
+constexpr Token_kind sum_tok       = make_token(312);
+constexpr Token_kind min_tok       = make_token(313);
+constexpr Token_kind max_tok       = make_token(314);
+
+// Table storage keywords
+constexpr Token_kind load_tok      = make_token(401);
+constexpr Token_kind as_tok        = make_token(402);
+constexpr Token_kind save_tok      = make_token(403);
+constexpr Token_kind to_tok        = make_token(404);
 
 #endif
@@ -1,4 +1,5 @@
 
+#include "type.hpp"
 #include "ast.hpp"
 
 
@@ -22,6 +23,13 @@ init_types() {
   bool_type_ = new Bool_type(kind_type_);
   nat_type_ = new Nat_type(kind_type_);
   str_type_ = new Str_type(kind_type_);
+
+  // The built-in types are their own canonical nodes.
+  make_canonical(kind_type_);
+  make_canonical(unit_type_);
+  make_canonical(bool_type_);
+  make_canonical(nat_type_);
+  make_canonical(str_type_);
   //tuple_type_ = new Tuple_type(kind_type_);
 }
 
@@ -67,6 +75,10 @@ is_str_type(Type* t) { return t->kind == str_type; }
 bool 
 is_arrow_type(Type* t) { return t->kind == arrow_type; }
 
+// Returns true if t is a table type, a list of records.
+bool
+is_table_type(Type* t) { return get_row_type(t); }
+
 // Returns true if t is the kind of a type.
 bool
 is_kind(Expr* e) { return e->kind == kind_type; }
@@ -79,9 +91,40 @@ get_type(Expr* e) { return e->tr; }
 // Return a sequence of types for the sequence of terms.
 Type_seq*
 get_type(Term_seq* e) { 
-  Type_seq* types = new Type_seq();
+  Type_seq* types = make<Type_seq>();
   for (Term* t : *e)
     types->push_back(get_type(t));
   return types; 
 }
 
+// Returns the record type of the rows of a table type, or nullptr
+// if t is not a list of records.
+Record_type*
+get_row_type(Type* t) {
+  if (List_type* l_type = as<List_type>(t))
+    return as<Record_type>(l_type->type());
+  return nullptr;
+}
+
+// Returns the record type whose members are the members of r at the
+// given positions, in that order. This is the schema of a projection.
+Record_type*
+project_record_type(Record_type* r, const std::vector<int>& cols) {
+  Term_seq* vars = make<Term_seq>();
+  vars->reserve(cols.size());
+  for (int i : cols)
+    vars->push_back((*r->members())[i]);
+  return make<Record_type>(get_kind_type(), vars);
+}
+
+// Returns the record type whose members are those of a followed
+// by those of b. This is the schema of a merged record.
+Record_type*
+merge_record_types(Record_type* a, Record_type* b) {
+  Term_seq* vars = make<Term_seq>();
+  vars->reserve(a->members()->size() + b->members()->size());
+  vars->insert(vars->end(), a->members()->begin(), a->members()->end());
+  vars->insert(vars->end(), b->members()->begin(), b->members()->end());
+  return make<Record_type>(get_kind_type(), vars);
+}
+
@@ -4,6 +4,8 @@
 
 #include "ast.hpp"
 
+#include <vector>
+
 // This module defines support functions for querying the type
 // of an expression.
 
@@ -19,9 +21,14 @@ bool is_bool_type(Type*);
 bool is_nat_type(Type*);
 bool is_str_type(Type*);
 bool is_arrow_type(Type*);
+bool is_table_type(Type*);
 bool is_kind(Expr*);
 
 Type* get_type(Expr*);
 Type_seq* get_type(Term_seq*);
 
+Record_type* get_row_type(Type*);
+Record_type* merge_record_types(Record_type*, Record_type*);
+Record_type* project_record_type(Record_type*, const std::vector<int>&);
+
 #endif
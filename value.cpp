@@ -8,11 +8,20 @@
 //
 // TODO: Consider add a new "value" module for these things.
 
+//
+// Values are immutable, so the evaluator returns shared nodes for the
+// most common ones rather than allocating a new node for each result.
+// There is a single node for unit, each boolean value, and each small
+// natural number.
+
 namespace {
 
 Unit* unit_;
 True* true_;
 False* false_;
+Int* nats_[WAFFLE_NAT_CACHE];
+
+static_assert(WAFFLE_NAT_CACHE > 0, "the cache must contain zero");
 
 } // namespace
 
@@ -21,6 +30,8 @@ init_values() {
   unit_ = new Unit(get_unit_type());
   true_ = new True(get_bool_type());
   false_ = new False(get_bool_type());
+  for (long n = 0; n < WAFFLE_NAT_CACHE; ++n)
+    nats_[n] = new Int(get_nat_type(), Integer(n));
 }
 
 Term*
@@ -32,6 +43,31 @@ get_true() { return true_; }
 Term*
 get_false() { return false_; }
 
+// Returns the value of the boolean b.
+Term*
+get_bool(bool b) { return b ? get_true() : get_false(); }
+
+Term*
+get_zero() { return nats_[0]; }
+
+// Returns a natural number with the value n. The node is shared when n
+// is small.
+Term*
+get_nat(long n) {
+  if (0 <= n and n < WAFFLE_NAT_CACHE)
+    return nats_[n];
+  return make<Int>(get_nat_type(), Integer(n));
+}
+
+// Returns a natural number with the value z. The node is shared when z
+// is small.
+Term*
+get_nat(const Integer& z) {
+  if (z.is_small() and 0 <= z.small() and z.small() < WAFFLE_NAT_CACHE)
+    return nats_[z.small()];
+  return make<Int>(get_nat_type(), z);
+}
+
 // -------------------------------------------------------------------------- //
 // Term classification
 //
@@ -2,15 +2,27 @@
 #ifndef VALUE_HPP
 #define VALUE_HPP
 
+#include <cstddef>
+
 struct Term;
+class Integer;
 
 // This module provides support for querying properties related
 // to values.
 
+// The number of natural numbers whose values are shared: each of
+// 0 through WAFFLE_NAT_CACHE - 1 is represented by a single node.
+#ifndef WAFFLE_NAT_CACHE
+#  define WAFFLE_NAT_CACHE 1024
+#endif
+
 Term* get_unit();
 Term* get_true();
 Term* get_false();
+Term* get_bool(bool);
 Term* get_zero();
+Term* get_nat(long);
+Term* get_nat(const Integer&);
 
 bool is_value(Term*);
 bool is_boolean_value(Term*);
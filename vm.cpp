@@ -0,0 +1,582 @@
+#include "vm.hpp"
+#include "ast.hpp"
+#include "type.hpp"
+#include "value.hpp"
+#include "subst.hpp"
+#include "table.hpp"
+#include "eval.hpp"
+
+#include "lang/debug.hpp"
+
+#include <iostream>
+#include <unordered_map>
+
+// Use computed goto for dispatch when the compiler supports it.
+#if defined(__GNUC__)
+#  define WAFFLE_COMPUTED_GOTO
+#endif
+
+// -------------------------------------------------------------------------- //
+// Compilation
+
+namespace {
+
+// Compiles the terms of a program or function into code. When
+// compiling a function, references to its parameters are compiled
+// as references to the arguments of the frame, and references to
+// the parameters it captures as references to the captured values.
+struct Compiler {
+  Compiler(Code* c)
+    : code(c) { }
+
+  std::uint32_t emit(Opcode, std::uint32_t = 0);
+  std::uint32_t emit_const(Opcode, Term*);
+  void patch(std::uint32_t);
+  int find_parm(Expr*) const;
+  int find_capture(Expr*) const;
+
+  void compile(Term*);
+  void compile_ref(Ref*);
+  void compile_if(If*);
+  void compile_print(Print*);
+  void compile_def(Def*);
+  void compile_prog(Prog*);
+
+  template<typename T>
+    void compile_unary(T*, Opcode);
+  template<typename T>
+    void compile_binary(T*, Opcode);
+
+  Code* code;
+};
+
+// Append an instruction, returning its index.
+std::uint32_t
+Compiler::emit(Opcode op, std::uint32_t n) {
+  code->instrs.push_back({op, n});
+  return code->instrs.size() - 1;
+}
+
+// Append an instruction whose operand is the constant t.
+std::uint32_t
+Compiler::emit_const(Opcode op, Term* t) {
+  code->consts.push_back(t);
+  return emit(op, code->consts.size() - 1);
+}
+
+// Set the target of the jump at index i to the next instruction.
+void
+Compiler::patch(std::uint32_t i) {
+  code->instrs[i].arg = code->instrs.size();
+}
+
+// Returns the index of the parameter declared by d, or -1 if d is not
+// a parameter of the function being compiled.
+int
+Compiler::find_parm(Expr* d) const {
+  for (std::size_t i = 0; i < code->arity; ++i)
+    if (code->parms[i] == d)
+      return i;
+  return -1;
+}
+
+// Returns the index of the captured parameter declared by d, or -1 if
+// d is not captured by the function being compiled.
+int
+Compiler::find_capture(Expr* d) const {
+  for (std::size_t i = 0; i < code->captured.size(); ++i)
+    if (code->captured[i] == d)
+      return i;
+  return -1;
+}
+
+template<typename T>
+  void
+  Compiler::compile_unary(T* t, Opcode op) {
+    compile(t->t1);
+    emit(op);
+  }
+
+template<typename T>
+  void
+  Compiler::compile_binary(T* t, Opcode op) {
+    compile(t->t1);
+    compile(t->t2);
+    emit(op);
+  }
+
+// A reference to a parameter loads the argument of the frame or the
+// captured value, and a reference to a definition loads its value when
+// it is executed.
+void
+Compiler::compile_ref(Ref* t) {
+  int n = find_parm(t->decl());
+  int k = n < 0 ? find_capture(t->decl()) : -1;
+  if (n >= 0)
+    emit(arg_op, n);
+  else if (k >= 0)
+    emit(capture_op, k);
+  else if (Def* d = as<Def>(t->decl()))
+    emit_const(def_op, d);
+  else
+    emit_const(const_op, t);
+}
+
+void
+Compiler::compile_if(If* t) {
+  compile(t->cond());
+  std::uint32_t j1 = emit(jump_false_op);
+  compile(t->if_true());
+  std::uint32_t j2 = emit(jump_op);
+  patch(j1);
+  compile(t->if_false());
+  patch(j2);
+}
+
+// Compile a print statement. When the printed expression is not a
+// term, it is printed as is.
+void
+Compiler::compile_print(Print* t) {
+  if (Term* t1 = as<Term>(t->expr()))
+    compile(t1);
+  else
+    emit_const(const_op, nullptr);
+  emit_const(print_op, t);
+}
+
+void
+Compiler::compile_def(Def* t) {
+  if (Term* t0 = as<Term>(t->value())) {
+    compile(t0);
+    emit_const(define_op, t);
+  } else {
+    emit_const(const_op, t);
+  }
+}
+
+// Compile each statement of a program, discarding the values of
+// all but the last.
+void
+Compiler::compile_prog(Prog* t) {
+  Term_seq* ss = t->stmts();
+  for (std::size_t i = 0; i < ss->size(); ++i) {
+    if (i)
+      emit(pop_op);
+    compile((*ss)[i]);
+  }
+  if (ss->empty())
+    emit_const(const_op, nullptr);
+}
+
+void
+Compiler::compile(Term* t) {
+  switch (t->kind) {
+  case unit_term:
+  case true_term:
+  case false_term:
+  case int_term:
+  case str_term:
+    emit_const(const_op, t);
+    return;
+  case ref_term: return compile_ref(as<Ref>(t));
+  case if_term: return compile_if(as<If>(t));
+  case not_term:
+    compile(as<Not>(t)->t1);
+    emit(not_op);
+    return;
+  case and_term: return compile_binary(as<And>(t), and_op);
+  case or_term: return compile_binary(as<Or>(t), or_op);
+  case equals_term: return compile_binary(as<Equals>(t), equals_op);
+  case less_term: return compile_binary(as<Less>(t), less_op);
+  case succ_term: return compile_unary(as<Succ>(t), succ_op);
+  case pred_term: return compile_unary(as<Pred>(t), pred_op);
+  case iszero_term: return compile_unary(as<Iszero>(t), iszero_op);
+  case app_term: {
+    App* a = as<App>(t);
+    compile(a->abs());
+    compile(a->arg());
+    emit(call_op, 1);
+    return;
+  }
+  case call_term: {
+    Call* c = as<Call>(t);
+    compile(c->fn());
+    for (Term* a : *c->args())
+      compile(a);
+    emit(call_op, c->args()->size());
+    return;
+  }
+  case abs_term:
+  case fn_term:
+    emit_const(code->arity ? close_op : const_op, t);
+    return;
+  case print_term: return compile_print(as<Print>(t));
+  case def_term: return compile_def(as<Def>(t));
+  case prog_term: return compile_prog(as<Prog>(t));
+  default:
+    break;
+  }
+  emit_const(eval_op, t);
+}
+
+// Returns the code of the function f, which must be an abstraction
+// or function of n parameters. When f is within the function compiled
+// to outer, its code captures the parameters of outer. The code is
+// compiled on first use and owned by f.
+Code*
+get_function(Term* f, std::size_t n, const Code* outer = nullptr) {
+  Abs* a = as<Abs>(f);
+  Fn* fn = as<Fn>(f);
+  if (not a and not fn)
+    lang_unreachable(format("ill-formed call target '{}'", pretty(f)));
+  Code*& slot = a ? a->t3 : fn->t3;
+  if (slot)
+    return slot;
+
+  Code* code = new Code();
+  if (outer) {
+    code->outer = outer;
+    code->captured.assign(outer->parms, outer->parms + outer->arity);
+    code->captured.insert(code->captured.end(), outer->captured.begin(), outer->captured.end());
+  }
+  Term* body;
+  if (a) {
+    lang_assert(n == 1, format("ill-formed application target '{}'", pretty(f)));
+    code->parms = &a->t1;
+    code->arity = 1;
+    body = a->term();
+  } else {
+    lang_assert(n == fn->parms()->size(), "invalid call");
+    code->parms = fn->parms()->data();
+    code->arity = n;
+    body = fn->term();
+  }
+  Compiler comp(code);
+  comp.compile(body);
+  comp.emit(return_op);
+  slot = code;
+  return code;
+}
+
+// Returns the number of parameters of the abstraction or function f.
+inline std::size_t
+get_arity(Term* f) {
+  if (Fn* fn = as<Fn>(f))
+    return fn->parms()->size();
+  return 1;
+}
+
+// Returns the closure of the abstraction f within the function whose
+// code is c, capturing the arguments and captured values of its frame.
+Closure*
+make_closure(Term* f, Code* c, Term* const* args, Term* const* caps) {
+  Code* code = get_function(f, get_arity(f), c);
+  Term_seq* vs = make<Term_seq>();
+  vs->reserve(code->captured.size());
+  vs->insert(vs->end(), args, args + c->arity);
+  vs->insert(vs->end(), caps, caps + c->captured.size());
+  return make<Closure>(get_type(f), f, code, vs);
+}
+
+// Returns the value v as a term that can leave the machine. A closure
+// is converted to its abstraction closed over the captured values.
+Term*
+reify(Term* v) {
+  Closure* k = as<Closure>(v);
+  if (not k)
+    return v;
+  Subst sub;
+  for (std::size_t i = 0; i < k->code->captured.size(); ++i)
+    sub.insert({k->code->captured[i], reify((*k->values())[i])});
+  return subst_term(k->fn(), sub);
+}
+
+// Evaluate the term t in the frame of the function whose code is c.
+// The evaluator binds both the parameters and the captured parameters
+// of the function, whose values are converted to terms. There is a
+// frame for the function and for each function enclosing it.
+Term*
+eval_in_frame(Term* t, Code* c, Term* const* args, Term* const* caps) {
+  if (c->arity == 0 and c->captured.empty())
+    return eval(t);
+  std::vector<Term*> vals;
+  vals.reserve(c->arity + c->captured.size());
+  for (std::size_t i = 0; i < c->arity; ++i)
+    vals.push_back(reify(args[i]));
+  for (std::size_t i = 0; i < c->captured.size(); ++i)
+    vals.push_back(reify(caps[i]));
+  std::vector<Frame> frames;
+  std::size_t k = 0;
+  for (const Code* p = c; p; p = p->outer) {
+    frames.emplace_back(p->parms, vals.data() + k, p->arity);
+    k += p->arity;
+  }
+  for (std::size_t i = 0; i + 1 < frames.size(); ++i)
+    frames[i].parent = &frames[i + 1];
+  return eval(t, &frames[0]);
+}
+
+} // namespace
+
+// The code of a function is released with the function.
+Abs::~Abs() { delete t3; }
+Fn::~Fn() { delete t3; }
+
+// Compile the term t as a program.
+Code*
+compile(Term* t) {
+  Code* code = new Code();
+  Compiler comp(code);
+  comp.compile(t);
+  comp.emit(return_op);
+  return code;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Execution
+
+namespace {
+
+// Ensure that the operand b of a logical operator is a boolean value.
+inline void
+check_boolean(Term* b) {
+  if (not is_boolean_value(b))
+    lang_unreachable(format("'{}' is not a boolean value", pretty(b)));
+}
+
+// The state of a caller, saved during a call.
+struct Call_frame {
+  Code* code;
+  const Instr* pc;
+  std::size_t base;
+  Term* const* caps;
+};
+
+} // namespace
+
+// Run the compiled program, returning its value.
+Term*
+run(Code* code) {
+  std::vector<Term*> stack;
+  std::vector<Call_frame> frames;
+  Code* c = code;
+  const Instr* pc = c->instrs.data();
+  const Instr* ip;
+  std::size_t base = 0;
+  Term* const* caps = nullptr;
+
+  auto pop = [&]() -> Term* {
+    Term* v = stack.back();
+    stack.pop_back();
+    return v;
+  };
+  auto args = [&]() { return stack.data() + base; };
+
+#ifdef WAFFLE_COMPUTED_GOTO
+  // The order of labels is the order of the opcodes.
+  static void* const labels[] = {
+    &&const_op_label,
+    &&arg_op_label,
+    &&capture_op_label,
+    &&def_op_label,
+    &&jump_op_label,
+    &&jump_false_op_label,
+    &&not_op_label,
+    &&and_op_label,
+    &&or_op_label,
+    &&equals_op_label,
+    &&less_op_label,
+    &&succ_op_label,
+    &&pred_op_label,
+    &&iszero_op_label,
+    &&call_op_label,
+    &&close_op_label,
+    &&eval_op_label,
+    &&print_op_label,
+    &&define_op_label,
+    &&pop_op_label,
+    &&return_op_label
+  };
+#  define CASE(op) op##_label
+#  define NEXT() do { ip = pc++; goto *labels[ip->op]; } while (0)
+  NEXT();
+  {
+#else
+#  define CASE(op) case op
+#  define NEXT() goto dispatch
+dispatch:
+  ip = pc++;
+  switch (ip->op) {
+#endif
+
+  CASE(const_op):
+    stack.push_back(c->consts[ip->arg]);
+    NEXT();
+
+  CASE(arg_op):
+    stack.push_back(args()[ip->arg]);
+    NEXT();
+
+  CASE(capture_op):
+    stack.push_back(caps[ip->arg]);
+    NEXT();
+
+  CASE(def_op):
+    stack.push_back(as<Term>(as<Def>(c->consts[ip->arg])->value()));
+    NEXT();
+
+  CASE(jump_op):
+    pc = c->instrs.data() + ip->arg;
+    NEXT();
+
+  CASE(jump_false_op): {
+    Term* b = pop();
+    if (is_false(b))
+      pc = c->instrs.data() + ip->arg;
+    else if (not is_true(b))
+      lang_unreachable(format("'{}' is not a boolean value", pretty(b)));
+    NEXT();
+  }
+
+  CASE(not_op): {
+    Term* b = pop();
+    if (is_true(b))
+      stack.push_back(get_false());
+    else if (is_false(b))
+      stack.push_back(get_true());
+    else
+      lang_unreachable(format("'{}' is not a boolean value", pretty(b)));
+    NEXT();
+  }
+
+  CASE(and_op): {
+    Term* b2 = pop();
+    Term* b1 = pop();
+    check_boolean(b1);
+    check_boolean(b2);
+    stack.push_back(is_true(b1) and is_true(b2) ? get_true() : get_false());
+    NEXT();
+  }
+
+  CASE(or_op): {
+    Term* b2 = pop();
+    Term* b1 = pop();
+    check_boolean(b1);
+    check_boolean(b2);
+    stack.push_back(is_false(b1) and is_false(b2) ? get_false() : get_true());
+    NEXT();
+  }
+
+  CASE(equals_op): {
+    Term* v2 = pop();
+    Term* v1 = pop();
+    stack.push_back(is_same(reify(v1), reify(v2)) ? get_true() : get_false());
+    NEXT();
+  }
+
+  CASE(less_op): {
+    Term* v2 = pop();
+    Term* v1 = pop();
+    stack.push_back(is_less(reify(v1), reify(v2)) ? get_true() : get_false());
+    NEXT();
+  }
+
+  CASE(succ_op): {
+    Int* n = as<Int>(stack.back());
+    lang_assert(n, format("'{}' is not a numeric value", pretty(stack.back())));
+    stack.back() = get_nat(n->value() + 1);
+    NEXT();
+  }
+
+  CASE(pred_op): {
+    Int* n = as<Int>(stack.back());
+    lang_assert(n, format("'{}' is not a numeric value", pretty(stack.back())));
+    if (not (n->value() == 0))
+      stack.back() = get_nat(n->value() - 1);
+    NEXT();
+  }
+
+  CASE(iszero_op): {
+    Int* n = as<Int>(stack.back());
+    lang_assert(n, format("'{}' is not a numeric value", pretty(stack.back())));
+    stack.back() = n->value() == 0 ? get_true() : get_false();
+    NEXT();
+  }
+
+  CASE(call_op): {
+    std::size_t n = ip->arg;
+    Term* f = stack[stack.size() - n - 1];
+    frames.push_back({c, pc, base, caps});
+    base = stack.size() - n;
+    if (Closure* k = as<Closure>(f)) {
+      lang_assert(n == k->code->arity, "invalid call");
+      c = k->code;
+      caps = k->values()->data();
+    } else {
+      c = get_function(f, n);
+      caps = nullptr;
+    }
+    pc = c->instrs.data();
+    NEXT();
+  }
+
+  CASE(close_op):
+    stack.push_back(make_closure(c->consts[ip->arg], c, args(), caps));
+    NEXT();
+
+  CASE(eval_op):
+    stack.push_back(eval_in_frame(c->consts[ip->arg], c, args(), caps));
+    NEXT();
+
+  CASE(print_op): {
+    Term* v = pop();
+    if (v)
+      std::cout << pretty(reify(v)) << '\n';
+    else
+      std::cout << pretty(as<Print>(c->consts[ip->arg])->expr()) << '\n';
+    stack.push_back(get_unit());
+    NEXT();
+  }
+
+  CASE(define_op): {
+    Def* d = as<Def>(c->consts[ip->arg]);
+    d->t2 = to_table(make_canonical(reify(pop())));
+    stack.push_back(d);
+    NEXT();
+  }
+
+  CASE(pop_op):
+    stack.pop_back();
+    NEXT();
+
+  CASE(return_op): {
+    Term* v = pop();
+    if (frames.empty())
+      return reify(v);
+
+    // Discard the function and its arguments, and resume the caller.
+    stack.resize(base - 1);
+    stack.push_back(v);
+    c = frames.back().code;
+    pc = frames.back().pc;
+    base = frames.back().base;
+    caps = frames.back().caps;
+    frames.pop_back();
+    NEXT();
+  }
+
+  }
+#undef CASE
+#undef NEXT
+  lang_unreachable("invalid instruction");
+}
+
+
+// -------------------------------------------------------------------------- //
+// Virtual machine
+
+Term*
+Machine::operator()(Term* t) {
+  return run(compile(t));
+}
@@ -0,0 +1,102 @@
+
+#ifndef VM_HPP
+#define VM_HPP
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// This module defines a compiler from elaborated terms to bytecode
+// and a virtual machine that runs it. The machine evaluates terms
+// with the same semantics as the evaluator in eval.hpp, and values
+// are represented by terms, so the results of the two are the same.
+//
+// The bytecode is a sequence of instructions for a stack machine.
+// Calls push a frame onto the machine's own call stack, so the whole
+// program runs in a single dispatch loop. Terms that the compiler does
+// not translate (e.g., relational terms) are evaluated by the
+// evaluator from within the machine.
+
+// -------------------------------------------------------------------------- //
+// Bytecode
+
+// The operations of the machine. The effect of each operation on the
+// operand stack is given by its comment.
+enum Opcode : std::uint8_t {
+  const_op,      // -- k
+  arg_op,        // -- v, for the n-th argument of the frame
+  capture_op,    // -- v, for the n-th captured value of the frame
+  def_op,        // -- v, for the value of the definition k
+  jump_op,       // --, continuing at instruction n
+  jump_false_op, // b --, continuing at instruction n when b is false
+  not_op,        // b -- not b
+  and_op,        // b1 b2 -- b1 and b2
+  or_op,         // b1 b2 -- b1 or b2
+  equals_op,     // v1 v2 -- v1 == v2
+  less_op,       // v1 v2 -- v1 < v2
+  succ_op,       // n -- n + 1
+  pred_op,       // n -- n - 1
+  iszero_op,     // n -- n == 0
+  call_op,       // f v1 ... vn -- f(v1, ..., vn)
+  close_op,      // -- the closure of the abstraction k in the frame
+  eval_op,       // -- the evaluation of the term k in the frame
+  print_op,      // v -- unit, printing v or the term k
+  define_op,     // v -- k, setting the value of the definition k
+  pop_op,        // v --
+  return_op      // v --, returning v to the caller
+};
+
+// An instruction is an operation and its operand, which is either a
+// constant, an argument, or an instruction index.
+struct Instr {
+  Opcode op;
+  std::uint32_t arg;
+};
+
+// The compiled code of a program or function. The terms used by the
+// instructions are stored in the constant pool. The parameters of a
+// function are the declarations that its arguments are bound to. A
+// function within another function captures the parameters of the
+// enclosing functions, innermost first. The outer code is that of the
+// innermost enclosing function.
+struct Code {
+  std::vector<Instr> instrs;
+  std::vector<Term*> consts;
+  Term* const* parms = nullptr;
+  std::size_t arity = 0;
+  std::vector<Term*> captured;
+  const Code* outer = nullptr;
+};
+
+// A closure is the value of a function within another function: the
+// abstraction, its code, and the values of the parameters it captures.
+// Closures are values of the machine only. A closure that leaves the
+// machine is converted to its abstraction closed over those values.
+struct Closure : Term {
+  Closure(Type* t, Term* f, Code* c, Term_seq* vs)
+    : Term(closure_term, t), t1(f), t2(vs), code(c) { }
+
+  Term* fn() const { return t1; }
+  Term_seq* values() const { return t2; }
+
+  Term* t1;
+  Term_seq* t2;
+  Code* code;
+};
+template<> struct node_info<Closure> : kind_info<closure_term> { };
+
+Code* compile(Term*);
+Term* run(Code*);
+
+
+// -------------------------------------------------------------------------- //
+// Virtual machine
+
+// The virtual machine compiles and runs terms. Like the evaluator,
+// it can be used as a function.
+struct Machine {
+  Term* operator()(Term*);
+};
+
+#endif